@@ -71,6 +71,9 @@ PlcDriver::PlcDriver(QString amsnetid, QObject *parent) : QObject(parent)
 
     // basic error handling
     connect(manager_, &Tc3Manager::error, this, [](QString error){ qWarning() << error; });
+
+    // qml may ask for any symbol, keep at most 2000 handles and release those unused for a minute
+    manager_->setHandleCache(2000, 60000);
 }
 
 PlcDriver::~PlcDriver()
@@ -0,0 +1,175 @@
+#pragma once
+#include <QtGlobal>
+
+// ADS definitions that are not (consistently) available in AdsLib and TcAdsDef.h.
+// Everything in here is part of the ADS protocol and identical for TwinCAT 2 and 3.
+namespace Tc3Ads
+{
+
+// additional index groups of the PLC runtime
+enum IndexGroup : quint32
+{
+    SymVersion = 0xF008,            // symbol version, changes with every online change
+    SymDtUpload = 0xF00E,           // upload all datatype entries
+    SymUploadInfo2 = 0xF00F,        // sizes and counts of symbol and datatype uploads
+    SymDtInfoByNameEx = 0xF011,     // datatype entry by name
+
+    // sum commands, the index offset is the number of sub requests
+    SumUpRead = 0xF080,
+    SumUpWrite = 0xF081,
+    SumUpReadWrite = 0xF082
+};
+
+// maximum number of sub requests the PLC accepts in one sum command
+const int MaxSumRequests = 500;
+
+// AMS/TCP, see Tc3AmsClient
+const quint16 AmsTcpPort = 48898;
+
+// file access of the system service, see Tc3FileStream. The index offset of FileOpen is the
+// open mode combined with the path (PathGeneric << 16), the one of the other commands is the
+// file handle
+const quint16 SystemServicePort = 10000;
+
+enum SystemService : quint32
+{
+    FileOpen = 120,
+    FileClose = 121,
+    FileRead = 122,
+    FileWrite = 123,
+    FileSeek = 124,
+    FileTell = 125,
+    FileDelete = 131
+};
+
+enum FileOpenMode : quint32
+{
+    FileModeRead = 0x01,
+    FileModeWrite = 0x02,
+    FileModeAppend = 0x04,
+    FileModePlus = 0x08,
+    FileModeBinary = 0x10,
+    FileModeText = 0x20
+};
+
+const quint32 PathGeneric = 1;
+
+enum Command : quint16
+{
+    ReadDeviceInfo = 1,
+    Read = 2,
+    Write = 3,
+    ReadState = 4,
+    WriteControl = 5,
+    AddNotification = 6,
+    DelNotification = 7,
+    DeviceNotification = 8,
+    ReadWrite = 9
+};
+
+enum StateFlag : quint16
+{
+    ResponseFlag = 0x0001,
+    CommandFlag = 0x0004            // ads command over tcp
+};
+
+#pragma pack(push, 1)
+
+// every AMS/TCP frame starts with this header, length is the size of everything that follows
+struct AmsTcpHeader
+{
+    quint16 reserved;
+    quint32 length;
+};
+
+// followed by length bytes of ads data. The invoke id of a response is the one of its request
+struct AmsHeader
+{
+    quint8 targetNetId[6];
+    quint16 targetPort;
+    quint8 sourceNetId[6];
+    quint16 sourcePort;
+    quint16 command;
+    quint16 stateFlags;
+    quint32 length;
+    quint32 errorCode;
+    quint32 invokeId;
+};
+
+// sub request of SumUpRead and SumUpWrite, followed by the write data of all sub requests
+struct SumRequest
+{
+    quint32 indexGroup;
+    quint32 indexOffset;
+    quint32 length;
+};
+
+// sub request of SumUpReadWrite, followed by the write data of all sub requests
+struct SumReadWriteRequest
+{
+    quint32 indexGroup;
+    quint32 indexOffset;
+    quint32 readLength;
+    quint32 writeLength;
+};
+
+// Header of a datatype entry, followed by
+//  name, type and comment (each NUL terminated),
+//  arrayDim * DatatypeArrayInfo,
+//  subItems * DatatypeEntry (each with its own entryLength)
+struct DatatypeEntry
+{
+    quint32 entryLength;
+    quint32 version;
+    quint32 hashValue;
+    quint32 typeHashValue;
+    quint32 size;
+    quint32 offs;
+    quint32 dataType;
+    quint32 flags;
+    quint16 nameLength;
+    quint16 typeLength;
+    quint16 commentLength;
+    quint16 arrayDim;
+    quint16 subItems;
+};
+
+struct DatatypeArrayInfo
+{
+    qint32 lBound;
+    quint32 elements;
+};
+
+#pragma pack(pop)
+
+inline const char* datatypeName(const DatatypeEntry* e)
+{
+    return reinterpret_cast<const char*>(e + 1);
+}
+
+inline const char* datatypeType(const DatatypeEntry* e)
+{
+    return datatypeName(e) + e->nameLength + 1;
+}
+
+inline const char* datatypeComment(const DatatypeEntry* e)
+{
+    return datatypeType(e) + e->typeLength + 1;
+}
+
+inline const DatatypeArrayInfo* datatypeArrayInfo(const DatatypeEntry* e)
+{
+    return reinterpret_cast<const DatatypeArrayInfo*>(datatypeComment(e) + e->commentLength + 1);
+}
+
+inline const DatatypeEntry* datatypeFirstSubItem(const DatatypeEntry* e)
+{
+    return reinterpret_cast<const DatatypeEntry*>(datatypeArrayInfo(e) + e->arrayDim);
+}
+
+inline const DatatypeEntry* datatypeNextSubItem(const DatatypeEntry* e)
+{
+    return reinterpret_cast<const DatatypeEntry*>(reinterpret_cast<const char*>(e) + e->entryLength);
+}
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "qads_global.h"
+#include <QObject>
+#include <QByteArray>
+#include <QPointer>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include "tc3manager.h"
+#include "tc3handle.h"
+
+// Thousands of alarm bits, watched as whole blocks instead of a Tc3Value per bit.
+//
+// A block is a symbol with packed bits (DWORD, ARRAY OF DWORD, WORD, BYTE, ...) or an ARRAY OF
+// BOOL with a byte per alarm. Each block gets a single notification, every sample is compared
+// with the previous image 16 bytes at a time (SSE2 where available), only differing words are
+// scanned bit by bit. Alarms are numbered across all blocks in the order they were added. The
+// edges of all samples of a dispatch are emitted at once with alarmsChanged. Samples arrive in the
+// thread of the manager, the state of the alarms can be queried from any thread
+class QADSSHARED_EXPORT Tc3AlarmMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Layout
+    {
+        Packed,         // bit k of byte j is alarm 8*j + k of the block
+        Bools           // byte j is alarm j of the block, any value but 0 is active
+    };
+
+    enum Edge
+    {
+        Falling,        // cleared
+        Rising          // raised
+    };
+
+    struct Event
+    {
+        quint32 alarm;
+        Edge edge;
+        quint64 timestamp;          // plc timestamp of the sample (FILETIME)
+    };
+    typedef QVector<Event> Events;
+
+    // the monitor must not outlive the manager
+    explicit Tc3AlarmMonitor(Tc3Manager* manager, QObject *parent=nullptr);
+    virtual ~Tc3AlarmMonitor();
+
+    // Index of the first alarm of the block or -1. count is the number of alarms of the block,
+    // -1 takes all bits (bytes for Bools) of the symbol, which has to be resolved then. Alarms
+    // that are active with the first sample are reported as rising edges
+    int add(const QString& symbol, Layout layout, int count=-1, Tc3Manager::NotificationType type=Tc3Manager::NotificationType::Change, int cycleTime_ms=100, int maxDelay_ms=100);
+
+    int count() const;
+    bool isActive(int alarm) const;
+    int activeCount() const;
+    QVector<int> active() const;
+
+    // symbol of the block of an alarm and the number of the alarm within the block
+    QString symbol(int alarm) const;
+    int bit(int alarm) const;
+
+    // Alarm texts are taken from the comments of the block symbols, one line per alarm in the
+    // order of the bits. Lines may start with the number of the bit, e.g. "5: door open".
+    // Returns the number of texts found, comments are read from the plc
+    int loadTexts();
+    QString text(int alarm) const;
+    void setText(int alarm, const QString& text);
+
+signals:
+    void alarmsChanged(const Tc3AlarmMonitor::Events& events);
+
+private slots:
+    void emitEvents();
+
+protected:
+    struct Block
+    {
+        QString symbol;
+        Layout layout;
+        Tc3Handle handle;
+        int first;
+        int count;
+        QByteArray image;           // latest sample, zero padded to a multiple of 16 bytes
+
+        Block();
+    };
+
+    int blockOf(int alarm) const;
+    void update(int block, const char* data, int size, quint64 timestamp);
+
+    QPointer<Tc3Manager> manager_;
+
+    // blocks and their images are written in the dispatch of the manager, pending_ is emitted in
+    // the thread of the monitor
+    mutable QMutex mutex_;
+    QVector<Block> blocks_;
+    QVector<QString> texts_;
+    int count_;
+
+    Events pending_;
+    bool emitPending_;
+};
+
+Q_DECLARE_METATYPE(Tc3AlarmMonitor::Events)
@@ -0,0 +1,111 @@
+#pragma once
+#include "qads_global.h"
+#include "tc3transport.h"
+#include "tc3adsdefs.h"
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QTcpSocket>
+#include <functional>
+
+// AMS/TCP client that keeps many requests in flight on a single connection. The sync ads api of
+// AdsLib and TcAdsDll waits for every response, such that a connection does one request per round
+// trip. Here every request is sent right away and completes with a callback once the response with
+// its invoke id arrives, or with ADSERR_CLIENT_SYNCTIMEOUT after its timeout.
+//
+// Requests can be issued from any thread, the socket, the timeouts and all callbacks run in the
+// thread of the client. At most maxInFlight requests are sent at a time, the others wait in order,
+// such that the router of the plc is not flooded. Like AdsLib on Linux, the client connects to the
+// plc directly and the plc needs a route for the source netid. The router takes one connection per
+// source netid, the client needs a netid of its own, not the one of AdsLib or of another client.
+//
+// The client is not a Tc3Transport, values of Tc3Manager keep using the sync ads api with one
+// request at a time. Tc3Manager::setTransferClient pipelines chunked transfers and the async
+// requests of Tc3Handle (readAsync, writeAsync) through a client
+class QADSSHARED_EXPORT Tc3AmsClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef Tc3Transport::utype utype;
+
+    // errorId is the ads error of the request, data the response of read and readWrite. readState
+    // returns the ads state and the device state as two quint16
+    typedef std::function<void(long errorId, const QByteArray& data)> Callback;
+
+    Tc3AmsClient(const QString& host, const AmsAddr& target, const AmsNetId& source, quint16 sourcePort=32905, QObject *parent=nullptr);
+    virtual ~Tc3AmsClient();
+
+    // connects asynchronously, requests issued before are sent once connected
+    void open();
+    void close();
+    bool isOpen() const;
+
+    void setTimeout(int timeout_ms);
+    int timeout() const;
+    void setMaxInFlight(int count);
+    int maxInFlight() const;
+
+    // requests without a response yet, sent or waiting to be sent
+    int pending() const;
+
+    // return the invoke id of the request, timeout_ms < 0 uses timeout()
+    quint32 read(utype group, utype offset, utype length, const Callback& callback, int timeout_ms=-1);
+    quint32 write(utype group, utype offset, const QByteArray& data, const Callback& callback=Callback(), int timeout_ms=-1);
+    quint32 readWrite(utype group, utype offset, utype readLength, const QByteArray& data, const Callback& callback, int timeout_ms=-1);
+    quint32 readState(const Callback& callback, int timeout_ms=-1);
+
+signals:
+    void opened();
+    void closed();
+    void error(QString);
+
+protected slots:
+    void onStateChanged(QAbstractSocket::SocketState state);
+    void onReadyRead();
+    void flush();
+    void expire();
+
+protected:
+    struct Request
+    {
+        Callback callback;
+        qint64 deadline;    // ms of clock_
+        bool sent;
+    };
+
+    quint32 request(Tc3Ads::Command command, const QByteArray& payload, const Callback& callback, int timeout_ms);
+    void receive(const char* frame, int size);
+    void complete(quint32 invokeId, long errorId, const QByteArray& data);
+    void failAll(long errorId);
+    void scheduleExpiry();
+
+    QString host_;
+    AmsAddr target_;
+    AmsNetId source_;
+    quint16 sourcePort_;
+    int timeout_;
+    int maxInFlight_;
+
+    // owned by the thread of the client
+    QTcpSocket socket_;
+    QByteArray received_;
+    QTimer expiry_;
+    QElapsedTimer clock_;
+
+    // requests are encoded by the caller and sent in the thread of the client. Frames of requests
+    // that timed out before they were sent are skipped
+    mutable QMutex mutex_;
+    quint32 nextInvokeId_;
+    int inFlight_;
+    bool flushPending_;
+    QList<QPair<quint32, QByteArray> > backlog_;
+    QHash<quint32, Request> requests_;
+    QMultiMap<qint64, quint32> deadlines_;
+};
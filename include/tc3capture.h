@@ -0,0 +1,186 @@
+#pragma once
+#include "qads_global.h"
+#include "tc3transport.h"
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QVector>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QAtomicInt>
+
+// Capture files are a header ("QADSCAP" and a version) followed by records. Every record starts
+// with its kind and the time in microseconds since the capture started
+//  Request:      op, group, offset, result, write data, read data
+//  Notification: handle, plc timestamp, sample
+// Notification attributes are stored as write data of AddNotification, the handle as read data
+namespace Tc3Capture
+{
+
+enum Kind : quint8
+{
+    Request = 1,
+    Notification = 2
+};
+
+enum Op : quint8
+{
+    PortOpen = 1,
+    PortClose,
+    ReadState,
+    Read,
+    Write,
+    ReadWrite,
+    AddNotification,
+    DelNotification
+};
+
+const char magic[] = "QADSCAP";
+const quint8 version = 1;
+
+}
+
+// Forwards everything to another transport and records all requests, results and notifications,
+// including the ads state notifications of the manager, in a capture file
+class QADSSHARED_EXPORT Tc3CaptureTransport : public Tc3Transport
+{
+public:
+    // takes ownership of transport, by default the traffic of a real plc is captured
+    explicit Tc3CaptureTransport(const QString& fileName, Tc3Transport* transport=nullptr);
+    virtual ~Tc3CaptureTransport();
+
+    bool isOpen() const;
+
+    long portOpen() override;
+    long portClose(long port) override;
+    long readState(long port, AmsAddr* addr, unsigned short* adsState, unsigned short* deviceState) override;
+    long read(long port, AmsAddr* addr, utype group, utype offset, utype length, void* data, utype* bytesRead) override;
+    long write(long port, AmsAddr* addr, utype group, utype offset, utype length, const void* data) override;
+    long readWrite(long port, AmsAddr* addr, utype group, utype offset, utype readLength, void* readData,
+                   utype writeLength, const void* writeData, utype* bytesRead) override;
+    long addNotification(long port, AmsAddr* addr, utype group, utype offset, const AdsNotificationAttrib* attrib,
+                         PAdsNotificationFuncEx callback, utype userdata, utype* handle) override;
+    long delNotification(long port, AmsAddr* addr, utype handle) override;
+
+protected:
+    void record(Tc3Capture::Op op, utype group, utype offset, long result, const QByteArray& writeData, const QByteArray& readData);
+    void recordNotification(const AdsNotificationHeader* header, const char* data);
+
+    // notifications are routed through onNotification to be recorded, like Tc3Manager::uniqueInst_
+    // routes are identified by an integer userdata
+    struct Route
+    {
+        Tc3CaptureTransport* capture;
+        PAdsNotificationFuncEx callback;
+        utype userdata;
+    };
+
+    // a notification of this capture on the underlying transport, deleted with the capture
+    struct Routed
+    {
+        utype route;
+        long port;
+        AmsAddr addr;
+    };
+
+#ifdef __linux__
+    static void __stdcall onNotification(const AmsAddr *addr, const AdsNotificationHeader *header, utype route);
+#elif _WIN32
+    static void __stdcall onNotification(AmsAddr *addr, AdsNotificationHeader *header, utype route);
+#endif
+
+    Tc3Transport* transport_;
+    QMutex mutex_;
+    QFile file_;
+    QDataStream stream_;
+    QElapsedTimer time_;
+    QHash<utype, Routed> routeByHandle_;
+
+    static QMutex routeMutex_;
+    static QHash<utype, Route> routes_;
+    static utype nroute_;
+};
+
+// Plays a capture back as if it was the plc. Requests are answered with the recorded results of
+// the same request, in the order they have been recorded (the last one repeats), notifications
+// are delivered at their recorded time divided by speed, or as fast as possible if speed <= 0
+class QADSSHARED_EXPORT Tc3ReplayTransport : public Tc3Transport
+{
+public:
+    explicit Tc3ReplayTransport(const QString& fileName, double speed=1.0);
+    virtual ~Tc3ReplayTransport();
+
+    bool isOpen() const;
+    bool isFinished() const;
+
+    long portOpen() override;
+    long portClose(long port) override;
+    long readState(long port, AmsAddr* addr, unsigned short* adsState, unsigned short* deviceState) override;
+    long read(long port, AmsAddr* addr, utype group, utype offset, utype length, void* data, utype* bytesRead) override;
+    long write(long port, AmsAddr* addr, utype group, utype offset, utype length, const void* data) override;
+    long readWrite(long port, AmsAddr* addr, utype group, utype offset, utype readLength, void* readData,
+                   utype writeLength, const void* writeData, utype* bytesRead) override;
+    long addNotification(long port, AmsAddr* addr, utype group, utype offset, const AdsNotificationAttrib* attrib,
+                         PAdsNotificationFuncEx callback, utype userdata, utype* handle) override;
+    long delNotification(long port, AmsAddr* addr, utype handle) override;
+
+protected:
+    struct Response
+    {
+        long result;
+        QByteArray data;
+    };
+
+    struct Sample
+    {
+        quint64 time;
+        utype handle;
+        quint64 timestamp;
+        QByteArray data;
+    };
+
+    struct Subscriber
+    {
+        PAdsNotificationFuncEx callback;
+        utype userdata;
+    };
+
+    class Player : public QThread
+    {
+    public:
+        explicit Player(Tc3ReplayTransport* replay);
+    protected:
+        void run() override;
+        Tc3ReplayTransport* replay_;
+    };
+
+    bool load(const QString& fileName);
+    bool respond(Tc3Capture::Op op, utype group, utype offset, const QByteArray& writeData, Response& response);
+    static QByteArray key(Tc3Capture::Op op, utype group, utype offset, const QByteArray& writeData);
+    void play();
+    bool sleepUntil(const QElapsedTimer& clock, qint64 microseconds);
+
+    double speed_;
+    bool open_;
+    QAtomicInt finished_;
+    QAtomicInt stop_;
+    QMutex mutex_;
+    QWaitCondition subscribed_;
+
+    QHash<QByteArray, QList<Response>> responses_;
+    QHash<QByteArray, int> next_;
+    QVector<Sample> samples_;
+    QSet<utype> recordedHandles_;               // handles that are subscribed at some point of the capture
+    QSet<utype> missingHandles_;                // recorded, but not subscribed in time during the replay
+    QHash<utype, Subscriber> subscribers_;
+    AmsAddr addr_;
+    utype nhandle_;
+
+    Player* player_;
+};
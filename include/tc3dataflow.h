@@ -0,0 +1,112 @@
+#pragma once
+#include "qads_global.h"
+#include <QObject>
+#include <QVariant>
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <functional>
+#include <queue>
+#include <vector>
+
+class Tc3Value;
+class Tc3DataflowGraph;
+
+// Read-only value computed by a Tc3DataflowGraph, with the signal and property of Tc3Value
+class QADSSHARED_EXPORT Tc3DerivedValue : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariant value READ get NOTIFY changed)
+
+    friend class Tc3DataflowGraph;
+
+public:
+    QString name() const;
+    QVariant get() const;
+
+    // invalid while an input is not connected
+    bool isConnected() const;
+
+signals:
+    void changed(const QVariant& v);
+
+protected:
+    Tc3DerivedValue(const QString& name, Tc3DataflowGraph* graph, int node);
+
+    QString name_;
+    Tc3DataflowGraph* graph_;
+    int node_;
+};
+
+// Derived values (interlocks, summaries, counters) computed in C++ from Tc3Value inputs and other
+// derived values, instead of bindings that evaluate whole expressions with every change.
+//
+// Values and functions are nodes of a graph. Derived values can only use existing nodes, so the
+// order of creation is a topological order. A change of an input marks the nodes that use it,
+// the evaluation runs once per dispatch of the manager (all notifications that arrived together)
+// and visits only the marked nodes, in topological order. A node whose result didn't change stops
+// the propagation. changed is emitted after the whole batch has been evaluated, slots never see
+// a mix of old and new results. A node with an invalid input is invalid, without calling its function
+class QADSSHARED_EXPORT Tc3DataflowGraph : public QObject
+{
+    Q_OBJECT
+    friend class Tc3DerivedValue;
+
+public:
+    // the current values of the inputs, in the order they were passed to derive
+    typedef std::function<QVariant(const QVector<QVariant>& inputs)> Function;
+
+    // a Tc3Value or another derived value of the same graph
+    struct Input
+    {
+        Input(Tc3Value* value);
+        Input(Tc3DerivedValue* derived);
+
+        Tc3Value* value;
+        Tc3DerivedValue* derived;
+    };
+
+    explicit Tc3DataflowGraph(QObject *parent=nullptr);
+
+    // e.g. derive("axisReady", { enabled, homed, error }, [](const QVector<QVariant>& in) {
+    //     return in[0].toBool() && in[1].toBool() && !in[2].toBool(); });
+    // The derived value is owned by the graph and computed right away. Names have to be unique
+    Tc3DerivedValue * derive(const QString& name, const QVector<Input>& inputs, const Function& function);
+    Tc3DerivedValue * derived(const QString& name) const;
+    int count() const;
+
+    // nodes evaluated by the last batch, to see how much a change costs
+    int lastEvaluated() const;
+
+public slots:
+    // runs automatically after inputs changed
+    void evaluate();
+
+protected:
+    struct Node
+    {
+        Tc3DerivedValue* output;        // nullptr for Tc3Value inputs
+        QVector<int> inputs;
+        QVector<int> dependents;
+        Function function;
+        QVariant value;
+        bool dirty;
+
+        Node();
+    };
+
+    int inputNode(Tc3Value* value);
+    void setInput(int node, const QVariant& v);
+    void markDependents(int node);
+    QVariant compute(int node, QVector<QVariant>& arguments) const;
+    static bool same(const QVariant& a, const QVariant& b);
+
+    QVector<Node> nodes_;                   // in topological order
+    QHash<Tc3Value*, int> inputs_;
+    QHash<QString, int> names_;
+
+    // dirty nodes, the lowest first
+    std::priority_queue<int, std::vector<int>, std::greater<int> > dirty_;
+    bool evaluatePending_;
+    int lastEvaluated_;
+};
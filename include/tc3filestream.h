@@ -0,0 +1,82 @@
+#pragma once
+#include "qads_global.h"
+#include "tc3amsclient.h"
+#include <QIODevice>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <functional>
+
+// Sequential access to a file on the plc through the system service (FOPEN, FREAD, FWRITE, FCLOSE),
+// e.g. to pull logs and recordings off the IPC without a network share. The requests go through
+// a Tc3AmsClient whose target is the system service of the plc (port Tc3Ads::SystemServicePort),
+// such that readAhead chunks are read ahead while the caller consumes the data, and writes don't
+// wait for each other. The device works like a socket: open() returns immediately, opened() and
+// readyRead() are emitted as data arrives, the waitFor methods block the thread of the client.
+// Files are opened in binary mode, ReadOnly and WriteOnly (optionally with Append) are supported
+class QADSSHARED_EXPORT Tc3FileStream : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    Tc3FileStream(Tc3AmsClient* client, const QString& path, QObject *parent=nullptr);
+    virtual ~Tc3FileStream();
+
+    QString path() const;
+
+    // size of the FREAD and FWRITE requests and number of reads kept in flight
+    void setChunkSize(int size);
+    int chunkSize() const;
+    void setReadAhead(int chunks);
+    int readAhead() const;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override;
+    bool atEnd() const override;
+    qint64 bytesAvailable() const override;
+    qint64 bytesToWrite() const override;
+
+    // true once the plc opened the file
+    bool isReady() const;
+
+    bool waitForOpened(int msecs=30000);
+    bool waitForReadyRead(int msecs) override;
+    bool waitForBytesWritten(int msecs) override;
+
+signals:
+    void opened();
+    void error(QString);
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 size) override;
+
+    void onOpened(long errorId, const QByteArray& data);
+    void onRead(quint64 sequence, long errorId, const QByteArray& data);
+    void onWritten(int size, long errorId);
+    void requestChunks();
+    void sendWrite(const QByteArray& chunk);
+    void fail(long errorId);
+    bool wait(const std::function<bool()>& done, int msecs);
+
+    Tc3AmsClient* client_;
+    QString path_;
+    int chunkSize_;
+    int readAhead_;
+    quint32 handle_;
+    int generation_;        // responses of a previous open are ignored
+
+    // FREADs of one handle are answered in order, chunks are appended by their sequence anyway
+    QByteArray buffer_;
+    int bufferPos_;
+    quint64 nextRead_;
+    quint64 nextAppend_;
+    QMap<quint64, QByteArray> early_;
+    int readsInFlight_;
+    bool eof_;
+
+    QList<QByteArray> queuedWrites_;    // until the file is open
+    qint64 writesPending_;
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include "qads_global.h"
+#include "tc3manager.h"
+#include "tc3valuestore.h"
+#include <QVariant>
+#include <cstring>
+
+// Lean access to a single symbol, e.g. for headless services that register tens of thousands of
+// symbols. A handle is a slot in the value store of the manager, it has no signals and no QObject:
+// samples are passed to a plain callback instead. Handles are cheap to copy, copies refer to the
+// same slot. Tc3Manager::handle and Tc3Manager::release count references, a handle must not be
+// used after it has been released
+class QADSSHARED_EXPORT Tc3Handle
+{
+    friend class Tc3Manager;
+
+public:
+    typedef Tc3ValueStore::Callback Callback;
+
+    Tc3Handle();
+
+    bool isValid() const;
+    bool isConnected() const;
+    QString name() const;
+    int size() const;
+
+    Tc3Manager* manager() const;
+    Tc3ValueStore::Index index() const;
+
+    // queue of reads and writes, see Tc3Manager::Priority. The priority belongs to the slot, it
+    // applies to a Tc3Value of the same symbol as well
+    void setPriority(Tc3Manager::Priority priority);
+
+    // Tc3Manager::samplesReceived counts as a listener, see Tc3Value::setSampled
+    void setSampled(bool sampled);
+
+    QVariant get() const;
+    bool set(const QVariant& v);
+
+    // ads error code or Tc3Manager::ClientError, 0 on success. Failures are neither reported nor
+    // allocate anything, e.g. for polling many values while the plc is stopped
+    long tryGet(QVariant& v) const;
+    long trySet(const QVariant& v);
+
+    // raw image of the symbol, size has to match the size of the symbol
+    bool read(void* data, int size) const;
+    bool write(const void* data, int size);
+
+    // Requests on the connection of Tc3Manager::transferClient, they return right away and the
+    // callback gets the result in the thread of the client. Thousands of them can be in flight,
+    // instead of one request per round trip. Returns 0 if the request was issued, otherwise the
+    // error and the callback is not called. Like tryGet, failures are not reported
+    long readAsync(const Tc3Manager::AsyncCallback& callback) const;
+    long writeAsync(const QByteArray& data, const Tc3Manager::AsyncCallback& callback=Tc3Manager::AsyncCallback());
+
+    // large symbols in chunks, see Tc3Value::readChunked
+    bool readChunked(char* data, qint64 size, const Tc3Manager::Progress& progress=Tc3Manager::Progress(), int chunkSize=0x10000, int parallel=4) const;
+    bool writeChunked(const char* data, qint64 size, const Tc3Manager::Progress& progress=Tc3Manager::Progress(), int chunkSize=0x10000, int parallel=4);
+
+    template<class T>
+    T get() const
+    {
+        T ret;
+        memset(&ret, 0, sizeof(T));
+        read(&ret, sizeof(T));
+        return ret;
+    }
+
+    template<class T>
+    bool set(const T& v)
+    {
+        return write(&v, sizeof(T));
+    }
+
+    // Every notification sample is passed to callback in the thread of the manager, before
+    // Tc3Manager::samplesReceived is emitted. A handle has one callback, subscribing again replaces
+    // it. Other handles and the Tc3Value of the same symbol keep their own callbacks and settings,
+    // one notification on the plc serves all of them with the fastest settings requested
+    void subscribe(const Callback& callback, Tc3Manager::NotificationType type=Tc3Manager::NotificationType::Change, int cycleTime_ms=300, int maxDelay_ms=1000);
+    void unsubscribe();
+
+    // latency of the samples passed to the callback, see Tc3Manager::setLatencyTracking.
+    // acknowledge marks the latest sample as consumed
+    Tc3LatencyHistogram latency(Tc3Manager::LatencyStage stage) const;
+    void acknowledge();
+
+    // raw sample to value, like get
+    QVariant decode(const char* data, int size) const;
+
+protected:
+    Tc3Handle(Tc3Manager* manager, Tc3ValueStore::Index index);
+
+    Tc3Manager* manager_;
+    Tc3ValueStore::Index index_;
+    quint32 token_;             // subscription of this handle, 0 without
+};
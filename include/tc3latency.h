@@ -0,0 +1,37 @@
+#pragma once
+#include "qads_global.h"
+#include <QVector>
+
+// Distribution of latencies in microseconds. Buckets are logarithmic with four buckets per power
+// of two, so a bucket is at most 25% wide and recording costs a few instructions, whatever the
+// range. Percentiles report the upper bound of their bucket. Buckets are allocated with the first
+// sample, histograms of values that never got a sample stay small
+class QADSSHARED_EXPORT Tc3LatencyHistogram
+{
+public:
+    Tc3LatencyHistogram();
+
+    void record(qint64 latency_us);
+    void merge(const Tc3LatencyHistogram& other);
+    void reset();
+
+    quint64 count() const;
+    qint64 min() const;
+    qint64 max() const;
+    qint64 mean() const;
+
+    // e.g. percentile(99) for the latency 99% of the samples stayed below
+    qint64 percentile(double p) const;
+
+protected:
+    enum { SubBuckets = 4, Buckets = 48 * SubBuckets };
+
+    static int bucket(qint64 latency_us);
+    static qint64 upperBound(int bucket);
+
+    QVector<quint32> counts_;
+    quint64 count_;
+    qint64 min_;
+    qint64 max_;
+    qint64 sum_;
+};
@@ -8,7 +8,26 @@
 #include <QVector>
 #include <QList>
 #include <QMutex>
+#include <QWaitCondition>
 #include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QMetaMethod>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QPointer>
+#include "tc3stringcodec.h"
+#include "tc3typeregistry.h"
+#include "tc3symboltable.h"
+#include "tc3symbolbrowser.h"
+#include "tc3sample.h"
+#include "tc3latency.h"
+#include "tc3transport.h"
+#include "tc3adsdefs.h"
+#include "tc3valuestore.h"
+#include "tc3structdiff.h"
+#include <functional>
 
 // use the correct ads defintions, platform depend
 #ifdef __linux__
@@ -20,14 +39,17 @@
 #else
 #endif
 
-
-#define SPSSTRINGLENGTH 256
-
 class Tc3Value;
+class Tc3ValueGroup;
+class Tc3Handle;
+class Tc3AmsClient;
 class QADSSHARED_EXPORT Tc3Manager : public QObject
 {
     Q_OBJECT
     friend class Tc3Value;
+    friend class Tc3Handle;
+    friend class Tc3SymbolBrowser;
+    friend class Tc3ValueGroup;
 
 public:
     #ifdef __linux__
@@ -46,75 +68,526 @@ public:
         Change
     };
 
+    // Requests are queued per priority, such that requests of one priority never wait for
+    // requests of another one. Operator commands and safety relevant values should use High, they
+    // run on a port of their own. Symbol uploads, handles, notifications and the sum requests of
+    // groups and rebinding run with Bulk
+    enum Priority
+    {
+        High,
+        Normal,
+        Bulk
+    };
+
+    enum WriteMode
+    {
+        WriteThrough,   // Tc3Value::set writes to the plc immediately
+        WriteBehind     // Tc3Value::set only stores the value, the latest value of each symbol is written periodically
+    };
+
     struct SymbolInfo
     {
         int group;
         int offset;
         int size;
-        char symbolName[SPSSTRINGLENGTH];
-        char symbolType[SPSSTRINGLENGTH];
-        char symbolComment[SPSSTRINGLENGTH];
+        QString symbolName;
+        QString symbolType;
+        QString symbolComment;
 
         SymbolInfo();
     };
 
+    // response of an async read or write (Tc3Handle::readAsync), data is the image that was read
+    typedef std::function<void(long errorId, const QByteArray& data)> AsyncCallback;
+
+    // progress of chunked transfers, returning false cancels the transfer
+    typedef std::function<bool(qint64 done, qint64 total)> Progress;
+
+    // what failed, see ErrorEvent
+    enum Operation
+    {
+        Connect,
+        Read,
+        Write,
+        Notify,
+        Handle,
+        Release,
+        Symbols
+    };
+
+    // errors detected by the manager itself, negative such that they don't collide with ads errors
+    enum ClientError
+    {
+        NotConnected = -1,
+        SizeMismatch = -2,
+        ConversionFailed = -3,
+        UserTypeAccess = -4
+    };
+
+    // An error of a request, reported at most once per error interval for each code and symbol.
+    // count includes the occurrences that have been suppressed since the previous report
+    struct ErrorEvent
+    {
+        long code;                  // ads error code or ClientError
+        Operation operation;
+        QString symbol;             // empty for errors that don't belong to a value
+        int count;
+
+        ErrorEvent();
+        QString toString() const;
+    };
+
+    // where the time between a change on the plc and its consumer goes, see setLatencyTracking
+    enum LatencyStage
+    {
+        Transport,      // plc timestamp of a sample -> arrival in the notification thread
+        Dispatch,       // arrival -> delivery to callbacks and signals in the thread of the manager
+        Consumer,       // delivery -> Tc3Value::acknowledge, e.g. after the frame has been rendered
+        EndToEnd        // plc timestamp -> acknowledge, or -> delivery for values never acknowledged
+    };
+
+    // a sample that exceeded the latency budget, with the time spent in each stage
+    struct LatencyEvent
+    {
+        QString symbol;
+        qint64 transport_us;
+        qint64 dispatch_us;
+        qint64 consumer_us;         // -1 for values that are not acknowledged
+        qint64 total_us;
+
+        LatencyEvent();
+    };
+
+    // how long the requests of a priority waited for their queue
+    struct LaneStatistics
+    {
+        quint64 requests;
+        qint64 totalWait_us;
+        qint64 maxWait_us;
+
+        LaneStatistics();
+    };
+
+    // memory used for registered symbols and values, in bytes
+    struct MemoryFootprint
+    {
+        int symbols;                // number of symbols in the symbol table
+        int values;                 // number of registered values, with or without Tc3Value
+        int handles;                // symbol handles currently held on the plc, see setHandleCache
+        qint64 symbolTable;         // names, interned types and metadata of all symbols
+        qint64 valueState;          // per value state in the value store and the Tc3Value facades with their QObject data
+        qint64 perSymbol;           // (symbolTable + valueState) / symbols
+    };
+
+    // Blocking connects in the constructor and resolves new values in value() and handle() before
+    // returning. Deferred returns right away, connecting and resolving run in a background thread:
+    // new values are placeholders until their handle and metadata arrive, the values requested in
+    // the meantime are resolved together and emit Tc3Value::ready with their initial value
+    enum ConnectMode
+    {
+        Blocking,
+        Deferred
+    };
+
     Tc3Manager(const QString& amsnetid=QString(), QObject *parent=nullptr);
+
+    // All traffic goes through transport, e.g. to capture a session with Tc3CaptureTransport or to
+    // replay it without a plc with Tc3ReplayTransport. The manager takes ownership
+    Tc3Manager(const QString& amsnetid, Tc3Transport* transport, QObject *parent=nullptr);
+    Tc3Manager(const QString& amsnetid, ConnectMode mode, Tc3Transport* transport=nullptr, QObject *parent=nullptr);
     virtual ~Tc3Manager();
+    ConnectMode connectMode() const;
     Tc3Value * value(const QString& name, int datatypeSizeInByte=Tc3Manager::AutoType, NotificationType notificationType=NotificationType::None, int cycleTime_ms=300, int maxDelay_ms=1000);
     bool isConnected() const;
 
+    // Lean access without a QObject per symbol, see Tc3Handle. Every call adds a reference to the
+    // slot of the symbol, which is shared with a Tc3Value of the same symbol. The handle and
+    // notification on the plc are released with the last reference. A size that differs from the
+    // size of an existing slot of the symbol gets an invalid handle (value returns nullptr then)
+    Tc3Handle handle(const QString& name, int datatypeSizeInByte=Tc3Manager::AutoType);
+    void release(const Tc3Handle& handle);
+
+    // Deleting values and releasing handles only updates the manager, the handles and
+    // notifications on the plc are released in batches by a background thread. These release
+    // many of them at once, e.g. when a screen is closed
+    void release(const QVector<Tc3Handle>& handles);
+    void release(const QList<Tc3Value*>& values);
+
+    // Values of all symbols matching pattern, e.g. GVL.axes[*].actPos, registered in batches
+    // (see Tc3SymbolBrowser::match for the syntax). The group is owned by the manager
+    Tc3ValueGroup * subscribe(const QString& pattern, NotificationType notificationType=NotificationType::None, int cycleTime_ms=300, int maxDelay_ms=1000);
+
+    // In WriteBehind mode, dirty values are written by a background thread every flushInterval_ms
+    // in a single sum request. Values that are set while the plc is not connected are written
+    // after reconnecting
+    void setWriteMode(WriteMode mode, int flushInterval_ms=50);
+    WriteMode writeMode() const;
+    void flushWrites();
+
+    // Notifications are only active on the plc while someone listens: a connection to a signal of
+    // the Tc3Value, a callback of a Tc3Handle or, for values marked with setSampled, a connection to
+    // samplesReceived. They are added when the first listener connects and deleted grace_ms after
+    // the last one disconnected, a negative grace keeps them for the whole life of the value
+    void setNotificationGrace(int grace_ms);
+    int notificationGrace() const;
+
+    // Symbol handles are a cache. The handle of a value without listeners and notification is
+    // released when the value has not been read or written for idle_ms, and least recently used
+    // handles are released while more than capacity handles are held. Released handles are
+    // acquired again on the next access, handles needed at the same time with one sum request.
+    // Negative values disable a limit, both are disabled by default. High priority values keep
+    // their handles
+    void setHandleCache(int capacity, int idle_ms=60000);
+    int handleCacheCapacity() const;
+    int handleCacheIdleTime() const;
+
+    // Encoding of STRING variables, TwinCAT 3 uses Windows-1252 by default
+    void setStringEncoding(Tc3StringCodec::Encoding encoding);
+    Tc3StringCodec::Encoding stringEncoding() const;
+
+    // Comments are not kept in memory, they are read from the plc on every call
+    QString symbolComment(const QString& name);
+    MemoryFootprint memoryFootprint();
+
+    // requests on the ads port, chunked transfers don't go through the lanes and are not counted
+    LaneStatistics laneStatistics(Priority priority) const;
+    void resetLaneStatistics();
+
+    // Errors are counted per code and symbol, the first one is reported right away and the
+    // duplicates of the following interval_ms with a single event. 0 reports every error
+    void setErrorInterval(int interval_ms);
+    int errorInterval() const;
+
+    // Chunked transfers (Tc3Value::readChunked) and async reads and writes (Tc3Handle::readAsync)
+    // go through client if it is open: they are pipelined on its connection instead of waiting for
+    // the ads port. Other requests of the manager keep using the sync ads api, one at a time. The
+    // client needs a source AmsNetId of its own with a route on the plc, the router drops the
+    // connection of the ads api if it is reused. The manager doesn't take ownership
+    void setTransferClient(Tc3AmsClient* client);
+    Tc3AmsClient* transferClient() const;
+
+    // Records the latency of every notification sample per value and stage. The clocks of the plc
+    // and the host don't have to be synchronized, the offset is estimated from the fastest samples
+    // and the round trip time of small probes. latencyExceeded is emitted at most once per second
+    // and value for samples that take longer than budget_ms end to end, 0 disables the budget
+    void setLatencyTracking(bool enabled, int budget_ms=0);
+    bool latencyTracking() const;
+    Tc3LatencyHistogram latency(LatencyStage stage);
+    void resetLatency();
+    qint64 clockOffset();           // host clock - plc clock in microseconds
+
     static constexpr int AutoType = -1; // Automatic Type detection
 
 signals:
     void connectionChanged(bool);
+
+    // errorOccurred and error carry the same rate limited errors, error as text (see
+    // ErrorEvent::toString) and additionally the messages about the connection to the router
     void error(QString);
+    void errorOccurred(const Tc3Manager::ErrorEvent& event);
+    void latencyExceeded(const Tc3Manager::LatencyEvent& event);
+    void symbolsChanged();
+
+    // Every notification sample with its plc timestamp, dispatched in the thread of the manager.
+    // All samples that arrive until the dispatch runs are passed at once, e.g. all samples of a
+    // cycle notification with a small cycle time and a large max delay. A connection only keeps the
+    // notifications of values marked with Tc3Value::setSampled or Tc3Handle::setSampled active,
+    // other values only deliver samples while they have listeners of their own
+    void samplesReceived(const Tc3SampleBatch& samples);
 
 private slots:
     void onConnectionChanged(bool);
+    void onSymbolsChanged();
+    void dispatchSamples();
+    void scheduleIdleNotifications();
+    void releaseIdleNotifications();
+    void evictHandles();
+    void restoreQueuedHandles();
+    void flushErrors();
+    void probeRoundTrip();
 
 protected:
 
     // router specific methods
     unsigned short adsState(long port);
+    long port() const;
     bool connect();
+
+    // deletes the values created by the manager. Handles and other holders of slots stay valid,
+    // their slots are connected again by connect
     void disconnect();
 
     // value/variable specific methods
     htype connectHandle(const QString& name);
     void disconnectHandle(htype);
     SymbolInfo symbolInfo(const QString& name);
+    bool resolveSymbol(Tc3SymbolTable::Id id);
+    long symbolEntry(const QByteArray& name, QByteArray& entry);
+    void setSymbolEntry(Tc3SymbolTable::Id id, const QByteArray& entry);
+    const Tc3TypeDescriptor* typeDescriptor(const QString& typeName, int size);
+    bool datatypeBaseType(const QString& typeName, QString& baseType);
+    QVector<Tc3StructDiff::Field> datatypeMembers(const QString& typeName);
+    bool structLayout(Tc3ValueStore::Index i, Tc3StructDiff& diff);
     htype enableNotify(htype connectHandle, int size, Tc3Manager::NotificationType type, int cycleTimeMillisecond, int maxDelayMilliseconds, PAdsNotificationFuncEx callbackPtr);
     void disableNotify(htype connectHandle);
-    void removeValue(Tc3Value *value);
+    void queueSample(htype notificationHandle, quint64 timestamp, const char* data, int size);
     Tc3Value * value(htype nhandle);
+    QList<Tc3Value*> values(const QVector<Tc3SymbolBrowser::Node>& nodes, NotificationType notificationType, int cycleTime_ms, int maxDelay_ms);
+    Tc3SymbolBrowser * symbolBrowser();
+    void removeGroup(Tc3ValueGroup *group);
+
+    // requests by handle return the ads error code and leave reporting to the caller. High priority
+    // requests go by index group and offset on their own port (highReadReq, highWriteReq)
+    long syncReadReq(htype connectHandle, void *data, int size, Priority priority=Normal);
+    bool syncReadReq(quint32 indexGroup, quint32 indexOffset, void *data, int size, utype *bytesRead);
+    long syncWriteReq(htype connectHandle, const void *data, int size, Priority priority=Normal);
+    long highReadReq(quint32 indexGroup, quint32 indexOffset, void *data, int size);
+    long highWriteReq(quint32 indexGroup, quint32 indexOffset, const void *data, int size);
+    void checkSymbolVersion(long errorId);
+    bool sumHandleReq(const QList<QByteArray>& names, QVector<htype>& handles);
+    bool sumReadReq(const QVector<Tc3Ads::SumRequest>& requests, QByteArray& data, QVector<quint32>& results);
+    bool sumWriteReq(const QVector<Tc3Ads::SumRequest>& requests, const QByteArray& data, QVector<quint32>& results, Priority priority=Bulk);
+
+    // values by slot of the value store, shared by Tc3Value and Tc3Handle
+    Tc3ValueStore::Index indexOf(Tc3SymbolTable::Id id) const;
+    void setIndexOf(Tc3SymbolTable::Id id, Tc3ValueStore::Index i);
+    bool fits(Tc3ValueStore::Index i, int datatypeSizeInByte) const;
+    Tc3ValueStore::Index acquire(const QString& name, int datatypeSizeInByte);
+    void releaseSlot(Tc3ValueStore::Index i);
+    void releaseSymbol(Tc3SymbolTable::Id id);
+    bool holds(Tc3ValueStore::Index i, Tc3SymbolTable::Id id, const QByteArray& name) const;
+    bool connectValue(Tc3ValueStore::Index i);
+    void attachValue(Tc3ValueStore::Index i, htype h);
+    void setFacade(Tc3ValueStore::Index i, Tc3Value* facade);
+    void releaseFacade(Tc3Value* facade);
+    Tc3Value * facade(Tc3ValueStore::Index i);
+    void setNotification(Tc3ValueStore::Index i, NotificationType type, int cycleTimeMillisecond, int maxDelayMillisecond);
+    void mergeNotification(Tc3ValueStore::Index i, NotificationType type, int cycleTimeMillisecond, int maxDelayMillisecond);
+    quint32 addSubscription(Tc3ValueStore::Index i, const Tc3ValueStore::Callback& callback, NotificationType type, int cycleTimeMillisecond, int maxDelayMillisecond);
+    void removeSubscription(Tc3ValueStore::Index i, quint32 token);
+    void applyNotification(Tc3ValueStore::Index i, bool force=false);
+    void setListened(Tc3ValueStore::Index i, bool listened);
+    bool hasListeners(Tc3ValueStore::Index i) const;
+    void updateNotification(Tc3ValueStore::Index i);
+    void activateNotification(Tc3ValueStore::Index i);
+    void deactivateNotification(Tc3ValueStore::Index i);
+    void connectNotify(const QMetaMethod& signal) override;
+    void disconnectNotify(const QMetaMethod& signal) override;
+    void updateSampleListeners();
+    void scheduleEviction();
+    void queueRestore(Tc3ValueStore::Index i);
+    htype restoreHandle(Tc3ValueStore::Index i);
+    void restoreHandles(const QVector<Tc3ValueStore::Index>& indices);
+    void setPriority(Tc3ValueStore::Index i, Priority priority);
+    void setSampled(Tc3ValueStore::Index i, bool sampled);
+    Priority priority(Tc3ValueStore::Index i);
+    bool isValueConnected(Tc3ValueStore::Index i);
+    bool isValueDirty(Tc3ValueStore::Index i);
+    QString valueName(Tc3ValueStore::Index i);
+    int valueSize(Tc3ValueStore::Index i);
+    // ads error code or ClientError, 0 on success. Errors are reported with reportError unless
+    // report is false, such that failing accesses don't allocate anything
+    long readValue(Tc3ValueStore::Index i, QVariant& v, bool* pending=nullptr, bool report=true);
+    long writeValue(Tc3ValueStore::Index i, const QVariant& v, QVariant* written=nullptr, bool report=true);
+    long readRaw(Tc3ValueStore::Index i, void* data, int size, bool report=true);
+    long writeRaw(Tc3ValueStore::Index i, const void* data, int size, bool report=true);
+    void reportError(long code, Operation operation, Tc3SymbolTable::Id symbol=Tc3SymbolTable::InvalidId);
+    void emitError(long code, Operation operation, Tc3SymbolTable::Id symbol, int count);
+    Tc3LatencyHistogram latency(Tc3ValueStore::Index i, LatencyStage stage);
+    void acknowledge(Tc3ValueStore::Index i);
+    void recordDelivery(Tc3ValueStore::Index i, quint64 timestamp, qint64 arrival, qint64 now);
+    void checkLatencyBudget(Tc3ValueStore::Index i, qint64 transport, qint64 dispatch, qint64 consumer, qint64 total);
+    void updateClockOffset();
+    qint64 hostTime() const;
+    bool decodeValue(Tc3ValueStore::Index i, const char* data, int size, QVariant& v);
+    bool transferChunked(Tc3ValueStore::Index i, char* data, qint64 size, bool write, const Progress& progress, int chunkSize, int parallel);
+    long transferPipelined(Tc3AmsClient* client, quint32 group, quint32 offset, char* data, qint64 size, bool write, const Progress& progress, int chunkSize, int parallel, qint64& done);
+    long asyncTarget(Tc3ValueStore::Index i, quint32& group, quint32& offset, int& size, Tc3AmsClient*& client);
+    long readAsync(Tc3ValueStore::Index i, const AsyncCallback& callback);
+    long writeAsync(Tc3ValueStore::Index i, const QByteArray& data, const AsyncCallback& callback);
+
+    // online changes
+    void rebindValues();
+    void releaseHandles(const QVector<htype>& handles);
+
+    // teardown
+    void queueRelease(htype h, htype nh);
+    void processReleases();
+    void startReleaser();
+    void stopReleaser();
+    void emitInitialValues(const QList<Tc3Value*>& facades);
+
+    // deferred connecting and resolving
+    void queueConnect();
+    void connectDeferred();
+    void queueResolve(Tc3ValueStore::Index i);
+    void resolvePending();
+    void completeResolve(const QVector<Tc3ValueStore::Index>& batch, const QVector<Tc3SymbolTable::Id>& ids, const QList<QByteArray>& names, const QVector<htype>& handles, const QVector<QByteArray>& images);
+    void stopResolver();
 
-    bool syncReadReq(htype connectHandle, void *data, int size);
-    bool syncWriteReq(htype connectHandle, const void *data, int size);
+    // write behind
+    void markDirty(Tc3ValueStore::Index i, const QVariant& pending, bool raw=false);
+    void stopFlusher();
 
     // timer for auto reconnected if connected is interrupted
     virtual void timerEvent (QTimerEvent * event);
 
 #ifdef __linux__
     static void __stdcall onConnectionChanged(const AmsAddr *adr, const AdsNotificationHeader *header, utype userdata);
+    static void __stdcall onSymbolVersionChanged(const AmsAddr *adr, const AdsNotificationHeader *header, utype userdata);
+    static void __stdcall onNotification(const AmsAddr *adr, const AdsNotificationHeader *header, utype userdata);
 #elif _WIN32
     static void __stdcall onConnectionChanged(AmsAddr *adr, AdsNotificationHeader *header, utype userdata);
+    static void __stdcall onSymbolVersionChanged(AmsAddr *adr, AdsNotificationHeader *header, utype userdata);
+    static void __stdcall onNotification(AmsAddr *adr, AdsNotificationHeader *header, utype userdata);
 #endif
 
     // Conversions
-    static int tc3ArraySize( const QString& symbolType, int* arrayStart=nullptr);
-    static QVariant::Type tc3VariantType(const QString& symbolType, int size);
     static QString tc3AdsError(long errorId);
 protected:
+    // A queue per priority in front of the ads port. The port takes one request at a time (AdsLib
+    // fails concurrent requests on a port with ADSERR_CLIENT_SYNCPORTLOCKED, TcAdsDll expects a
+    // port per thread), a request holds it while it runs (see LaneLocker). When the port is free,
+    // the oldest request of the highest priority gets it. High runs on highPort_ instead while it
+    // is open, such that it never waits for a long upload or sum request of the other lanes, and
+    // only waits for other high priority requests. Handles belong to the port that acquired them,
+    // high priority requests address values by index group and offset. next and serving are
+    // tickets, guarded by portMutex_
+    struct Lane
+    {
+        quint64 next;
+        quint64 serving;
+        QAtomicInteger<qint64> requests;
+        QAtomicInteger<qint64> wait_ns;
+        QAtomicInteger<qint64> maxWait_ns;
+    };
+    class LaneLocker;
+    class HandleUse;
+
     QMutex mutex_;
-    QList<Tc3Value*> vars_;
+    Lane lanes_[Bulk + 1];
+    QMutex portMutex_;
+    QWaitCondition portFree_;
+    bool portBusy_;
+    bool highBusy_;
+    Tc3ValueStore store_;
+    QVector<Tc3ValueStore::Index> indexById_;       // indexed by Tc3SymbolTable::Id
+    QHash<htype, Tc3ValueStore::Index> notifications_;
+    Tc3SymbolTable symbols_;
     int reconnectTimer_;
     bool connected_;
+    Tc3StringCodec::Encoding stringEncoding_;
+    Tc3TypeRegistry types_;
+    QHash<QString, QVector<Tc3StructDiff::Field> > layouts_;    // members by type name, see structLayout
+
+    // value groups, expanded with the uploaded symbol tables. symbolVersion_ is -1 until the
+    // first notification of the symbol version after connecting
+    QList<Tc3ValueGroup*> groups_;
+    Tc3SymbolBrowser browser_;
+    bool browserValid_;
+    QAtomicInt symbolVersion_;
+    QAtomicInt rebindPending_;      // set with a new symbol version, see rebindValues
+
+    // notifications without listeners, deleted at their deadline (ms of clock_) by idleTimer_
+    int notificationGrace_;
+    quint32 nextToken_;             // of subscriptions, see Tc3ValueStore::Subscription
+    QAtomicInt sampleListeners_;
+    QHash<Tc3ValueStore::Index, qint64> idle_;
+    QTimer idleTimer_;
+    QElapsedTimer clock_;
+
+    // handle cache, evicted values keep their type and get a handle again with restoreHandles
+    int handleCapacity_;
+    int handleIdle_;
+    bool evictPending_;
+    bool restorePending_;
+    QVector<Tc3ValueStore::Index> restore_;     // evicted values that got a listener
+    QTimer cacheTimer_;
+
+    // errors per code and symbol (see errorKey), guarded by errorMutex_ as errors are reported
+    // from any thread. Entries expire after errorInterval_, flushErrors reports the suppressed ones
+    struct ErrorState
+    {
+        qint64 reported;        // ms of clock_
+        int suppressed;
+        Operation operation;
+    };
+    QMutex errorMutex_;
+    QHash<quint64, ErrorState> errors_;
+    int errorInterval_;
+    bool errorFlushPending_;
+    QTimer errorTimer_;
+
+    // samples queued by the notification thread, sampleMutex_ is never held while dispatching
+    QMutex sampleMutex_;
+    Tc3SampleBatch queued_;
+    QVector<htype> queuedHandles_;
+    QVector<qint64> queuedArrivals_;    // hostTime() of each queued sample
+    bool dispatchPending_;
 
-    // Tc3 router connection
+    // notification latency, guarded by mutex_. Times are FILETIME (100 ns), on the host clock
+    // unless named after the plc. The offset is the minimum of arrival - plc timestamp (over the
+    // current and the previous window) minus half of the shortest round trip
+    struct LatencyRecord
+    {
+        Tc3LatencyHistogram stages[EndToEnd + 1];
+        quint64 timestamp;          // plc time of the latest delivered sample
+        qint64 delivered;           // its delivery, 0 once acknowledged
+        qint64 transport;
+        qint64 dispatch;
+        bool acknowledged;          // the consumer acknowledges, EndToEnd ends with acknowledge
+        qint64 reported;            // last latencyExceeded
+
+        LatencyRecord();
+    };
+    QAtomicInt latencyTracking_;
+    qint64 latencyBudget_;
+    QHash<Tc3ValueStore::Index, LatencyRecord> latency_;
+    Tc3LatencyHistogram latencyTotals_[EndToEnd + 1];
+    qint64 clockEpoch_;             // host time when clock_ has been started
+    qint64 clockOffset_;
+    qint64 arrivalWindow_[2];
+    qint64 roundTripWindow_[2];
+    qint64 windowStart_;
+    QTimer probeTimer_;
+
+    // write behind, writeMutex_ guards the pending values and the fields of the value store that
+    // are needed to read and write a value. It is never held during requests, such that reads and
+    // writes don't wait for bulk requests that run while holding mutex_
+    WriteMode writeMode_;
+    QMutex writeMutex_;
+    QList<Tc3ValueStore::Index> dirty_;
+    QThread* flushThread_;
+
+    // handles and notifications to be released on the plc, processed by releaseThread_. The thread
+    // is stopped by disconnect (releaser_ is nullptr then) and started again by connect
+    QMutex releaseMutex_;
+    QVector<htype> releasedHandles_;
+    QVector<htype> releasedNotifications_;
+    bool releasePending_;
+    QThread* releaseThread_;
+    QObject* releaser_;
+
+    // deferred mode, connect and resolvePending run in resolveThread_ (nullptr in blocking mode or
+    // once stopped). unresolved_ are the values waiting for their handle, guarded by mutex_
+    ConnectMode connectMode_;
+    QVector<Tc3ValueStore::Index> unresolved_;
+    bool resolvePending_;
+    QAtomicInt connectPending_;
+    QThread* resolveThread_;
+    QObject* resolver_;
+
+    QPointer<Tc3AmsClient> transferClient_;
+
+    // Tc3 router connection. A deferred connect runs in resolveThread_, the port and the state are
+    // published atomically for requests of other threads, the rest is guarded by mutex_
+    Tc3Transport* transport_;
     AmsAddr	adsadr_;
-    long adsport_;
-    htype mhandle_;
+    QAtomicInteger<long> adsport_;
+    QAtomicInteger<long> highPort_;     // 0 if it could not be opened, High uses adsport_ then
+    QAtomicInteger<htype> mhandle_;
     htype mhandleMem_;
+    htype shandle_;
 
     // We can not use "this" in an ADS callbacks on 64-Bit systems.
     // hence, we need a different way to reference to managers in callbacks.
@@ -127,3 +600,6 @@ protected:
     static utype nid_;
     static QHash<utype, Tc3Manager*> uniqueInst_;
 };
+
+Q_DECLARE_METATYPE(Tc3Manager::ErrorEvent)
+Q_DECLARE_METATYPE(Tc3Manager::LatencyEvent)
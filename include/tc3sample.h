@@ -0,0 +1,51 @@
+#pragma once
+#include "qads_global.h"
+#include <QVector>
+#include <QByteArray>
+#include <QVariant>
+#include <QDateTime>
+#include <QMetaType>
+
+struct Tc3TypeDescriptor;
+
+// One notification sample with the time it was taken on the plc. Batches are passed through queued
+// connections, a sample refers to its value by the slot only, a Tc3Value may be gone by then
+struct QADSSHARED_EXPORT Tc3Sample
+{
+    quint32 index;          // slot in the value store of the manager, see Tc3Handle::index
+    const Tc3TypeDescriptor *type;
+    quint64 timestamp;      // plc time, 100 ns intervals since 1601-01-01 UTC (FILETIME)
+    int offset;             // of the raw image in Tc3SampleBatch
+    int size;
+
+    QDateTime dateTime() const;
+};
+
+// All samples that arrived since the last dispatch, in the order they have been received. The
+// raw images of all samples are stored back to back, a batch is cheap to copy and can be passed
+// through queued connections
+class QADSSHARED_EXPORT Tc3SampleBatch
+{
+    friend class Tc3Manager;
+
+public:
+    int size() const;
+    bool isEmpty() const;
+    const Tc3Sample& at(int i) const;
+    const Tc3Sample& operator[](int i) const;
+    QVector<Tc3Sample>::const_iterator begin() const;
+    QVector<Tc3Sample>::const_iterator end() const;
+
+    // raw image of a sample, and the image decoded like Tc3Value::get
+    const char* data(const Tc3Sample& sample) const;
+    QVariant value(const Tc3Sample& sample) const;
+
+protected:
+    void append(quint64 timestamp, const char* data, int size);
+    void clear();
+
+    QVector<Tc3Sample> samples_;
+    QByteArray data_;
+};
+
+Q_DECLARE_METATYPE(Tc3SampleBatch)
@@ -0,0 +1,164 @@
+#pragma once
+#include "qads_global.h"
+#include "tc3manager.h"
+#include "tc3handle.h"
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+#include <QSharedMemory>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QAtomicInteger>
+#include <QPointer>
+#include <cstring>
+
+// Layout of a shared memory segment of Tc3SharedPublisher, all offsets are relative to the start
+// of the segment and aligned to 8 bytes
+//  Header, count * Entry, names back to back, count * (Slot, size bytes of data)
+// Each slot is a seqlock: the publisher increments the sequence before and after copying a sample,
+// readers copy the data and retry if the sequence was odd or changed in the meantime
+namespace Tc3Shared
+{
+
+const quint32 magic = 0x53444151;   // "QADS"
+const quint32 version = 1;
+
+struct Header
+{
+    quint32 magic;
+    quint32 version;
+    quint32 count;
+    quint32 namesOffset;
+};
+
+struct Entry
+{
+    quint32 nameOffset;     // in the names
+    quint32 nameLength;
+    quint32 slotOffset;
+    quint32 size;
+};
+
+struct Slot
+{
+    QAtomicInteger<quint32> sequence;   // 0 until the first sample, odd while it is written
+    quint32 reserved;
+    quint64 timestamp;                  // plc time of the sample (FILETIME)
+};
+
+inline quint32 align(quint32 offset)
+{
+    return (offset + 7u) & ~7u;
+}
+
+inline const Entry* entries(const void* segment)
+{
+    return reinterpret_cast<const Entry*>(static_cast<const Header*>(segment) + 1);
+}
+
+}
+
+// Publishes symbols of one manager into a shared memory segment, such that several processes on
+// the same machine watch a plc through a single connection. The segment is written from the
+// notification callbacks of Tc3Handle. Writes of subscribers arrive through a local socket with
+// the name of the key and are written with the handles of the publisher, honoring the write mode
+// of the manager. The symbols are fixed when the segment is created
+class QADSSHARED_EXPORT Tc3SharedPublisher : public QObject
+{
+    Q_OBJECT
+
+public:
+    Tc3SharedPublisher(Tc3Manager* manager, const QString& key, const QStringList& names,
+                       Tc3Manager::NotificationType notificationType=Tc3Manager::NotificationType::Change,
+                       int cycleTime_ms=100, int maxDelay_ms=0, QObject *parent=nullptr);
+    virtual ~Tc3SharedPublisher();
+
+    // creates the segment, fails while not all symbols are connected. Can be called again then
+    bool start();
+    bool isStarted() const;
+
+    QString key() const;
+    int count() const;
+
+signals:
+    void error(QString);
+
+protected:
+    void publish(int slot, const char* data, int size, quint64 timestamp);
+    void receive(QLocalSocket* socket);
+
+    QPointer<Tc3Manager> manager_;
+    QString key_;
+    QStringList names_;
+    Tc3Manager::NotificationType notificationType_;
+    int cycleTimeMillisecond_;
+    int maxDelayMillisecond_;
+
+    QVector<Tc3Handle> handles_;
+    QSharedMemory memory_;
+    QLocalServer server_;
+    QHash<QLocalSocket*, QByteArray> received_;
+};
+
+// Reads the segment of a Tc3SharedPublisher in another process. Reads copy straight from the
+// shared memory without any system call or lock, sequence() changes with every sample and can be
+// polled to detect changes. Writes are forwarded to the publisher
+class QADSSHARED_EXPORT Tc3SharedSubscriber : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Tc3SharedSubscriber(const QString& key, QObject *parent=nullptr);
+    virtual ~Tc3SharedSubscriber();
+
+    bool attach();
+    bool isAttached() const;
+
+    int count() const;
+    int indexOf(const QString& name) const;
+    QString name(int slot) const;
+    int size(int slot) const;
+    quint32 sequence(int slot) const;
+
+    // false until the publisher received the first sample of the slot, and if the slot stays locked
+    // by a writer, e.g. because the publisher died while writing it
+    bool read(int slot, void* data, int size, quint64* timestamp=nullptr) const;
+
+    // writes don't block, they are queued until the socket to the publisher is connected. error is
+    // emitted for writes that are dropped because there is no publisher
+    bool write(int slot, const void* data, int size);
+
+    template<class T>
+    T get(int slot) const
+    {
+        T ret;
+        if(!read(slot, &ret, static_cast<int>(sizeof(T))))
+            memset(&ret, 0, sizeof(T));
+
+        return ret;
+    }
+
+    template<class T>
+    bool set(int slot, const T& v)
+    {
+        return write(slot, &v, static_cast<int>(sizeof(T)));
+    }
+
+signals:
+    void error(QString);
+
+protected:
+    const Tc3Shared::Slot* slot(int slot) const;
+    void onStateChanged(QLocalSocket::LocalSocketState state);
+
+    QString key_;
+    QSharedMemory memory_;
+    QLocalSocket socket_;
+    QByteArray queued_;         // writes while connecting
+    const char* segment_;
+    int count_;
+    QHash<QString, int> index_;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include "qads_global.h"
+#include <QString>
+
+// Conversion between the memory image of TwinCAT strings and QString.
+//
+// A STRING(n) occupies n+1 bytes on the PLC, a WSTRING(n) occupies 2*(n+1) bytes.
+// Both are terminated by the first NUL character, the remaining bytes are undefined.
+// STRING is 8 bit per character (Windows-1252 for TwinCAT 3, which is identical to Latin-1
+// except for 0x80-0x9F), WSTRING is little endian UTF-16 independently of the size of wchar_t
+// on the host.
+//
+// All methods work on caller provided buffers and only touch the heap to size the resulting
+// QString, they use SSE2 for scanning and transcoding if it is available.
+class QADSSHARED_EXPORT Tc3StringCodec
+{
+public:
+    enum Encoding
+    {
+        Latin1,
+        Windows1252
+    };
+
+    // Number of bytes before the first NUL byte, or size if there is none
+    static int nulIndex(const char* data, int size);
+
+    // Number of UTF-16 code units before the first NUL code unit, or length if there is none.
+    // data doesn't need to be aligned
+    static int nulIndex16(const char* data, int length);
+
+    // Decode the image of a STRING(n) with size = n+1 bytes
+    static void decodeString(const char* data, int size, QString& out, Encoding encoding);
+
+    // Decode the image of a WSTRING(n) with size = 2*(n+1) bytes
+    static void decodeWString(const char* data, int size, QString& out);
+
+    // Encode text into the image of a STRING(n) with size = n+1 bytes. Text is truncated to n
+    // characters and the remaining bytes are filled with NUL. Characters that can not be
+    // represented are replaced by '?'. Returns the number of characters that have been written
+    static int encodeString(const QString& text, char* data, int size, Encoding encoding);
+
+    // Encode text into the image of a WSTRING(n) with size = 2*(n+1) bytes, the text is
+    // truncated to n code units without splitting surrogate pairs
+    static int encodeWString(const QString& text, char* data, int size);
+};
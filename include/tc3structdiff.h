@@ -0,0 +1,46 @@
+#pragma once
+#include "qads_global.h"
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+
+// Compares consecutive images of a struct and reports which members changed. Images are compared
+// 16 bytes at a time with SSE2 (blocks of 32 bytes otherwise), only 8 byte words that differ are
+// mapped to the members overlapping them, so a notification on a large status struct costs a few
+// word compares when only some members moved. Members may overlap, e.g. in unions
+class QADSSHARED_EXPORT Tc3StructDiff
+{
+public:
+    struct Field
+    {
+        QString name;
+        quint32 offset;
+        quint32 size;
+    };
+
+    Tc3StructDiff();
+
+    void setLayout(const QVector<Field>& fields, int size);
+    bool isValid() const;
+    int size() const;
+    const QVector<Field>& fields() const;
+
+    // indices of all fields that differ from the previous image, all fields for the first image.
+    // The image is kept for the next call, images of a different size are ignored
+    QVector<int> update(const char* data, int size);
+    const QByteArray& image() const;
+    void reset();
+
+protected:
+    void markWord(int word, const char* data, const char* previous);
+
+    QVector<Field> fields_;
+    int size_;
+
+    // the fields overlapping word w are wordFields_[wordStart_[w] .. wordStart_[w+1]-1]
+    QVector<quint32> wordStart_;
+    QVector<quint32> wordFields_;
+
+    QByteArray image_;
+    QVector<quint8> marked_;
+};
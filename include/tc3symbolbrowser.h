@@ -0,0 +1,108 @@
+#pragma once
+#include "qads_global.h"
+#include "tc3adsdefs.h"
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+
+// use the correct ads defintions, platform depend
+#ifdef __linux__
+#include "AdsDef.h"
+#elif _WIN32
+#include <TcAdsDef.h>
+#else
+#endif
+
+class Tc3Manager;
+
+// Read-only view on all symbols of a plc, e.g. for browsing and autocompletion.
+//
+// refresh() uploads the symbol and datatype tables once, everything else works offline on these
+// tables: the browser never creates handles or notifications. Names are indexed in sorted order
+// (case-insensitive, like TwinCAT), prefix search is a binary search on that order and substring
+// search uses a trigram index. Members of structs, function blocks and arrays are not indexed,
+// they are expanded from the datatype table when a node is opened.
+class QADSSHARED_EXPORT Tc3SymbolBrowser
+{
+public:
+    struct Node
+    {
+        QString name;           // full path, e.g. MAIN.axes[3].actPos
+        QString type;           // empty for namespaces, e.g. MAIN
+        QString comment;
+        quint32 group;
+        quint32 offset;
+        quint32 size;
+        bool expandable;
+
+        Node();
+        bool isValid() const;
+    };
+
+    explicit Tc3SymbolBrowser(Tc3Manager* manager);
+
+    bool refresh();
+    int count() const;
+
+    QVector<Node> findPrefix(const QString& prefix, int limit=100) const;
+    QVector<Node> findSubstring(const QString& text, int limit=100) const;
+
+    // any path, members and array elements are resolved from the datatype table
+    Node node(const QString& path) const;
+
+    // children of a namespace, symbol, struct, function block or array. An empty path returns
+    // the top level namespaces. Large arrays can be paged with first and count
+    QVector<Node> children(const QString& path, int first=0, int count=-1) const;
+    QVector<Node> children(const Node& node, int first=0, int count=-1) const;
+
+    // all nodes matching a pattern, e.g. GVL.axes[*].actPos, MAIN.fb*.bBusy or GVL.values[1..10].
+    // Names may contain the wildcards * and ?, indices may be *, a number or a range a..b for
+    // each dimension, [*] selects all elements of multidimensional arrays
+    QVector<Node> match(const QString& pattern) const;
+
+protected:
+    struct ArrayInfo
+    {
+        QVector<int> lowerBounds;
+        QVector<int> elements;
+        QString elementType;
+        int count;
+    };
+
+    const AdsSymbolEntry* entry(int id) const;
+    Node symbolNode(int id) const;
+    Node namespaceNode(const QString& name) const;
+    int lowerBound(const QByteArray& lowerPrefix) const;
+    bool hasPrefix(int id, const QByteArray& lowerPrefix) const;
+    int findSymbol(const QString& name) const;
+
+    const Tc3Ads::DatatypeEntry* datatype(const QString& type) const;
+    bool arrayInfo(const QString& type, ArrayInfo& info) const;
+    bool isExpandable(const QString& type) const;
+    Node member(const Node& parent, const Tc3Ads::DatatypeEntry* item) const;
+    Node element(const Node& parent, const ArrayInfo& info, int index) const;
+    Node child(const Node& parent, const QString& segment) const;
+    Node descend(const Node& parent, const QString& segment) const;
+    bool elementIndices(const ArrayInfo& info, const QString& segment, QVector<int>& indices) const;
+    static bool isWildcard(const QString& segment);
+
+    void buildIndex();
+    static QByteArray lowerLatin1(const QString& text);
+    static quint32 trigram(const char* text);
+
+    Tc3Manager* manager_;
+
+    QByteArray symbols_;                        // raw symbol upload
+    QByteArray datatypes_;                      // raw datatype upload
+    QHash<QString, quint32> datatypeIndex_;     // lowercase type name -> offset in datatypes_
+
+    QVector<quint32> entries_;                  // offset of each symbol in symbols_, sorted by name
+    QByteArray lower_;                          // lowercase names in sorted order, back to back
+    QVector<quint32> lowerOffsets_;             // start of each name in lower_, plus end marker
+
+    // trigram index, the ids of all names containing trigram t are
+    // trigrams_[trigramStart_[t] .. trigramStart_[t+1]-1]
+    QVector<quint32> trigramStart_;
+    QVector<quint32> trigrams_;
+};
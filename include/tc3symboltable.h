@@ -0,0 +1,65 @@
+#pragma once
+#include "qads_global.h"
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+
+// Compact storage for the metadata of all symbols a manager knows about. Names are kept back
+// to back in one arena, type names are interned and comments are not stored at all (see
+// Tc3Manager::symbolComment). A symbol costs about 32 bytes plus the length of its name. Ids of
+// removed symbols are reused, the arena is compacted once most of it belongs to removed names.
+class QADSSHARED_EXPORT Tc3SymbolTable
+{
+public:
+    typedef quint32 Id;
+    enum : quint32 { InvalidId = 0xFFFFFFFFu };
+
+    struct Symbol
+    {
+        quint32 name;           // offset in the name arena
+        quint32 nameLength;
+        quint32 type;           // interned type name, InvalidId until resolved
+        quint32 group;
+        quint32 offset;
+        quint32 size;
+    };
+
+    Tc3SymbolTable();
+
+    // returns the id of name, adds the name if it is not known yet
+    Id insert(const QString& name);
+    Id find(const QString& name) const;
+    void remove(Id id);
+    int count() const;
+
+    const Symbol& symbol(Id id) const;
+    QString name(Id id) const;
+    QString typeName(Id id) const;
+    bool isResolved(Id id) const;
+    void setInfo(Id id, quint32 group, quint32 offset, quint32 size, const char* type, int typeLength);
+
+    // bytes allocated by the table
+    qint64 memoryUsage() const;
+
+protected:
+    static quint32 hash(const QString& name);
+    static quint32 hash(const char* name, int length);
+    bool equals(const Symbol& symbol, const QString& name) const;
+    int slot(const QString& name, quint32 h) const;
+    int home(Id id) const;
+    void rehash(int buckets);
+    void compact();
+    quint32 internType(const char* type, int length);
+
+    QByteArray names_;                  // all symbol names, latin1, without separator
+    int removedBytes_;                  // of removed names, still in names_
+    QVector<Symbol> symbols_;           // removed symbols have name InvalidId
+    QVector<Id> free_;
+    QVector<Id> buckets_;               // open addressing with linear probing
+    int mask_;
+
+    QByteArray types_;                  // all interned type names, NUL separated
+    QVector<quint32> typeOffsets_;
+    QHash<QByteArray, quint32> typeIds_;
+};
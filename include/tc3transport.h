@@ -0,0 +1,56 @@
+#pragma once
+#include "qads_global.h"
+#include <QtGlobal>
+
+// use the correct ads defintions, platform depend
+#ifdef __linux__
+#include "AdsDef.h"
+#define __stdcall
+#elif _WIN32
+#include <TcAdsDef.h>
+#include <TcAdsAPI.h>
+#else
+#endif
+
+// Everything Tc3Manager exchanges with the ads router goes through a transport. The methods
+// mirror the ads api, such that the default transport only forwards the calls. Other transports
+// record the traffic (Tc3CaptureTransport) or play it back without a plc (Tc3ReplayTransport)
+class QADSSHARED_EXPORT Tc3Transport
+{
+public:
+    #ifdef __linux__
+    typedef uint32_t utype;
+    #elif _WIN32
+    typedef unsigned long utype;
+    #else
+    #endif
+
+    virtual ~Tc3Transport();
+
+    virtual long portOpen() = 0;
+    virtual long portClose(long port) = 0;
+    virtual long readState(long port, AmsAddr* addr, unsigned short* adsState, unsigned short* deviceState) = 0;
+    virtual long read(long port, AmsAddr* addr, utype group, utype offset, utype length, void* data, utype* bytesRead) = 0;
+    virtual long write(long port, AmsAddr* addr, utype group, utype offset, utype length, const void* data) = 0;
+    virtual long readWrite(long port, AmsAddr* addr, utype group, utype offset, utype readLength, void* readData,
+                           utype writeLength, const void* writeData, utype* bytesRead) = 0;
+    virtual long addNotification(long port, AmsAddr* addr, utype group, utype offset, const AdsNotificationAttrib* attrib,
+                                 PAdsNotificationFuncEx callback, utype userdata, utype* handle) = 0;
+    virtual long delNotification(long port, AmsAddr* addr, utype handle) = 0;
+};
+
+// AdsLib on Linux, TcAdsDll on Windows
+class QADSSHARED_EXPORT Tc3AdsTransport : public Tc3Transport
+{
+public:
+    long portOpen() override;
+    long portClose(long port) override;
+    long readState(long port, AmsAddr* addr, unsigned short* adsState, unsigned short* deviceState) override;
+    long read(long port, AmsAddr* addr, utype group, utype offset, utype length, void* data, utype* bytesRead) override;
+    long write(long port, AmsAddr* addr, utype group, utype offset, utype length, const void* data) override;
+    long readWrite(long port, AmsAddr* addr, utype group, utype offset, utype readLength, void* readData,
+                   utype writeLength, const void* writeData, utype* bytesRead) override;
+    long addNotification(long port, AmsAddr* addr, utype group, utype offset, const AdsNotificationAttrib* attrib,
+                         PAdsNotificationFuncEx callback, utype userdata, utype* handle) override;
+    long delNotification(long port, AmsAddr* addr, utype handle) override;
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include "qads_global.h"
+#include "tc3manager.h"
+#include "tc3handle.h"
+#include <QPointer>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+// Value with its type fixed at compile time, for REALs as well as user types, e.g.
+// Tc3TypedValue<Plc::ExampleStruct>. Samples are copied straight into T, there is no QVariant on
+// any path. The size of the symbol is checked once when it is connected (see Tc3Manager::error),
+// afterwards a sample is only compared against sizeof(T). Notifications work for user types too.
+// Owns one reference of the slot of the symbol, which is shared with Tc3Value and Tc3Handle. A value
+// that outlives its manager is not connected anymore
+template<class T>
+class Tc3TypedValue
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Tc3TypedValue needs a trivially copyable type");
+
+public:
+    typedef std::function<void(const T&)> Callback;
+
+    Tc3TypedValue(Tc3Manager* manager, const QString& name)
+    {
+        manager_ = manager;
+        handle_ = manager->handle(name, static_cast<int>(sizeof(T)));
+    }
+
+    // the callback may capture the owner of the value, it must not run once the value is gone
+    ~Tc3TypedValue()
+    {
+        if(!isValid())
+            return;
+
+        handle_.unsubscribe();
+        manager_->release(handle_);
+    }
+
+    bool isConnected() const
+    {
+        return isValid() && handle_.isConnected() && handle_.size() == static_cast<int>(sizeof(T));
+    }
+
+    QString name() const
+    {
+        return isValid() ? handle_.name() : QString();
+    }
+
+    const Tc3Handle& handle() const
+    {
+        return handle_;
+    }
+
+    // a value initialized T if the symbol can not be read
+    T get() const
+    {
+        T ret;
+        if(!isValid() || !handle_.read(&ret, static_cast<int>(sizeof(T))))
+            ret = T();
+
+        return ret;
+    }
+
+    bool set(const T& v)
+    {
+        return isValid() && handle_.write(&v, static_cast<int>(sizeof(T)));
+    }
+
+    // every sample is passed to callback in the thread of the manager, see Tc3Handle::subscribe
+    void subscribe(const Callback& callback, Tc3Manager::NotificationType type=Tc3Manager::NotificationType::Change, int cycleTime_ms=300, int maxDelay_ms=1000)
+    {
+        if(!isValid())
+            return;
+
+        handle_.subscribe([callback](const char* data, int size, quint64 timestamp)
+        {
+            Q_UNUSED(timestamp)
+            if(size != static_cast<int>(sizeof(T)))
+                return;
+
+            T v;
+            memcpy(&v, data, sizeof(T));
+            callback(v);
+        }, type, cycleTime_ms, maxDelay_ms);
+    }
+
+    void unsubscribe()
+    {
+        if(isValid())
+            handle_.unsubscribe();
+    }
+
+private:
+    Q_DISABLE_COPY(Tc3TypedValue)
+
+    bool isValid() const
+    {
+        return manager_ && handle_.isValid();
+    }
+
+    QPointer<Tc3Manager> manager_;
+    Tc3Handle handle_;
+};
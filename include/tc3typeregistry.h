@@ -0,0 +1,93 @@
+#pragma once
+#include "qads_global.h"
+#include "tc3stringcodec.h"
+#include <QVariant>
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <functional>
+
+// Precompiled description of a PLC datatype. A descriptor is resolved once when a value connects,
+// afterwards every sample is converted by calling decode/encode directly.
+struct QADSSHARED_EXPORT Tc3TypeDescriptor
+{
+    enum Kind
+    {
+        Bool,
+        SInt,
+        USInt,
+        Int,
+        UInt,
+        DInt,
+        UDInt,
+        LInt,
+        ULInt,
+        Real,
+        LReal,
+        Time,
+        LTime,
+        Date,
+        DateAndTime,
+        TimeOfDay,
+        LDate,
+        LDateAndTime,
+        LTimeOfDay,
+        String,
+        WString,
+        Array,
+        UserType
+    };
+
+    // decode size bytes of data into out, encode in into exactly size bytes of data
+    typedef bool (*DecodeFunc)(const Tc3TypeDescriptor& type, const char* data, int size, QVariant& out);
+    typedef bool (*EncodeFunc)(const Tc3TypeDescriptor& type, const QVariant& in, char* data, int size);
+
+    Kind kind;
+    int size;                               // size in bytes, 0 if it depends on the symbol (UserType)
+    DecodeFunc decode;                      // nullptr for UserType
+    EncodeFunc encode;                      // nullptr for UserType
+
+    const Tc3TypeDescriptor* element;       // arrays only
+    int count;                              // arrays only, number of elements (all dimensions)
+    int lowerBound;                         // arrays only, lower bound of the first dimension
+
+    Tc3StringCodec::Encoding encoding;      // STRING only
+};
+
+// Owns descriptors of a PLC. Elementary types, STRING(n), WSTRING(n), ARRAY, POINTER TO and
+// REFERENCE TO are parsed from the type name, aliases and enumerations are resolved to their
+// base type with a lookup on the PLC's datatype information.
+class QADSSHARED_EXPORT Tc3TypeRegistry
+{
+public:
+    // sets the base type of an alias or an enumeration, an empty string for anything else. Returns
+    // false if the datatype information could not be read, e.g. while the plc doesn't respond
+    typedef std::function<bool(const QString& typeName, QString& baseType)> BaseTypeLookup;
+
+    Tc3TypeRegistry();
+    ~Tc3TypeRegistry();
+
+    // type names are cached, unless a lookup failed
+    const Tc3TypeDescriptor* resolve(const QString& typeName, int size, const BaseTypeLookup& lookup);
+
+    // forgets the resolved type names, e.g. after an online change. Descriptors are shared and
+    // stay valid, values and samples keep using them
+    void clear();
+
+    void setStringEncoding(Tc3StringCodec::Encoding encoding);
+
+    // descriptor for types without automatic conversion, values have to use get<T>/set<T>
+    static const Tc3TypeDescriptor* userType();
+
+protected:
+    const Tc3TypeDescriptor* parse(const QString& typeName, int size, const BaseTypeLookup& lookup, int depth);
+    const Tc3TypeDescriptor* parseArray(const QString& typeName, int size, const BaseTypeLookup& lookup, int depth);
+    const Tc3TypeDescriptor* string(Tc3TypeDescriptor::Kind kind, int size);
+    static const Tc3TypeDescriptor* elementary(const QString& typeName);
+    static const Tc3TypeDescriptor* integer(int size, bool isSigned);
+
+    Tc3StringCodec::Encoding encoding_;
+    QHash<QString, const Tc3TypeDescriptor*> resolved_;
+    QList<Tc3TypeDescriptor*> owned_;
+    bool complete_;                         // all lookups of the current resolve succeeded
+};
@@ -2,6 +2,7 @@
 #include "qads_global.h"
 #include <QObject>
 #include <QVariant>
+#include <QByteArray>
 
 // use the correct ads defintions, platform depend
 #ifdef __linux__
@@ -21,9 +22,11 @@
 #endif
 
 #include "tc3manager.h"
+#include "tc3structdiff.h"
 
 
-
+// Signals and a property for Qt and Qml on top of a slot in the value store of the manager, see
+// Tc3Handle for access without a QObject per value
 class QADSSHARED_EXPORT Tc3Value : public QObject
 {
     Q_OBJECT
@@ -44,10 +47,36 @@ public:
     virtual ~Tc3Value();
 
     void enableNotify(Tc3Manager::NotificationType type, int cycleTimeMillisecond, int maxDelayMillisecond);
+
+    // queue of get and set, high priority values are also written immediately in write behind mode
+    void setPriority(Tc3Manager::Priority priority);
+
+    // Tc3Manager::samplesReceived counts as a listener of the value, its notification stays active
+    // while samplesReceived is connected. Like the priority, this belongs to the symbol
+    void setSampled(bool sampled);
     bool isConnected() const;
+    QString name() const;
+    int size() const;
 
     QVariant get() const;
 
+    // ads error code or Tc3Manager::ClientError, 0 on success, without reporting the error
+    long tryGet(QVariant& v) const;
+    long trySet(const QVariant& v);
+
+    // latency of the notifications of this value, see Tc3Manager::setLatencyTracking
+    Tc3LatencyHistogram latency(Tc3Manager::LatencyStage stage) const;
+
+    // last image received by a notification of a user type, see fieldsChanged
+    QByteArray image() const;
+
+    // Large symbols, e.g. a trace buffer of several MB, in chunks of chunkSize bytes with up to
+    // parallel chunks in flight, straight from or into data (which may be a memory mapped file).
+    // size has to match the symbol. progress is called in the calling thread after every chunk,
+    // returning false cancels the transfer
+    bool readChunked(char* data, qint64 size, const Tc3Manager::Progress& progress=Tc3Manager::Progress(), int chunkSize=0x10000, int parallel=4);
+    bool writeChunked(const char* data, qint64 size, const Tc3Manager::Progress& progress=Tc3Manager::Progress(), int chunkSize=0x10000, int parallel=4);
+
     // disable automatic template deduction, to make this work with QVariant ::get
     template<class T>
     typename Identity<T>::type get() const
@@ -55,24 +84,9 @@ public:
         T ret;
         memset(&ret, 0, sizeof(T));
 
-        if(!isConnected())
-        {
-            emit manager_->error(QString("%1: not connected").arg(name_));
-            return ret;
-        }
-
-
-        if(sizeof(T) != vsymbolinfo_.size)
-        {
-            emit manager_->error(QString("%1: symbolsize not matching template argument (%2b!=%3b)").arg(name_, sizeof(T), vsymbolinfo_.size));
-            return ret;
-        }
+        if(manager_)
+            manager_->readRaw(index_, &ret, sizeof(T));
 
-        if(!manager_->syncReadReq(h_, &ret, vsymbolinfo_.size))
-        {
-            emit manager_->error(QString("%1: error while writing %s").arg(name_));
-            return ret;
-        }
         return ret;
     }
 
@@ -80,60 +94,44 @@ public:
     template<class T>
     void set(typename Identity<const T&>::type v)
     {
-        if(!isConnected())
-        {
-            emit manager_->error(QString("%1: not connected").arg(name_));
-            return;
-        }
-
-        if(sizeof(T) != vsymbolinfo_.size)
-        {
-            emit manager_->error(QString("%1: symbolsize not matching template argument (%2b!=%3b)").arg(name_, sizeof(T), vsymbolinfo_.size));
-            return;
-        }
-
-        if(!manager_->syncWriteReq(h_, &v, vsymbolinfo_.size))
-        {
-            emit manager_->error(QString("%1: error while writing %s").arg(name_));
-            return;
-        }
+        if(manager_)
+            manager_->writeRaw(index_, &v, sizeof(T));
     }
 
 public slots:
     void set(const QVariant& v);
 
+    // the latest value has been consumed, e.g. after the frame showing it has been swapped
+    void acknowledge();
+
 signals:
     void changed(const QVariant& v);
 
-protected:
-    void connect();
-    void invalidate();
-
-    QString name_;
-    mutable QVariant cached_;
-
-    int astart_;
-    int asize_;
+    // Tc3Manager::Deferred only, the symbol has been resolved and the value is connected. changed
+    // has been emitted with the initial value right before (not for user types)
+    void ready();
 
-    Tc3Manager::htype h_;
-    Tc3Manager::SymbolInfo vsymbolinfo_;
+    // Notifications of user types and structs without conversion, with the members that differ
+    // from the previous notification. An empty name stands for the whole image of types without
+    // members. The image is available with image() or can be read with get<T>()
+    void fieldsChanged(const QStringList& fields);
 
-    QVariant::Type variantType_;
-    int vdatasizeInByte_;
+protected:
+    // facade for a slot of the manager, takes over one reference of the slot
+    Tc3Value(Tc3Manager* manager, Tc3ValueStore::Index index, QObject *parent=nullptr);
 
-    Tc3Manager *manager_;
+    void update(const char* data, int size);
+    void updateFields(const char* data, int size);
 
-    Tc3Manager::htype nh_;
-    Tc3Manager::NotificationType notificationType_;
-    int cycleTimeMillisecond_;
-    int maxDelayMillisecond_;
-
-#ifdef __linux__
-    static void __stdcall onNotification(const AmsAddr *addr, const AdsNotificationHeader *header, Tc3Manager::utype userdata);
-#elif _WIN32
-    static void __stdcall onNotification(AmsAddr *addr, AdsNotificationHeader *header, Tc3Manager::utype userdata);
-#endif
+    // the notification of the slot is only active while someone listens to changed or fieldsChanged
+    void connectNotify(const QMetaMethod& signal) override;
+    void disconnectNotify(const QMetaMethod& signal) override;
+    void updateListened();
 
+    mutable QVariant cached_;
+    Tc3StructDiff* diff_;           // user types only, created with the first sample
 
+    Tc3Manager *manager_;
+    Tc3ValueStore::Index index_;
 };
 
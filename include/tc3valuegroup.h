@@ -0,0 +1,44 @@
+#pragma once
+#include "qads_global.h"
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QPointer>
+#include "tc3manager.h"
+
+class Tc3Value;
+
+// All values matching a pattern like GVL.axes[*].actPos (see Tc3SymbolBrowser::match), created
+// by Tc3Manager::subscribe. The pattern is expanded again after reconnecting and after online
+// changes, such that the group always holds the values that currently match. The values are
+// owned by the manager and shared with Tc3Manager::value, values that don't match anymore are
+// released by refresh.
+class QADSSHARED_EXPORT Tc3ValueGroup : public QObject
+{
+    Q_OBJECT
+    friend class Tc3Manager;
+
+public:
+    virtual ~Tc3ValueGroup();
+
+    QString pattern() const;
+    QList<Tc3Value*> values() const;
+    int count() const;
+
+public slots:
+    void refresh();
+
+signals:
+    void membersChanged();
+
+protected:
+    Tc3ValueGroup(const QString& pattern, Tc3Manager* manager, Tc3Manager::NotificationType notificationType, int cycleTimeMillisecond, int maxDelayMillisecond);
+
+    QString pattern_;
+    Tc3Manager *manager_;
+    QList<QPointer<Tc3Value> > values_;     // deleted values turn into nullptr, see values()
+
+    Tc3Manager::NotificationType notificationType_;
+    int cycleTimeMillisecond_;
+    int maxDelayMillisecond_;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include "qads_global.h"
+#include "tc3symboltable.h"
+#include "tc3transport.h"
+#include <QVector>
+#include <QVariant>
+#include <functional>
+
+struct Tc3TypeDescriptor;
+class Tc3Value;
+
+// State of all values of a manager as struct of arrays, indexed by the slot of a value. Loops over
+// many values (dispatching samples, flushing writes, reconnecting) only touch the arrays they need
+// and a value costs no QObject. Slots of released values are reused. Guarded by Tc3Manager::mutex_,
+// except the write behind state which is guarded by Tc3Manager::writeMutex_. Handles, sizes, types
+// and priorities are changed while holding both, reads and writes of values only take writeMutex_
+class QADSSHARED_EXPORT Tc3ValueStore
+{
+public:
+    typedef quint32 Index;
+    enum : quint32 { InvalidIndex = 0xFFFFFFFFu };
+
+    // raw sample and its plc timestamp (see Tc3Sample)
+    typedef std::function<void(const char* data, int size, quint64 timestamp)> Callback;
+
+    // Notification settings requested by one user of a slot, the notification on the plc serves
+    // all of them (see Tc3Manager::applyNotification). Token 0 is the request of value() and the
+    // Tc3Value, it has no callback, the signals of the facade are its listeners
+    struct Subscription
+    {
+        quint32 token;
+        Callback callback;
+        quint8 type;
+        int cycleTime;
+        int maxDelay;
+    };
+
+    Tc3ValueStore();
+
+    // new slot with one reference
+    Index allocate(Tc3SymbolTable::Id symbol, int requestedSize);
+    void release(Index i);
+    bool isValid(Index i) const;
+
+    int count() const;          // slots in use
+    int size() const;           // slots in use and free slots
+    qint64 memoryUsage() const;
+
+    Tc3SymbolTable::Id symbol(Index i) const;
+    bool hasCallbacks(Index i) const;
+
+    QVector<Tc3SymbolTable::Id> symbols;
+    QVector<int> references;                    // 0 for free slots
+    QVector<int> requestedSize;                 // Tc3Manager::AutoType or the size of a user type
+    QVector<Tc3Transport::utype> handles;
+    QVector<Tc3Transport::utype> notifications;
+    QVector<int> sizes;
+    QVector<quint32> groups;                    // index group and offset, high priority requests use them
+    QVector<quint32> offsets;
+    QVector<const Tc3TypeDescriptor*> types;    // nullptr while not connected
+    QVector<quint8> notificationTypes;          // merged settings of all subscriptions
+    QVector<int> cycleTimes;
+    QVector<int> maxDelays;
+    QVector<quint8> priorities;                 // Tc3Manager::Priority of reads and writes
+    QVector<QVector<Subscription> > subscriptions;
+    QVector<Tc3Value*> facades;                 // optional Tc3Value of a slot
+    QVector<bool> listened;                     // a signal of the facade is connected
+    QVector<bool> sampled;                      // Tc3Manager::samplesReceived listens to the slot
+    QVector<qint64> accessed;                   // last read or write, see Tc3Manager::setHandleCache
+    QVector<int> inFlight;                      // requests using the handle, it is not evicted meanwhile
+
+    // write behind
+    QVector<bool> dirty;
+    QVector<bool> pendingRaw;
+    QVector<QVariant> pending;
+
+protected:
+    QVector<Index> free_;
+};
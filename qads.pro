@@ -24,13 +24,49 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    ./source/tc3alarmmonitor.cpp \
+    ./source/tc3amsclient.cpp \
+    ./source/tc3capture.cpp \
+    ./source/tc3dataflow.cpp \
+    ./source/tc3filestream.cpp \
+    ./source/tc3handle.cpp \
+    ./source/tc3latency.cpp \
     ./source/tc3manager.cpp \
-    ./source/tc3value.cpp
+    ./source/tc3sample.cpp \
+    ./source/tc3shared.cpp \
+    ./source/tc3stringcodec.cpp \
+    ./source/tc3structdiff.cpp \
+    ./source/tc3symbolbrowser.cpp \
+    ./source/tc3symboltable.cpp \
+    ./source/tc3transport.cpp \
+    ./source/tc3typeregistry.cpp \
+    ./source/tc3value.cpp \
+    ./source/tc3valuegroup.cpp \
+    ./source/tc3valuestore.cpp
 
 HEADERS += \
         ./include/qads_global.h \
+        ./include/tc3adsdefs.h \
+        ./include/tc3alarmmonitor.h \
+        ./include/tc3amsclient.h \
+        ./include/tc3capture.h \
+        ./include/tc3dataflow.h \
+        ./include/tc3filestream.h \
+        ./include/tc3handle.h \
+        ./include/tc3latency.h \
         ./include/tc3manager.h \
-        ./include/tc3value.h
+        ./include/tc3sample.h \
+        ./include/tc3shared.h \
+        ./include/tc3stringcodec.h \
+        ./include/tc3structdiff.h \
+        ./include/tc3symbolbrowser.h \
+        ./include/tc3symboltable.h \
+        ./include/tc3transport.h \
+        ./include/tc3typedvalue.h \
+        ./include/tc3typeregistry.h \
+        ./include/tc3value.h \
+        ./include/tc3valuegroup.h \
+        ./include/tc3valuestore.h
 
 unix {
     target.path = /usr/lib
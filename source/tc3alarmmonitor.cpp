@@ -0,0 +1,414 @@
+#include <include/tc3alarmmonitor.h>
+#include <QMutexLocker>
+#include <QRegExp>
+#include <QStringList>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QADS_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+// mask must not be 0. The 64 bit intrinsics of MSVC only exist for 64 bit targets, 32 bit
+// builds look at both halves
+inline int firstBit(quint64 mask)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<int>(index);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if(_BitScanForward(&index, static_cast<unsigned long>(mask)))
+        return static_cast<int>(index);
+
+    _BitScanForward(&index, static_cast<unsigned long>(mask >> 32));
+    return static_cast<int>(index) + 32;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+inline int popCount(quint64 mask)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    return static_cast<int>(__popcnt64(mask));
+#elif defined(_MSC_VER) && defined(_M_IX86)
+    return static_cast<int>(__popcnt(static_cast<unsigned int>(mask)) + __popcnt(static_cast<unsigned int>(mask >> 32)));
+#elif defined(_MSC_VER)
+    // ARM has no __popcnt, one step per set bit
+    int n = 0;
+    for(; mask; mask &= mask - 1)
+        n++;
+
+    return n;
+#else
+    return __builtin_popcountll(mask);
+#endif
+}
+
+// up to 8 bytes as little endian word, like the plc stores them
+inline quint64 loadWord(const char* data, int size)
+{
+    quint64 w = 0;
+    memcpy(&w, data, static_cast<size_t>(size));
+    return w;
+}
+
+// one bit per alarm, bit k of w is alarm first + k
+inline void packedEdges(quint64 before, quint64 after, int first, quint64 timestamp, Tc3AlarmMonitor::Events& events)
+{
+    quint64 diff = before ^ after;
+    if(!diff)
+        return;
+
+    events.reserve(events.size() + popCount(diff));
+    while(diff)
+    {
+        const int k = firstBit(diff);
+        events.append({ static_cast<quint32>(first + k), (after >> k) & 1 ? Tc3AlarmMonitor::Rising : Tc3AlarmMonitor::Falling, timestamp });
+        diff &= diff - 1;
+    }
+}
+
+// one byte per alarm, byte k of the mask is set for alarms that changed between 0 and not 0
+inline void boolEdges(quint64 diff, const char* after, int first, quint64 timestamp, Tc3AlarmMonitor::Events& events)
+{
+    events.reserve(events.size() + popCount(diff));
+    while(diff)
+    {
+        const int k = firstBit(diff);
+        events.append({ static_cast<quint32>(first + k), after[k] ? Tc3AlarmMonitor::Rising : Tc3AlarmMonitor::Falling, timestamp });
+        diff &= diff - 1;
+    }
+}
+
+void scanPacked(const char* before, const char* after, int size, int first, quint64 timestamp, Tc3AlarmMonitor::Events& events)
+{
+    int i=0;
+#ifdef QADS_SSE2
+    // most of the image doesn't change, 16 bytes are skipped with a single compare
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 16 <= size; i += 16)
+    {
+        const __m128i x = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(before + i)),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(after + i)));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(x, zero)) == 0xFFFF)
+            continue;
+
+        packedEdges(loadWord(before + i, 8), loadWord(after + i, 8), first + 8*i, timestamp, events);
+        packedEdges(loadWord(before + i + 8, 8), loadWord(after + i + 8, 8), first + 8*(i + 8), timestamp, events);
+    }
+#endif
+    for(; i < size; i += 8)
+    {
+        const int n = std::min(8, size - i);
+        packedEdges(loadWord(before + i, n), loadWord(after + i, n), first + 8*i, timestamp, events);
+    }
+}
+
+void scanBools(const char* before, const char* after, int size, int first, quint64 timestamp, Tc3AlarmMonitor::Events& events)
+{
+    int i=0;
+#ifdef QADS_SSE2
+    // compares whether the bytes are 0, not the bytes, TRUE may be any value
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 16 <= size; i += 16)
+    {
+        const int b = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(before + i)), zero));
+        const int a = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(after + i)), zero));
+        if(a != b)
+            boolEdges(static_cast<quint64>(a ^ b), after + i, first + i, timestamp, events);
+    }
+#endif
+    for(; i < size; i += 8)
+    {
+        const int n = std::min(8, size - i);
+        if(loadWord(before + i, n) == loadWord(after + i, n))
+            continue;
+
+        quint64 diff = 0;
+        for(int k=0; k<n; ++k)
+        {
+            if(!before[i + k] != !after[i + k])
+                diff |= quint64(1) << k;
+        }
+
+        if(diff)
+            boolEdges(diff, after + i, first + i, timestamp, events);
+    }
+}
+
+}
+
+Tc3AlarmMonitor::Block::Block()
+{
+    layout = Packed;
+    first = 0;
+    count = 0;
+}
+
+Tc3AlarmMonitor::Tc3AlarmMonitor(Tc3Manager* manager, QObject *parent/*=nullptr*/) :
+    QObject(parent)
+{
+    manager_ = manager;
+    count_ = 0;
+    emitPending_ = false;
+    qRegisterMetaType<Tc3AlarmMonitor::Events>("Tc3AlarmMonitor::Events");
+}
+
+Tc3AlarmMonitor::~Tc3AlarmMonitor()
+{
+    if(!manager_)
+        return;
+
+    QVector<Tc3Handle> handles;
+    for(int b=0; b<blocks_.size(); ++b)
+    {
+        blocks_[b].handle.unsubscribe();
+        handles.append(blocks_[b].handle);
+    }
+
+    manager_->release(handles);
+}
+
+int Tc3AlarmMonitor::add(const QString& symbol, Tc3AlarmMonitor::Layout layout, int count/*=-1*/, Tc3Manager::NotificationType type/*=Tc3Manager::NotificationType::Change*/, int cycleTime_ms/*=100*/, int maxDelay_ms/*=100*/)
+{
+    if(!manager_)
+        return -1;
+
+    Tc3Handle handle = manager_->handle(symbol);
+    if(count < 0)
+        count = layout == Packed ? 8 * handle.size() : handle.size();
+
+    if(count <= 0)
+    {
+        manager_->release(handle);
+        return -1;
+    }
+
+    Block block;
+    block.symbol = symbol;
+    block.layout = layout;
+    block.handle = handle;
+    block.first = count_;
+    block.count = count;
+
+    // everything is cleared before the first sample
+    const int bytes = layout == Packed ? (count + 7) / 8 : count;
+    block.image.fill(0, (bytes + 15) / 16 * 16);
+
+    int b = 0;
+    {
+        QMutexLocker locker(&mutex_);
+        b = blocks_.size();
+        blocks_.append(block);
+        texts_.resize(count_ + count);
+        count_ += count;
+    }
+
+    // the dispatch holds the lock of the manager while it calls update, subscribe takes it as well.
+    // The block keeps the subscribed copy of the handle, which unsubscribes in the destructor
+    handle.subscribe([this, b](const char* data, int size, quint64 timestamp){ update(b, data, size, timestamp); }, type, cycleTime_ms, maxDelay_ms);
+    {
+        QMutexLocker locker(&mutex_);
+        blocks_[b].handle = handle;
+    }
+    return block.first;
+}
+
+int Tc3AlarmMonitor::count() const
+{
+    QMutexLocker locker(&mutex_);
+    return count_;
+}
+
+bool Tc3AlarmMonitor::isActive(int alarm) const
+{
+    QMutexLocker locker(&mutex_);
+    const int b = blockOf(alarm);
+    if(b < 0)
+        return false;
+
+    const Block& block = blocks_[b];
+    const int k = alarm - block.first;
+    if(block.layout == Bools)
+        return block.image[k] != 0;
+
+    return (static_cast<uchar>(block.image[k / 8]) >> (k % 8)) & 1;
+}
+
+int Tc3AlarmMonitor::activeCount() const
+{
+    // bits beyond the count of a block are masked when a sample is stored
+    QMutexLocker locker(&mutex_);
+    int n = 0;
+    foreach(const Block& block, blocks_)
+    {
+        const char* p = block.image.constData();
+        if(block.layout == Packed)
+        {
+            for(int i=0; i<block.image.size(); i+=8)
+                n += popCount(loadWord(p + i, 8));
+        }
+        else
+        {
+            for(int i=0; i<block.count; ++i)
+                n += p[i] ? 1 : 0;
+        }
+    }
+
+    return n;
+}
+
+QVector<int> Tc3AlarmMonitor::active() const
+{
+    QMutexLocker locker(&mutex_);
+    QVector<int> r;
+    foreach(const Block& block, blocks_)
+    {
+        const char* p = block.image.constData();
+        if(block.layout == Packed)
+        {
+            for(int i=0; i<block.image.size(); i+=8)
+            {
+                quint64 w = loadWord(p + i, 8);
+                while(w)
+                {
+                    r.append(block.first + 8*i + firstBit(w));
+                    w &= w - 1;
+                }
+            }
+        }
+        else
+        {
+            for(int i=0; i<block.count; ++i)
+            {
+                if(p[i])
+                    r.append(block.first + i);
+            }
+        }
+    }
+
+    return r;
+}
+
+QString Tc3AlarmMonitor::symbol(int alarm) const
+{
+    QMutexLocker locker(&mutex_);
+    const int b = blockOf(alarm);
+    return b >= 0 ? blocks_[b].symbol : QString();
+}
+
+int Tc3AlarmMonitor::bit(int alarm) const
+{
+    QMutexLocker locker(&mutex_);
+    const int b = blockOf(alarm);
+    return b >= 0 ? alarm - blocks_[b].first : -1;
+}
+
+int Tc3AlarmMonitor::loadTexts()
+{
+    if(!manager_)
+        return 0;
+
+    static QRegExp numbered("^\\s*(\\d+)\\s*[:=]\\s*(.*)$");
+    int found = 0;
+    foreach(const Block& block, blocks_)
+    {
+        const QStringList lines = manager_->symbolComment(block.symbol).split('\n');
+        int k = 0;
+        foreach(QString line, lines)
+        {
+            line = line.trimmed();
+            if(line.isEmpty())
+                continue;
+
+            if(numbered.exactMatch(line))
+            {
+                k = numbered.cap(1).toInt();
+                line = numbered.cap(2);
+            }
+
+            if(k >= 0 && k < block.count)
+            {
+                texts_[block.first + k] = line;
+                found++;
+            }
+            k++;
+        }
+    }
+
+    return found;
+}
+
+QString Tc3AlarmMonitor::text(int alarm) const
+{
+    return alarm >= 0 && alarm < texts_.size() ? texts_[alarm] : QString();
+}
+
+void Tc3AlarmMonitor::setText(int alarm, const QString& text)
+{
+    if(alarm >= 0 && alarm < texts_.size())
+        texts_[alarm] = text;
+}
+
+void Tc3AlarmMonitor::emitEvents()
+{
+    Events events;
+    {
+        QMutexLocker locker(&mutex_);
+        emitPending_ = false;
+        events.swap(pending_);
+    }
+
+    if(!events.isEmpty())
+        emit alarmsChanged(events);
+}
+
+int Tc3AlarmMonitor::blockOf(int alarm) const
+{
+    if(alarm < 0 || alarm >= count_)
+        return -1;
+
+    // blocks are numbered without gaps, the last block starting at or before alarm
+    auto it = std::upper_bound(blocks_.constBegin(), blocks_.constEnd(), alarm, [](int a, const Block& block) { return a < block.first; });
+    return static_cast<int>(it - blocks_.constBegin()) - 1;
+}
+
+// called by the manager for every sample while dispatching, the edges of all samples of the
+// dispatch are emitted together afterwards
+void Tc3AlarmMonitor::update(int block, const char* data, int size, quint64 timestamp)
+{
+    QMutexLocker locker(&mutex_);
+    Block& b = blocks_[block];
+    const int bytes = b.layout == Packed ? (b.count + 7) / 8 : b.count;
+
+    // the image is zero padded, samples shorter than the block leave the missing alarms cleared
+    QByteArray& image = b.image;
+    QByteArray sample(image.size(), 0);
+    memcpy(sample.data(), data, static_cast<size_t>(std::min(size, bytes)));
+    if(b.layout == Packed && b.count % 8)
+        sample[bytes - 1] = static_cast<char>(sample[bytes - 1] & ((1 << (b.count % 8)) - 1));
+
+    if(b.layout == Packed)
+        scanPacked(image.constData(), sample.constData(), image.size(), b.first, timestamp, pending_);
+    else
+        scanBools(image.constData(), sample.constData(), image.size(), b.first, timestamp, pending_);
+
+    image = sample;
+
+    if(emitPending_ || pending_.isEmpty())
+        return;
+
+    emitPending_ = true;
+    QMetaObject::invokeMethod(this, "emitEvents", Qt::QueuedConnection);
+}
@@ -0,0 +1,376 @@
+#include <include/tc3amsclient.h>
+#include <QMutexLocker>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+
+// larger frames can only be garbage, the plc never sends more than a few MB at once
+const quint32 maxFrameLength = 0x4000000;
+
+}
+
+Tc3AmsClient::Tc3AmsClient(const QString& host, const AmsAddr& target, const AmsNetId& source, quint16 sourcePort/*=32905*/, QObject *parent/*=nullptr*/) :
+    QObject(parent),
+    host_(host),
+    target_(target),
+    source_(source),
+    sourcePort_(sourcePort),
+    socket_(this),
+    expiry_(this)
+{
+    timeout_ = 5000;
+    maxInFlight_ = 1024;
+    nextInvokeId_ = 1;
+    inFlight_ = 0;
+    flushPending_ = false;
+    clock_.start();
+
+    expiry_.setSingleShot(true);
+    QObject::connect(&socket_, &QTcpSocket::stateChanged, this, &Tc3AmsClient::onStateChanged);
+    QObject::connect(&socket_, &QTcpSocket::readyRead, this, &Tc3AmsClient::onReadyRead);
+    QObject::connect(&expiry_, &QTimer::timeout, this, &Tc3AmsClient::expire);
+}
+
+Tc3AmsClient::~Tc3AmsClient()
+{
+    // pending callbacks are dropped, they may refer to objects that are destroyed as well
+    QObject::disconnect(&socket_, nullptr, this, nullptr);
+    socket_.abort();
+}
+
+void Tc3AmsClient::open()
+{
+    if(socket_.state() == QAbstractSocket::UnconnectedState)
+        socket_.connectToHost(host_, Tc3Ads::AmsTcpPort);
+}
+
+void Tc3AmsClient::close()
+{
+    socket_.disconnectFromHost();
+}
+
+bool Tc3AmsClient::isOpen() const
+{
+    return socket_.state() == QAbstractSocket::ConnectedState;
+}
+
+void Tc3AmsClient::setTimeout(int timeout_ms)
+{
+    QMutexLocker locker(&mutex_);
+    timeout_ = timeout_ms;
+}
+
+int Tc3AmsClient::timeout() const
+{
+    QMutexLocker locker(&mutex_);
+    return timeout_;
+}
+
+void Tc3AmsClient::setMaxInFlight(int count)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        maxInFlight_ = std::max(1, count);
+    }
+
+    QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+}
+
+int Tc3AmsClient::maxInFlight() const
+{
+    QMutexLocker locker(&mutex_);
+    return maxInFlight_;
+}
+
+int Tc3AmsClient::pending() const
+{
+    QMutexLocker locker(&mutex_);
+    return requests_.size();
+}
+
+quint32 Tc3AmsClient::read(utype group, utype offset, utype length, const Callback& callback, int timeout_ms/*=-1*/)
+{
+    const quint32 header[] = { static_cast<quint32>(group), static_cast<quint32>(offset), static_cast<quint32>(length) };
+    return request(Tc3Ads::Read, QByteArray(reinterpret_cast<const char*>(header), sizeof(header)), callback, timeout_ms);
+}
+
+quint32 Tc3AmsClient::write(utype group, utype offset, const QByteArray& data, const Callback& callback/*=Callback()*/, int timeout_ms/*=-1*/)
+{
+    const quint32 header[] = { static_cast<quint32>(group), static_cast<quint32>(offset), static_cast<quint32>(data.size()) };
+    QByteArray payload(reinterpret_cast<const char*>(header), sizeof(header));
+    payload.append(data);
+    return request(Tc3Ads::Write, payload, callback, timeout_ms);
+}
+
+quint32 Tc3AmsClient::readWrite(utype group, utype offset, utype readLength, const QByteArray& data, const Callback& callback, int timeout_ms/*=-1*/)
+{
+    const quint32 header[] = { static_cast<quint32>(group), static_cast<quint32>(offset), static_cast<quint32>(readLength), static_cast<quint32>(data.size()) };
+    QByteArray payload(reinterpret_cast<const char*>(header), sizeof(header));
+    payload.append(data);
+    return request(Tc3Ads::ReadWrite, payload, callback, timeout_ms);
+}
+
+quint32 Tc3AmsClient::readState(const Callback& callback, int timeout_ms/*=-1*/)
+{
+    return request(Tc3Ads::ReadState, QByteArray(), callback, timeout_ms);
+}
+
+// encodes the frame in the calling thread, it is sent by flush in the thread of the client
+quint32 Tc3AmsClient::request(Tc3Ads::Command command, const QByteArray& payload, const Callback& callback, int timeout_ms)
+{
+    QMutexLocker locker(&mutex_);
+
+    // invoke ids that are still in use after wrapping around are skipped
+    quint32 invokeId = nextInvokeId_++;
+    while(!invokeId || requests_.contains(invokeId))
+        invokeId = nextInvokeId_++;
+
+    Tc3Ads::AmsTcpHeader tcp;
+    tcp.reserved = 0;
+    tcp.length = static_cast<quint32>(sizeof(Tc3Ads::AmsHeader)) + static_cast<quint32>(payload.size());
+
+    Tc3Ads::AmsHeader ams;
+    memcpy(ams.targetNetId, target_.netId.b, sizeof(ams.targetNetId));
+    ams.targetPort = target_.port;
+    memcpy(ams.sourceNetId, source_.b, sizeof(ams.sourceNetId));
+    ams.sourcePort = sourcePort_;
+    ams.command = command;
+    ams.stateFlags = Tc3Ads::CommandFlag;
+    ams.length = static_cast<quint32>(payload.size());
+    ams.errorCode = 0;
+    ams.invokeId = invokeId;
+
+    QByteArray frame;
+    frame.reserve(static_cast<int>(sizeof(tcp) + sizeof(ams)) + payload.size());
+    frame.append(reinterpret_cast<const char*>(&tcp), sizeof(tcp));
+    frame.append(reinterpret_cast<const char*>(&ams), sizeof(ams));
+    frame.append(payload);
+
+    Request r = { callback, clock_.elapsed() + (timeout_ms < 0 ? timeout_ : timeout_ms), false };
+    requests_.insert(invokeId, r);
+    deadlines_.insert(r.deadline, invokeId);
+    backlog_.append(qMakePair(invokeId, frame));
+
+    // whatever is issued until the client gets to it is written at once
+    if(!flushPending_)
+    {
+        flushPending_ = true;
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+    }
+
+    return invokeId;
+}
+
+void Tc3AmsClient::flush()
+{
+    QByteArray frames;
+    {
+        QMutexLocker locker(&mutex_);
+        flushPending_ = false;
+
+        // requests issued while not connected are sent once connected, or time out
+        while(isOpen() && !backlog_.isEmpty() && inFlight_ < maxInFlight_)
+        {
+            const QPair<quint32, QByteArray> f = backlog_.takeFirst();
+            auto it = requests_.find(f.first);
+            if(it == requests_.end())
+                continue;
+
+            it->sent = true;
+            ++inFlight_;
+            frames.append(f.second);
+        }
+    }
+
+    scheduleExpiry();
+    if(!frames.isEmpty())
+        socket_.write(frames);
+}
+
+void Tc3AmsClient::onStateChanged(QAbstractSocket::SocketState state)
+{
+    if(state == QAbstractSocket::ConnectedState)
+    {
+        // requests are small and latency matters, don't let nagle hold them back
+        socket_.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        emit opened();
+        flush();
+    }
+    else if(state == QAbstractSocket::UnconnectedState)
+    {
+        // responses of sent requests will never arrive
+        received_.clear();
+        failAll(ADSERR_CLIENT_PORTNOTOPEN);
+        emit closed();
+    }
+}
+
+void Tc3AmsClient::onReadyRead()
+{
+    received_.append(socket_.readAll());
+
+    // callbacks may close the client, which clears received_
+    const int headerSize = static_cast<int>(sizeof(Tc3Ads::AmsTcpHeader));
+    int at = 0;
+    while(received_.size() - at >= headerSize)
+    {
+        const Tc3Ads::AmsTcpHeader* tcp = reinterpret_cast<const Tc3Ads::AmsTcpHeader*>(received_.constData() + at);
+        if(tcp->length > maxFrameLength)
+        {
+            emit error(QString("%1: invalid AMS/TCP frame of %2 bytes").arg(host_).arg(tcp->length));
+            socket_.abort();
+            return;
+        }
+
+        const int length = static_cast<int>(tcp->length);
+        if(received_.size() - at - headerSize < length)
+            break;
+
+        // frames of the router itself (reserved != 0) are not of interest
+        if(!tcp->reserved)
+            receive(received_.constData() + at + headerSize, length);
+
+        at += headerSize + length;
+    }
+
+    received_.remove(0, std::min(at, received_.size()));
+
+    // responses made room for waiting requests
+    flush();
+}
+
+void Tc3AmsClient::receive(const char* frame, int size)
+{
+    if(size < static_cast<int>(sizeof(Tc3Ads::AmsHeader)))
+        return;
+
+    // notifications and requests of the plc are not handled here
+    const Tc3Ads::AmsHeader* ams = reinterpret_cast<const Tc3Ads::AmsHeader*>(frame);
+    if(!(ams->stateFlags & Tc3Ads::ResponseFlag))
+        return;
+
+    const quint32 invokeId = ams->invokeId;
+    if(ams->errorCode)
+    {
+        complete(invokeId, static_cast<long>(ams->errorCode), QByteArray());
+        return;
+    }
+
+    // every response starts with the ads result, read and readWrite continue with the length
+    const char* data = frame + sizeof(Tc3Ads::AmsHeader);
+    const int length = std::min(static_cast<int>(ams->length), size - static_cast<int>(sizeof(Tc3Ads::AmsHeader)));
+    if(length < static_cast<int>(sizeof(quint32)))
+    {
+        complete(invokeId, ADSERR_CLIENT_SYNCRESINVALID, QByteArray());
+        return;
+    }
+
+    quint32 result;
+    memcpy(&result, data, sizeof(result));
+
+    switch(ams->command)
+    {
+    case Tc3Ads::Read:
+    case Tc3Ads::ReadWrite:
+    {
+        if(length < static_cast<int>(2 * sizeof(quint32)))
+        {
+            complete(invokeId, ADSERR_CLIENT_SYNCRESINVALID, QByteArray());
+            break;
+        }
+
+        quint32 n;
+        memcpy(&n, data + sizeof(quint32), sizeof(n));
+        const int available = length - static_cast<int>(2 * sizeof(quint32));
+        complete(invokeId, static_cast<long>(result), QByteArray(data + 2 * sizeof(quint32), std::min(static_cast<int>(n), available)));
+        break;
+    }
+    case Tc3Ads::ReadState:
+        complete(invokeId, static_cast<long>(result), QByteArray(data + sizeof(quint32), length - static_cast<int>(sizeof(quint32))));
+        break;
+    default:
+        complete(invokeId, static_cast<long>(result), QByteArray());
+        break;
+    }
+}
+
+// late responses of requests that timed out are dropped
+void Tc3AmsClient::complete(quint32 invokeId, long errorId, const QByteArray& data)
+{
+    Callback callback;
+    {
+        QMutexLocker locker(&mutex_);
+        auto it = requests_.find(invokeId);
+        if(it == requests_.end())
+            return;
+
+        callback = it->callback;
+        if(it->sent)
+            --inFlight_;
+
+        deadlines_.remove(it->deadline, invokeId);
+        requests_.erase(it);
+    }
+
+    if(callback)
+        callback(errorId, data);
+}
+
+void Tc3AmsClient::expire()
+{
+    QList<quint32> expired;
+    {
+        QMutexLocker locker(&mutex_);
+        const qint64 now = clock_.elapsed();
+        while(!deadlines_.isEmpty() && deadlines_.firstKey() <= now)
+        {
+            auto it = deadlines_.begin();
+            expired.append(it.value());
+            deadlines_.erase(it);
+        }
+    }
+
+    foreach(quint32 invokeId, expired)
+        complete(invokeId, ADSERR_CLIENT_SYNCTIMEOUT, QByteArray());
+
+    // expired requests that have been sent made room for waiting ones
+    flush();
+}
+
+void Tc3AmsClient::failAll(long errorId)
+{
+    QList<Callback> callbacks;
+    {
+        QMutexLocker locker(&mutex_);
+        foreach(const Request& r, requests_)
+            callbacks.append(r.callback);
+
+        requests_.clear();
+        deadlines_.clear();
+        backlog_.clear();
+        inFlight_ = 0;
+    }
+
+    scheduleExpiry();
+    foreach(const Callback& callback, callbacks)
+    {
+        if(callback)
+            callback(errorId, QByteArray());
+    }
+}
+
+// the timer runs until the earliest deadline, it is restarted whenever requests are sent
+void Tc3AmsClient::scheduleExpiry()
+{
+    QMutexLocker locker(&mutex_);
+    if(deadlines_.isEmpty())
+    {
+        expiry_.stop();
+        return;
+    }
+
+    const qint64 wait = deadlines_.firstKey() - clock_.elapsed();
+    expiry_.start(static_cast<int>(std::max<qint64>(0, wait)));
+}
@@ -0,0 +1,562 @@
+#include <include/tc3capture.h>
+#include <QMutexLocker>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+
+// in fast replays, the player waits this long for the subscription of a recorded notification
+const qint64 subscribeTimeout = 1000;
+
+// handles of notifications that are not part of the capture
+const Tc3Transport::utype unknownHandleBase = 0x80000000u;
+
+QByteArray handleData(Tc3Transport::utype handle)
+{
+    const quint32 h = static_cast<quint32>(handle);
+    return QByteArray(reinterpret_cast<const char*>(&h), sizeof(h));
+}
+
+}
+
+/*static*/
+QMutex Tc3CaptureTransport::routeMutex_;
+
+/*static*/
+QHash<Tc3Transport::utype, Tc3CaptureTransport::Route> Tc3CaptureTransport::routes_;
+
+/*static*/
+Tc3Transport::utype Tc3CaptureTransport::nroute_ = 0;
+
+Tc3CaptureTransport::Tc3CaptureTransport(const QString& fileName, Tc3Transport* transport/*=nullptr*/)
+{
+    transport_ = transport ? transport : new Tc3AdsTransport();
+
+    file_.setFileName(fileName);
+    if(file_.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        stream_.setDevice(&file_);
+        stream_.writeRawData(Tc3Capture::magic, static_cast<int>(sizeof(Tc3Capture::magic)) - 1);
+        stream_ << Tc3Capture::version;
+    }
+
+    time_.start();
+}
+
+Tc3CaptureTransport::~Tc3CaptureTransport()
+{
+    // notifications that are still active are not routed anymore. onNotification holds routeMutex_
+    // while it uses a route, none of them is running once they are removed
+    {
+        QMutexLocker locker(&routeMutex_);
+        for(auto it=routes_.begin(); it!=routes_.end();)
+        {
+            if(it.value().capture == this)
+                it = routes_.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    // the underlying transport must not call onNotification for them after it is deleted
+    QHash<utype, Routed> routed;
+    {
+        QMutexLocker locker(&mutex_);
+        routed.swap(routeByHandle_);
+    }
+    for(auto it=routed.begin(); it!=routed.end(); ++it)
+        transport_->delNotification(it.value().port, &it.value().addr, it.key());
+
+    delete transport_;
+
+    QMutexLocker locker(&mutex_);
+    file_.close();
+}
+
+bool Tc3CaptureTransport::isOpen() const
+{
+    return file_.isOpen();
+}
+
+long Tc3CaptureTransport::portOpen()
+{
+    const long port = transport_->portOpen();
+    record(Tc3Capture::PortOpen, 0, 0, port, QByteArray(), QByteArray());
+    return port;
+}
+
+long Tc3CaptureTransport::portClose(long port)
+{
+    const long result = transport_->portClose(port);
+    record(Tc3Capture::PortClose, 0, 0, result, QByteArray(), QByteArray());
+    return result;
+}
+
+long Tc3CaptureTransport::readState(long port, AmsAddr* addr, unsigned short* adsState, unsigned short* deviceState)
+{
+    const long result = transport_->readState(port, addr, adsState, deviceState);
+
+    QByteArray state;
+    if(!result)
+    {
+        state.append(reinterpret_cast<const char*>(adsState), sizeof(*adsState));
+        state.append(reinterpret_cast<const char*>(deviceState), sizeof(*deviceState));
+    }
+    record(Tc3Capture::ReadState, 0, 0, result, QByteArray(), state);
+    return result;
+}
+
+long Tc3CaptureTransport::read(long port, AmsAddr* addr, utype group, utype offset, utype length, void* data, utype* bytesRead)
+{
+    utype n = length;
+    const long result = transport_->read(port, addr, group, offset, length, data, &n);
+    if(bytesRead)
+        *bytesRead = n;
+
+    record(Tc3Capture::Read, group, offset, result, QByteArray(), result ? QByteArray() : QByteArray(static_cast<const char*>(data), static_cast<int>(n)));
+    return result;
+}
+
+long Tc3CaptureTransport::write(long port, AmsAddr* addr, utype group, utype offset, utype length, const void* data)
+{
+    const long result = transport_->write(port, addr, group, offset, length, data);
+    record(Tc3Capture::Write, group, offset, result, QByteArray::fromRawData(static_cast<const char*>(data), static_cast<int>(length)), QByteArray());
+    return result;
+}
+
+long Tc3CaptureTransport::readWrite(long port, AmsAddr* addr, utype group, utype offset, utype readLength, void* readData,
+                                    utype writeLength, const void* writeData, utype* bytesRead)
+{
+    utype n = readLength;
+    const long result = transport_->readWrite(port, addr, group, offset, readLength, readData, writeLength, writeData, &n);
+    if(bytesRead)
+        *bytesRead = n;
+
+    record(Tc3Capture::ReadWrite, group, offset, result, QByteArray::fromRawData(static_cast<const char*>(writeData), static_cast<int>(writeLength)),
+           result ? QByteArray() : QByteArray(static_cast<const char*>(readData), static_cast<int>(n)));
+    return result;
+}
+
+long Tc3CaptureTransport::addNotification(long port, AmsAddr* addr, utype group, utype offset, const AdsNotificationAttrib* attrib,
+                                          PAdsNotificationFuncEx callback, utype userdata, utype* handle)
+{
+    utype route;
+    {
+        QMutexLocker locker(&routeMutex_);
+        route = nroute_++;
+        routes_.insert(route, { this, callback, userdata });
+    }
+
+    const long result = transport_->addNotification(port, addr, group, offset, attrib, onNotification, route, handle);
+    if(result)
+    {
+        QMutexLocker locker(&routeMutex_);
+        routes_.remove(route);
+    }
+    else
+    {
+        QMutexLocker locker(&mutex_);
+        routeByHandle_.insert(*handle, { route, port, *addr });
+    }
+
+    record(Tc3Capture::AddNotification, group, offset, result, QByteArray(reinterpret_cast<const char*>(attrib), sizeof(AdsNotificationAttrib)),
+           result ? QByteArray() : handleData(*handle));
+    return result;
+}
+
+long Tc3CaptureTransport::delNotification(long port, AmsAddr* addr, utype handle)
+{
+    const long result = transport_->delNotification(port, addr, handle);
+    record(Tc3Capture::DelNotification, 0, handle, result, QByteArray(), QByteArray());
+
+    utype route;
+    {
+        QMutexLocker locker(&mutex_);
+        if(!routeByHandle_.contains(handle))
+            return result;
+
+        route = routeByHandle_.take(handle).route;
+    }
+
+    QMutexLocker locker(&routeMutex_);
+    routes_.remove(route);
+    return result;
+}
+
+void Tc3CaptureTransport::record(Tc3Capture::Op op, utype group, utype offset, long result, const QByteArray& writeData, const QByteArray& readData)
+{
+    QMutexLocker locker(&mutex_);
+    if(!file_.isOpen())
+        return;
+
+    stream_ << static_cast<quint8>(Tc3Capture::Request) << static_cast<quint64>(time_.nsecsElapsed() / 1000)
+            << static_cast<quint8>(op) << static_cast<quint32>(group) << static_cast<quint32>(offset) << static_cast<qint32>(result)
+            << writeData << readData;
+}
+
+void Tc3CaptureTransport::recordNotification(const AdsNotificationHeader* header, const char* data)
+{
+    QMutexLocker locker(&mutex_);
+    if(!file_.isOpen())
+        return;
+
+    stream_ << static_cast<quint8>(Tc3Capture::Notification) << static_cast<quint64>(time_.nsecsElapsed() / 1000)
+            << static_cast<quint32>(header->hNotification) << static_cast<quint64>(header->nTimeStamp)
+            << QByteArray::fromRawData(data, static_cast<int>(header->cbSampleSize));
+}
+
+/*static*/
+#ifdef __linux__
+void Tc3CaptureTransport::onNotification(const AmsAddr *addr, const AdsNotificationHeader *header, utype route)
+#elif _WIN32
+void Tc3CaptureTransport::onNotification(AmsAddr *addr, AdsNotificationHeader *header, utype route)
+#endif
+{
+    // the route is held until the sample has been forwarded, such that the capture and the receiver
+    // of the callback can't be deleted in the meantime (see ~Tc3CaptureTransport)
+    QMutexLocker locker(&routeMutex_);
+    auto it = routes_.constFind(route);
+    if(it == routes_.constEnd())
+        return;
+
+    const Route& r = it.value();
+
+    // data starts right after the header, don't use header->data as this is not implemented on Linux
+#ifdef __linux__
+    const char* data = reinterpret_cast<const char*>(header + 1);
+#elif _WIN32
+    const char* data = reinterpret_cast<const char*>(&header->data);
+#endif
+
+    r.capture->recordNotification(header, data);
+    r.callback(addr, header, r.userdata);
+}
+
+Tc3ReplayTransport::Player::Player(Tc3ReplayTransport* replay)
+{
+    replay_ = replay;
+}
+
+void Tc3ReplayTransport::Player::run()
+{
+    replay_->play();
+}
+
+Tc3ReplayTransport::Tc3ReplayTransport(const QString& fileName, double speed/*=1.0*/)
+{
+    speed_ = speed;
+    nhandle_ = unknownHandleBase;
+    player_ = nullptr;
+    memset(&addr_, 0, sizeof(addr_));
+    open_ = load(fileName);
+}
+
+Tc3ReplayTransport::~Tc3ReplayTransport()
+{
+    stop_.store(1);
+    if(player_)
+    {
+        {
+            QMutexLocker locker(&mutex_);
+            subscribed_.wakeAll();
+        }
+        player_->wait();
+        delete player_;
+    }
+}
+
+bool Tc3ReplayTransport::isOpen() const
+{
+    return open_;
+}
+
+bool Tc3ReplayTransport::isFinished() const
+{
+    return finished_.load() != 0;
+}
+
+long Tc3ReplayTransport::portOpen()
+{
+    if(!open_)
+        return 0;
+
+    // notifications are played relative to the first connection, like they have been captured
+    if(!player_)
+    {
+        player_ = new Player(this);
+        player_->start();
+    }
+
+    Response r;
+    return (respond(Tc3Capture::PortOpen, 0, 0, QByteArray(), r) && r.result) ? r.result : 1;
+}
+
+long Tc3ReplayTransport::portClose(long port)
+{
+    Q_UNUSED(port)
+    return 0;
+}
+
+long Tc3ReplayTransport::readState(long port, AmsAddr* addr, unsigned short* adsState, unsigned short* deviceState)
+{
+    Q_UNUSED(port)
+    Q_UNUSED(addr)
+
+    Response r;
+    if(!respond(Tc3Capture::ReadState, 0, 0, QByteArray(), r))
+    {
+        *adsState = ADSSTATE_RUN;
+        *deviceState = 0;
+        return 0;
+    }
+
+    if(!r.result && r.data.size() == 2 * static_cast<int>(sizeof(unsigned short)))
+    {
+        memcpy(adsState, r.data.constData(), sizeof(*adsState));
+        memcpy(deviceState, r.data.constData() + sizeof(*adsState), sizeof(*deviceState));
+    }
+    return r.result;
+}
+
+long Tc3ReplayTransport::read(long port, AmsAddr* addr, utype group, utype offset, utype length, void* data, utype* bytesRead)
+{
+    Q_UNUSED(port)
+    Q_UNUSED(addr)
+
+    Response r;
+    if(!respond(Tc3Capture::Read, group, offset, QByteArray(), r))
+        return ADSERR_DEVICE_SYMBOLNOTFOUND;
+
+    const utype n = std::min(length, static_cast<utype>(r.data.size()));
+    memcpy(data, r.data.constData(), n);
+    if(bytesRead)
+        *bytesRead = n;
+
+    return r.result;
+}
+
+long Tc3ReplayTransport::write(long port, AmsAddr* addr, utype group, utype offset, utype length, const void* data)
+{
+    Q_UNUSED(port)
+    Q_UNUSED(addr)
+
+    // writes that have not been captured are accepted
+    Response r;
+    if(!respond(Tc3Capture::Write, group, offset, QByteArray::fromRawData(static_cast<const char*>(data), static_cast<int>(length)), r))
+        return 0;
+
+    return r.result;
+}
+
+long Tc3ReplayTransport::readWrite(long port, AmsAddr* addr, utype group, utype offset, utype readLength, void* readData,
+                                  utype writeLength, const void* writeData, utype* bytesRead)
+{
+    Q_UNUSED(port)
+    Q_UNUSED(addr)
+
+    Response r;
+    if(!respond(Tc3Capture::ReadWrite, group, offset, QByteArray::fromRawData(static_cast<const char*>(writeData), static_cast<int>(writeLength)), r))
+        return ADSERR_DEVICE_SYMBOLNOTFOUND;
+
+    const utype n = std::min(readLength, static_cast<utype>(r.data.size()));
+    memcpy(readData, r.data.constData(), n);
+    if(bytesRead)
+        *bytesRead = n;
+
+    return r.result;
+}
+
+long Tc3ReplayTransport::addNotification(long port, AmsAddr* addr, utype group, utype offset, const AdsNotificationAttrib* attrib,
+                                         PAdsNotificationFuncEx callback, utype userdata, utype* handle)
+{
+    Q_UNUSED(port)
+
+    // the recorded handle is reused, such that the recorded samples find their subscriber
+    Response r;
+    const QByteArray attribData = QByteArray::fromRawData(reinterpret_cast<const char*>(attrib), sizeof(AdsNotificationAttrib));
+    if(respond(Tc3Capture::AddNotification, group, offset, attribData, r))
+    {
+        if(r.result)
+            return r.result;
+
+        quint32 h = 0;
+        memcpy(&h, r.data.constData(), std::min(static_cast<int>(sizeof(h)), r.data.size()));
+        *handle = h;
+    }
+    else
+    {
+        QMutexLocker locker(&mutex_);
+        *handle = nhandle_++;
+    }
+
+    QMutexLocker locker(&mutex_);
+    addr_ = *addr;
+    subscribers_.insert(*handle, { callback, userdata });
+    subscribed_.wakeAll();
+    return 0;
+}
+
+long Tc3ReplayTransport::delNotification(long port, AmsAddr* addr, utype handle)
+{
+    Q_UNUSED(port)
+    Q_UNUSED(addr)
+
+    QMutexLocker locker(&mutex_);
+    subscribers_.remove(handle);
+    return 0;
+}
+
+bool Tc3ReplayTransport::load(const QString& fileName)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+
+    char magic[sizeof(Tc3Capture::magic) - 1];
+    quint8 version = 0;
+    if(stream.readRawData(magic, static_cast<int>(sizeof(magic))) != static_cast<int>(sizeof(magic)) ||
+       memcmp(magic, Tc3Capture::magic, sizeof(magic)))
+    {
+        return false;
+    }
+
+    stream >> version;
+    if(version != Tc3Capture::version)
+        return false;
+
+    while(!stream.atEnd())
+    {
+        quint8 kind;
+        quint64 time;
+        stream >> kind >> time;
+
+        if(kind == Tc3Capture::Request)
+        {
+            quint8 op;
+            quint32 group;
+            quint32 offset;
+            qint32 result;
+            QByteArray writeData;
+            QByteArray readData;
+            stream >> op >> group >> offset >> result >> writeData >> readData;
+
+            responses_[key(static_cast<Tc3Capture::Op>(op), group, offset, writeData)].append({ result, readData });
+            if(op == Tc3Capture::AddNotification && !result && readData.size() == static_cast<int>(sizeof(quint32)))
+                recordedHandles_.insert(*reinterpret_cast<const quint32*>(readData.constData()));
+        }
+        else if(kind == Tc3Capture::Notification)
+        {
+            Sample s;
+            quint32 handle;
+            s.time = time;
+            stream >> handle >> s.timestamp >> s.data;
+            s.handle = handle;
+            samples_.append(s);
+        }
+        else
+        {
+            return false;
+        }
+
+        // a capture that has been cut off is replayed up to the last complete record
+        if(stream.status() != QDataStream::Ok)
+            break;
+    }
+
+    return true;
+}
+
+// the next recorded response of the same request, the last one is repeated
+bool Tc3ReplayTransport::respond(Tc3Capture::Op op, utype group, utype offset, const QByteArray& writeData, Response& response)
+{
+    const QByteArray k = key(op, group, offset, writeData);
+
+    QMutexLocker locker(&mutex_);
+    auto it = responses_.constFind(k);
+    if(it == responses_.constEnd() || it.value().isEmpty())
+        return false;
+
+    int& next = next_[k];
+    response = it.value().at(std::min(next, it.value().size() - 1));
+    ++next;
+    return true;
+}
+
+/*static*/
+QByteArray Tc3ReplayTransport::key(Tc3Capture::Op op, utype group, utype offset, const QByteArray& writeData)
+{
+    const quint32 g = static_cast<quint32>(group);
+    const quint32 o = static_cast<quint32>(offset);
+
+    QByteArray k;
+    k.reserve(static_cast<int>(1 + sizeof(g) + sizeof(o)) + writeData.size());
+    k.append(static_cast<char>(op));
+    k.append(reinterpret_cast<const char*>(&g), sizeof(g));
+    k.append(reinterpret_cast<const char*>(&o), sizeof(o));
+    k.append(writeData);
+    return k;
+}
+
+void Tc3ReplayTransport::play()
+{
+    QElapsedTimer clock;
+    clock.start();
+
+    QByteArray buffer;
+    for(int i=0; i<samples_.size() && !stop_.load(); ++i)
+    {
+        const Sample& s = samples_[i];
+        if(speed_ > 0 && !sleepUntil(clock, static_cast<qint64>(static_cast<double>(s.time) / speed_)))
+            break;
+
+        Subscriber subscriber;
+        {
+            QMutexLocker locker(&mutex_);
+
+            // when playing as fast as possible, the player is usually ahead of the application
+            if(speed_ <= 0 && !subscribers_.contains(s.handle) && recordedHandles_.contains(s.handle) && !missingHandles_.contains(s.handle))
+            {
+                QElapsedTimer waited;
+                waited.start();
+                while(!subscribers_.contains(s.handle) && !stop_.load() && !waited.hasExpired(subscribeTimeout))
+                    subscribed_.wait(&mutex_, 100);
+
+                if(!subscribers_.contains(s.handle))
+                    missingHandles_.insert(s.handle);
+            }
+
+            auto it = subscribers_.constFind(s.handle);
+            if(it == subscribers_.constEnd())
+                continue;
+
+            subscriber = it.value();
+        }
+
+        buffer.fill(0, static_cast<int>(sizeof(AdsNotificationHeader)) + s.data.size());
+        AdsNotificationHeader* header = reinterpret_cast<AdsNotificationHeader*>(buffer.data());
+        header->nTimeStamp = s.timestamp;
+        header->hNotification = s.handle;
+        header->cbSampleSize = static_cast<utype>(s.data.size());
+#ifdef __linux__
+        memcpy(header + 1, s.data.constData(), static_cast<size_t>(s.data.size()));
+#elif _WIN32
+        memcpy(&header->data, s.data.constData(), static_cast<size_t>(s.data.size()));
+#endif
+
+        subscriber.callback(&addr_, header, subscriber.userdata);
+    }
+
+    finished_.store(1);
+}
+
+// false if the replay has been stopped in the meantime
+bool Tc3ReplayTransport::sleepUntil(const QElapsedTimer& clock, qint64 microseconds)
+{
+    for(qint64 now=clock.nsecsElapsed() / 1000; now < microseconds && !stop_.load(); now=clock.nsecsElapsed() / 1000)
+        QThread::usleep(static_cast<unsigned long>(std::min<qint64>(microseconds - now, 50000)));
+
+    return !stop_.load();
+}
@@ -0,0 +1,200 @@
+#include <include/tc3dataflow.h>
+#include <include/tc3value.h>
+
+Tc3DerivedValue::Tc3DerivedValue(const QString& name, Tc3DataflowGraph* graph, int node) :
+    QObject(graph)
+{
+    name_ = name;
+    graph_ = graph;
+    node_ = node;
+}
+
+QString Tc3DerivedValue::name() const
+{
+    return name_;
+}
+
+QVariant Tc3DerivedValue::get() const
+{
+    return graph_->nodes_[node_].value;
+}
+
+bool Tc3DerivedValue::isConnected() const
+{
+    return get().isValid();
+}
+
+Tc3DataflowGraph::Input::Input(Tc3Value* value)
+{
+    this->value = value;
+    derived = nullptr;
+}
+
+Tc3DataflowGraph::Input::Input(Tc3DerivedValue* derived)
+{
+    value = nullptr;
+    this->derived = derived;
+}
+
+Tc3DataflowGraph::Node::Node()
+{
+    output = nullptr;
+    dirty = false;
+}
+
+Tc3DataflowGraph::Tc3DataflowGraph(QObject *parent/*=nullptr*/) :
+    QObject(parent)
+{
+    evaluatePending_ = false;
+    lastEvaluated_ = 0;
+}
+
+Tc3DerivedValue *Tc3DataflowGraph::derive(const QString& name, const QVector<Tc3DataflowGraph::Input>& inputs, const Tc3DataflowGraph::Function& function)
+{
+    if(names_.contains(name) || !function)
+        return nullptr;
+
+    // resolve the inputs first, inputNode may append nodes
+    QVector<int> nodes;
+    foreach(const Input& input, inputs)
+    {
+        if(input.derived && input.derived->graph_ == this)
+            nodes.append(input.derived->node_);
+        else if(input.value)
+            nodes.append(inputNode(input.value));
+        else
+            return nullptr;
+    }
+
+    const int n = nodes_.size();
+    Node node;
+    node.inputs = nodes;
+    node.function = function;
+    nodes_.append(node);
+
+    foreach(int i, nodes)
+    {
+        if(!nodes_[i].dependents.contains(n))
+            nodes_[i].dependents.append(n);
+    }
+
+    Tc3DerivedValue* derived = new Tc3DerivedValue(name, this, n);
+    QVector<QVariant> arguments;
+    nodes_[n].output = derived;
+    nodes_[n].value = compute(n, arguments);
+    names_.insert(name, n);
+    return derived;
+}
+
+Tc3DerivedValue *Tc3DataflowGraph::derived(const QString& name) const
+{
+    const int n = names_.value(name, -1);
+    return n >= 0 ? nodes_[n].output : nullptr;
+}
+
+int Tc3DataflowGraph::count() const
+{
+    return names_.size();
+}
+
+int Tc3DataflowGraph::lastEvaluated() const
+{
+    return lastEvaluated_;
+}
+
+// Results are emitted after the batch, a slot reading other derived values sees the results of
+// the same batch only
+void Tc3DataflowGraph::evaluate()
+{
+    evaluatePending_ = false;
+    lastEvaluated_ = 0;
+
+    QVector<int> changed;
+    QVector<QVariant> arguments;
+    while(!dirty_.empty())
+    {
+        const int n = dirty_.top();
+        dirty_.pop();
+        nodes_[n].dirty = false;
+        lastEvaluated_++;
+
+        const QVariant v = compute(n, arguments);
+        if(same(v, nodes_[n].value))
+            continue;
+
+        nodes_[n].value = v;
+        markDependents(n);
+        changed.append(n);
+    }
+
+    foreach(int n, changed)
+        emit nodes_[n].output->changed(nodes_[n].value);
+}
+
+// node of a Tc3Value, shared by all derived values using it. The value stays an input after it
+// has been deleted, as invalid value
+int Tc3DataflowGraph::inputNode(Tc3Value* value)
+{
+    auto it = inputs_.constFind(value);
+    if(it != inputs_.constEnd())
+        return it.value();
+
+    const int n = nodes_.size();
+    Node node;
+    node.value = value->isConnected() ? value->get() : QVariant();
+    nodes_.append(node);
+    inputs_.insert(value, n);
+
+    // connecting to changed also activates the notification of the value, see Tc3Manager::setNotificationGrace
+    QObject::connect(value, &Tc3Value::changed, this, [this, n](const QVariant& v){ setInput(n, v); });
+    QObject::connect(value, &QObject::destroyed, this, [this, n, value](){ inputs_.remove(value); setInput(n, QVariant()); });
+    return n;
+}
+
+void Tc3DataflowGraph::setInput(int node, const QVariant& v)
+{
+    if(same(v, nodes_[node].value))
+        return;
+
+    nodes_[node].value = v;
+    markDependents(node);
+
+    // all inputs changed by the same dispatch of the manager are evaluated together
+    if(evaluatePending_ || dirty_.empty())
+        return;
+
+    evaluatePending_ = true;
+    QMetaObject::invokeMethod(this, "evaluate", Qt::QueuedConnection);
+}
+
+void Tc3DataflowGraph::markDependents(int node)
+{
+    foreach(int d, nodes_[node].dependents)
+    {
+        if(nodes_[d].dirty)
+            continue;
+
+        nodes_[d].dirty = true;
+        dirty_.push(d);
+    }
+}
+
+QVariant Tc3DataflowGraph::compute(int node, QVector<QVariant>& arguments) const
+{
+    const Node& n = nodes_[node];
+    arguments.resize(n.inputs.size());
+    for(int i=0; i<n.inputs.size(); ++i)
+    {
+        arguments[i] = nodes_[n.inputs[i]].value;
+        if(!arguments[i].isValid())
+            return QVariant();
+    }
+
+    return n.function(arguments);
+}
+
+/*static*/
+bool Tc3DataflowGraph::same(const QVariant& a, const QVariant& b)
+{
+    return a.isValid() == b.isValid() && (!a.isValid() || a == b);
+}
@@ -0,0 +1,357 @@
+#include <include/tc3filestream.h>
+#include <QPointer>
+#include <QEventLoop>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <cstring>
+#include <algorithm>
+
+Tc3FileStream::Tc3FileStream(Tc3AmsClient* client, const QString& path, QObject *parent/*=nullptr*/) :
+    QIODevice(parent),
+    client_(client),
+    path_(path)
+{
+    chunkSize_ = 0x10000;
+    readAhead_ = 16;
+    handle_ = 0;
+    generation_ = 0;
+    bufferPos_ = 0;
+    nextRead_ = 0;
+    nextAppend_ = 0;
+    readsInFlight_ = 0;
+    eof_ = false;
+    writesPending_ = 0;
+}
+
+Tc3FileStream::~Tc3FileStream()
+{
+    close();
+}
+
+QString Tc3FileStream::path() const
+{
+    return path_;
+}
+
+void Tc3FileStream::setChunkSize(int size)
+{
+    chunkSize_ = std::max(1, size);
+}
+
+int Tc3FileStream::chunkSize() const
+{
+    return chunkSize_;
+}
+
+void Tc3FileStream::setReadAhead(int chunks)
+{
+    readAhead_ = std::max(1, chunks);
+}
+
+int Tc3FileStream::readAhead() const
+{
+    return readAhead_;
+}
+
+bool Tc3FileStream::open(OpenMode mode)
+{
+    if(isOpen() || !client_)
+        return false;
+
+    quint32 flags = Tc3Ads::FileModeBinary;
+    if((mode & ReadWrite) == ReadWrite)
+    {
+        setErrorString("reading and writing at once is not supported");
+        return false;
+    }
+    else if(mode & ReadOnly)
+    {
+        flags |= Tc3Ads::FileModeRead;
+    }
+    else if(mode & WriteOnly)
+    {
+        flags |= (mode & Append) ? Tc3Ads::FileModeAppend : Tc3Ads::FileModeWrite;
+    }
+    else
+    {
+        return false;
+    }
+
+    ++generation_;
+    handle_ = 0;
+    buffer_.clear();
+    bufferPos_ = 0;
+    nextRead_ = 0;
+    nextAppend_ = 0;
+    early_.clear();
+    readsInFlight_ = 0;
+    eof_ = false;
+    queuedWrites_.clear();
+    writesPending_ = 0;
+
+    // the data is buffered here, QIODevice doesn't need to buffer it again
+    QIODevice::open(mode | Unbuffered);
+
+    QByteArray name = path_.toLatin1();
+    name.append('\0');
+
+    // a file that is opened after close() has been called is closed right away
+    QPointer<Tc3FileStream> self(this);
+    Tc3AmsClient* client = client_;
+    const int generation = generation_;
+    client_->readWrite(Tc3Ads::FileOpen, flags | (Tc3Ads::PathGeneric << 16), sizeof(quint32), name,
+                       [self, client, generation](long errorId, const QByteArray& data)
+    {
+        if(self && self->generation_ == generation)
+        {
+            self->onOpened(errorId, data);
+        }
+        else if(!errorId && data.size() >= static_cast<int>(sizeof(quint32)))
+        {
+            quint32 h;
+            memcpy(&h, data.constData(), sizeof(h));
+            client->readWrite(Tc3Ads::FileClose, h, 0, QByteArray(), Tc3AmsClient::Callback());
+        }
+    });
+
+    return true;
+}
+
+// Writes that have been sent are still carried out, the plc closes the file after them. Writes
+// issued before the file has been opened are dropped
+void Tc3FileStream::close()
+{
+    if(!isOpen())
+        return;
+
+    QIODevice::close();
+    if(handle_ && client_)
+        client_->readWrite(Tc3Ads::FileClose, handle_, 0, QByteArray(), Tc3AmsClient::Callback());
+
+    ++generation_;
+    handle_ = 0;
+    buffer_.clear();
+    bufferPos_ = 0;
+    early_.clear();
+    queuedWrites_.clear();
+}
+
+bool Tc3FileStream::isSequential() const
+{
+    return true;
+}
+
+bool Tc3FileStream::atEnd() const
+{
+    return eof_ && !readsInFlight_ && bufferPos_ >= buffer_.size() && QIODevice::bytesAvailable() == 0;
+}
+
+qint64 Tc3FileStream::bytesAvailable() const
+{
+    return buffer_.size() - bufferPos_ + QIODevice::bytesAvailable();
+}
+
+qint64 Tc3FileStream::bytesToWrite() const
+{
+    return writesPending_;
+}
+
+bool Tc3FileStream::isReady() const
+{
+    return handle_ != 0;
+}
+
+bool Tc3FileStream::waitForOpened(int msecs/*=30000*/)
+{
+    return wait([this]() { return handle_ != 0; }, msecs);
+}
+
+bool Tc3FileStream::waitForReadyRead(int msecs)
+{
+    return wait([this]() { return bufferPos_ < buffer_.size() || atEnd(); }, msecs) && bufferPos_ < buffer_.size();
+}
+
+bool Tc3FileStream::waitForBytesWritten(int msecs)
+{
+    return wait([this]() { return writesPending_ == 0; }, msecs);
+}
+
+qint64 Tc3FileStream::readData(char* data, qint64 maxSize)
+{
+    const int n = static_cast<int>(std::min<qint64>(maxSize, buffer_.size() - bufferPos_));
+    if(n > 0)
+    {
+        memcpy(data, buffer_.constData() + bufferPos_, static_cast<size_t>(n));
+        bufferPos_ += n;
+    }
+
+    // drop consumed data once it is the larger part of the buffer
+    if(bufferPos_ > buffer_.size() / 2)
+    {
+        buffer_.remove(0, bufferPos_);
+        bufferPos_ = 0;
+    }
+
+    requestChunks();
+
+    if(!n && atEnd())
+        return -1;
+
+    return n;
+}
+
+qint64 Tc3FileStream::writeData(const char* data, qint64 size)
+{
+    for(qint64 at=0; at<size; at+=chunkSize_)
+    {
+        const QByteArray chunk(data + at, static_cast<int>(std::min<qint64>(chunkSize_, size - at)));
+        if(handle_)
+            sendWrite(chunk);
+        else
+            queuedWrites_.append(chunk);
+    }
+
+    writesPending_ += size;
+    return size;
+}
+
+void Tc3FileStream::onOpened(long errorId, const QByteArray& data)
+{
+    if(!errorId && data.size() < static_cast<int>(sizeof(quint32)))
+        errorId = ADSERR_CLIENT_SYNCRESINVALID;
+
+    if(errorId)
+    {
+        fail(errorId);
+        return;
+    }
+
+    memcpy(&handle_, data.constData(), sizeof(handle_));
+    emit opened();
+
+    QList<QByteArray> writes;
+    writes.swap(queuedWrites_);
+    foreach(const QByteArray& chunk, writes)
+        sendWrite(chunk);
+
+    requestChunks();
+}
+
+// keeps readAhead reads in flight, as long as the buffered data doesn't exceed them
+void Tc3FileStream::requestChunks()
+{
+    if(!handle_ || eof_ || !(openMode() & ReadOnly))
+        return;
+
+    const qint64 limit = static_cast<qint64>(readAhead_) * chunkSize_;
+    QPointer<Tc3FileStream> self(this);
+    const int generation = generation_;
+    while(readsInFlight_ < readAhead_ && buffer_.size() - bufferPos_ + static_cast<qint64>(readsInFlight_) * chunkSize_ < limit)
+    {
+        const quint64 sequence = nextRead_++;
+        ++readsInFlight_;
+        client_->readWrite(Tc3Ads::FileRead, handle_, static_cast<Tc3AmsClient::utype>(chunkSize_), QByteArray(),
+                           [self, generation, sequence](long errorId, const QByteArray& data)
+        {
+            if(self && self->generation_ == generation)
+                self->onRead(sequence, errorId, data);
+        });
+    }
+}
+
+// a chunk shorter than requested is the last one, reads behind it return nothing
+void Tc3FileStream::onRead(quint64 sequence, long errorId, const QByteArray& data)
+{
+    --readsInFlight_;
+    if(errorId)
+    {
+        fail(errorId);
+        return;
+    }
+
+    early_.insert(sequence, data);
+
+    bool appended = false;
+    while(!early_.isEmpty() && early_.firstKey() == nextAppend_)
+    {
+        const QByteArray chunk = early_.take(nextAppend_++);
+        if(eof_)
+            continue;
+
+        buffer_.append(chunk);
+        appended = appended || !chunk.isEmpty();
+        eof_ = chunk.size() < chunkSize_;
+    }
+
+    requestChunks();
+
+    if(appended)
+        emit readyRead();
+
+    if(eof_ && !readsInFlight_)
+        emit readChannelFinished();
+}
+
+void Tc3FileStream::sendWrite(const QByteArray& chunk)
+{
+    QPointer<Tc3FileStream> self(this);
+    const int generation = generation_;
+    const int size = chunk.size();
+    client_->readWrite(Tc3Ads::FileWrite, handle_, 0, chunk, [self, generation, size](long errorId, const QByteArray&)
+    {
+        if(self && self->generation_ == generation)
+            self->onWritten(size, errorId);
+    });
+}
+
+void Tc3FileStream::onWritten(int size, long errorId)
+{
+    writesPending_ -= size;
+    if(errorId)
+    {
+        fail(errorId);
+        return;
+    }
+
+    emit bytesWritten(size);
+}
+
+void Tc3FileStream::fail(long errorId)
+{
+    setErrorString(QString("%1: ads error 0x%2").arg(path_).arg(errorId, 0, 16));
+    emit error(errorString());
+    close();
+}
+
+// runs the event loop until done or msecs have elapsed, the responses arrive in the thread of
+// the client
+bool Tc3FileStream::wait(const std::function<bool()>& done, int msecs)
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+    while(!done())
+    {
+        if(!isOpen())
+            return false;
+
+        const qint64 remaining = msecs < 0 ? -1 : msecs - elapsed.elapsed();
+        if(msecs >= 0 && remaining <= 0)
+            return false;
+
+        QEventLoop loop;
+        QTimer timer;
+        timer.setSingleShot(true);
+        QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
+        QObject::connect(this, &Tc3FileStream::opened, &loop, &QEventLoop::quit);
+        QObject::connect(this, &QIODevice::readyRead, &loop, &QEventLoop::quit);
+        QObject::connect(this, &QIODevice::bytesWritten, &loop, &QEventLoop::quit);
+        QObject::connect(this, &QIODevice::readChannelFinished, &loop, &QEventLoop::quit);
+        QObject::connect(this, &QIODevice::aboutToClose, &loop, &QEventLoop::quit);
+        if(remaining >= 0)
+            timer.start(static_cast<int>(remaining));
+
+        loop.exec();
+    }
+
+    return true;
+}
@@ -0,0 +1,149 @@
+#include <include/tc3handle.h>
+
+Tc3Handle::Tc3Handle()
+{
+    manager_ = nullptr;
+    index_ = Tc3ValueStore::InvalidIndex;
+    token_ = 0;
+}
+
+Tc3Handle::Tc3Handle(Tc3Manager* manager, Tc3ValueStore::Index index)
+{
+    manager_ = manager;
+    index_ = index;
+    token_ = 0;
+}
+
+bool Tc3Handle::isValid() const
+{
+    return manager_ && index_ != Tc3ValueStore::InvalidIndex;
+}
+
+bool Tc3Handle::isConnected() const
+{
+    return isValid() && manager_->isValueConnected(index_);
+}
+
+QString Tc3Handle::name() const
+{
+    return isValid() ? manager_->valueName(index_) : QString();
+}
+
+int Tc3Handle::size() const
+{
+    return isValid() ? manager_->valueSize(index_) : 0;
+}
+
+void Tc3Handle::setPriority(Tc3Manager::Priority priority)
+{
+    if(isValid())
+        manager_->setPriority(index_, priority);
+}
+
+void Tc3Handle::setSampled(bool sampled)
+{
+    if(isValid())
+        manager_->setSampled(index_, sampled);
+}
+
+Tc3Manager* Tc3Handle::manager() const
+{
+    return manager_;
+}
+
+Tc3ValueStore::Index Tc3Handle::index() const
+{
+    return index_;
+}
+
+QVariant Tc3Handle::get() const
+{
+    QVariant v;
+    if(isValid())
+        manager_->readValue(index_, v);
+
+    return v;
+}
+
+bool Tc3Handle::set(const QVariant& v)
+{
+    return isValid() && !manager_->writeValue(index_, v);
+}
+
+long Tc3Handle::tryGet(QVariant& v) const
+{
+    return isValid() ? manager_->readValue(index_, v, nullptr, false) : static_cast<long>(Tc3Manager::NotConnected);
+}
+
+long Tc3Handle::trySet(const QVariant& v)
+{
+    return isValid() ? manager_->writeValue(index_, v, nullptr, false) : static_cast<long>(Tc3Manager::NotConnected);
+}
+
+bool Tc3Handle::read(void* data, int size) const
+{
+    return isValid() && !manager_->readRaw(index_, data, size);
+}
+
+bool Tc3Handle::write(const void* data, int size)
+{
+    return isValid() && !manager_->writeRaw(index_, data, size);
+}
+
+long Tc3Handle::readAsync(const Tc3Manager::AsyncCallback& callback) const
+{
+    return isValid() ? manager_->readAsync(index_, callback) : static_cast<long>(Tc3Manager::NotConnected);
+}
+
+long Tc3Handle::writeAsync(const QByteArray& data, const Tc3Manager::AsyncCallback& callback/*=Tc3Manager::AsyncCallback()*/)
+{
+    return isValid() ? manager_->writeAsync(index_, data, callback) : static_cast<long>(Tc3Manager::NotConnected);
+}
+
+bool Tc3Handle::readChunked(char* data, qint64 size, const Tc3Manager::Progress& progress/*=Tc3Manager::Progress()*/, int chunkSize/*=0x10000*/, int parallel/*=4*/) const
+{
+    return isValid() && manager_->transferChunked(index_, data, size, false, progress, chunkSize, parallel);
+}
+
+bool Tc3Handle::writeChunked(const char* data, qint64 size, const Tc3Manager::Progress& progress/*=Tc3Manager::Progress()*/, int chunkSize/*=0x10000*/, int parallel/*=4*/)
+{
+    return isValid() && manager_->transferChunked(index_, const_cast<char*>(data), size, true, progress, chunkSize, parallel);
+}
+
+void Tc3Handle::subscribe(const Callback& callback, Tc3Manager::NotificationType type/*=Tc3Manager::NotificationType::Change*/, int cycleTime_ms/*=300*/, int maxDelay_ms/*=1000*/)
+{
+    if(!isValid())
+        return;
+
+    unsubscribe();
+    token_ = manager_->addSubscription(index_, callback, type, cycleTime_ms, maxDelay_ms);
+}
+
+void Tc3Handle::unsubscribe()
+{
+    if(!isValid())
+        return;
+
+    manager_->removeSubscription(index_, token_);
+    token_ = 0;
+}
+
+Tc3LatencyHistogram Tc3Handle::latency(Tc3Manager::LatencyStage stage) const
+{
+    return isValid() ? manager_->latency(index_, stage) : Tc3LatencyHistogram();
+}
+
+void Tc3Handle::acknowledge()
+{
+    if(isValid())
+        manager_->acknowledge(index_);
+}
+
+QVariant Tc3Handle::decode(const char* data, int size) const
+{
+    QVariant v;
+    if(isValid())
+        manager_->decodeValue(index_, data, size, v);
+
+    return v;
+}
@@ -0,0 +1,110 @@
+#include <include/tc3latency.h>
+#include <algorithm>
+#include <cmath>
+
+Tc3LatencyHistogram::Tc3LatencyHistogram()
+{
+    count_ = 0;
+    min_ = 0;
+    max_ = 0;
+    sum_ = 0;
+}
+
+void Tc3LatencyHistogram::record(qint64 latency_us)
+{
+    // clocks are estimated, slightly negative latencies are counted as 0
+    latency_us = std::max<qint64>(latency_us, 0);
+    if(counts_.isEmpty())
+        counts_.fill(0, Buckets);
+
+    counts_[bucket(latency_us)]++;
+    min_ = count_ ? std::min(min_, latency_us) : latency_us;
+    max_ = count_ ? std::max(max_, latency_us) : latency_us;
+    sum_ += latency_us;
+    count_++;
+}
+
+void Tc3LatencyHistogram::merge(const Tc3LatencyHistogram& other)
+{
+    if(!other.count_)
+        return;
+
+    if(counts_.isEmpty())
+        counts_.fill(0, Buckets);
+
+    for(int b=0; b<Buckets; ++b)
+        counts_[b] += other.counts_[b];
+
+    min_ = count_ ? std::min(min_, other.min_) : other.min_;
+    max_ = count_ ? std::max(max_, other.max_) : other.max_;
+    sum_ += other.sum_;
+    count_ += other.count_;
+}
+
+void Tc3LatencyHistogram::reset()
+{
+    *this = Tc3LatencyHistogram();
+}
+
+quint64 Tc3LatencyHistogram::count() const
+{
+    return count_;
+}
+
+qint64 Tc3LatencyHistogram::min() const
+{
+    return min_;
+}
+
+qint64 Tc3LatencyHistogram::max() const
+{
+    return max_;
+}
+
+qint64 Tc3LatencyHistogram::mean() const
+{
+    return count_ ? sum_ / static_cast<qint64>(count_) : 0;
+}
+
+qint64 Tc3LatencyHistogram::percentile(double p) const
+{
+    if(!count_)
+        return 0;
+
+    const quint64 rank = std::max<quint64>(1, static_cast<quint64>(std::ceil(std::min(std::max(p, 0.0), 100.0) / 100.0 * static_cast<double>(count_))));
+    quint64 seen = 0;
+    for(int b=0; b<Buckets; ++b)
+    {
+        seen += counts_[b];
+        if(seen >= rank)
+            return std::min(upperBound(b), max_);
+    }
+
+    return max_;
+}
+
+// 0..3 have a bucket each, above the two bits below the highest set bit select the sub bucket
+/*static*/
+int Tc3LatencyHistogram::bucket(qint64 latency_us)
+{
+    if(latency_us < SubBuckets)
+        return static_cast<int>(latency_us);
+
+    int msb = 0;
+    for(quint64 v=static_cast<quint64>(latency_us); v>1; v>>=1)
+        msb++;
+
+    const int sub = static_cast<int>((latency_us >> (msb - 2)) & (SubBuckets - 1));
+    return std::min((msb - 1) * SubBuckets + sub, static_cast<int>(Buckets) - 1);
+}
+
+/*static*/
+qint64 Tc3LatencyHistogram::upperBound(int bucket)
+{
+    if(bucket < SubBuckets)
+        return bucket;
+
+    const int msb = bucket / SubBuckets + 1;
+    const qint64 lower = static_cast<qint64>(SubBuckets + bucket % SubBuckets) << (msb - 2);
+    return lower + (static_cast<qint64>(1) << (msb - 2)) - 1;
+}
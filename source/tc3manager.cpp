@@ -1,16 +1,27 @@
 #include <include/tc3manager.h>
 #include <include/tc3value.h>
+#include <include/tc3valuegroup.h>
+#include <include/tc3adsdefs.h>
+#include <include/tc3transport.h>
+#include <include/tc3handle.h>
+#include <include/tc3amsclient.h>
 #include <QRegExp>
 #include <QMutexLocker>
+#include <QVarLengthArray>
 #include <QAbstractSocket>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QSemaphore>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <algorithm>
+#include <limits>
 
 // use the correct ads defintions, platform depend
 #ifdef __linux__
 #include "AdsDef.h"
-#include "AdsLib.h"
 #elif _WIN32
 #include <TcAdsDef.h>
-#include <TcAdsAPI.h>
 #else
 #endif
 
@@ -20,20 +31,267 @@ Tc3Manager::utype Tc3Manager::nid_ = 0;
 /*static*/
 QHash<Tc3Manager::utype, Tc3Manager*> Tc3Manager::uniqueInst_;
 
+namespace
+{
+
+// default chunk size of transfers, well below the frame limits of the routers
+const int defaultChunkSize = 0x10000;
+
+// QObjectPrivate of a Tc3Value with its allocation overhead (about 120 bytes with Qt 5 on 64 bit),
+// it is not public, so its size is estimated
+const qint64 objectPrivateSize = 16 * static_cast<qint64>(sizeof(void*));
+
+// host times are FILETIME like the timestamps of the plc, the clock offset is estimated over
+// windows of 30 s and the round trip is probed every 5 s while latencies are tracked
+const qint64 unixEpochFiletime = 116444736000000000LL;
+const qint64 offsetWindow = 30 * 10000000LL;
+const qint64 noSample = std::numeric_limits<qint64>::max();
+const qint64 latencyEventInterval = 10000000LL;
+const int probeInterval_ms = 5000;
+
+// errors are aggregated per code and symbol
+quint64 errorKey(long code, Tc3SymbolTable::Id symbol)
+{
+    return (static_cast<quint64>(static_cast<quint32>(code)) << 32) | static_cast<quint64>(symbol);
+}
+
+long errorCode(quint64 key)
+{
+    return static_cast<qint32>(key >> 32);
+}
+
+Tc3SymbolTable::Id errorSymbol(quint64 key)
+{
+    return static_cast<Tc3SymbolTable::Id>(key & 0xFFFFFFFFu);
+}
+
+// runs a function in its own thread, for the chunks of a transfer
+class Worker : public QThread
+{
+public:
+    explicit Worker(const std::function<void()>& work) :
+        work_(work)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        work_();
+    }
+
+    std::function<void()> work_;
+};
+
+}
+
+// Holds the ads port for a single request and records how long the request waited for it. The
+// port goes to the waiting request of the highest priority, requests of a priority get it in the
+// order they arrived (tickets). High takes highPort_ while it is open, requests use port()
+class Tc3Manager::LaneLocker
+{
+public:
+    LaneLocker(Tc3Manager* manager, Priority priority) :
+        manager_(manager),
+        lane_(manager->lanes_[priority]),
+        busy_(&manager->portBusy_),
+        port_(0)
+    {
+        QElapsedTimer queued;
+        queued.start();
+        {
+            QMutexLocker portLocker(&manager_->portMutex_);
+            const long highPort = priority == High ? manager_->highPort_.loadAcquire() : 0;
+            if(highPort)
+                busy_ = &manager_->highBusy_;
+
+            const quint64 ticket = lane_.next++;
+            while(*busy_ || ticket != lane_.serving || (!highPort && higherWaiting(priority)))
+                manager_->portFree_.wait(&manager_->portMutex_);
+
+            lane_.serving++;
+            *busy_ = true;
+            port_ = highPort ? highPort : manager_->port();
+        }
+
+        const qint64 wait = queued.nsecsElapsed();
+        lane_.requests.fetchAndAddRelaxed(1);
+        lane_.wait_ns.fetchAndAddRelaxed(wait);
+
+        qint64 max = lane_.maxWait_ns.load();
+        while(wait > max && !lane_.maxWait_ns.testAndSetOrdered(max, wait))
+            max = lane_.maxWait_ns.load();
+    }
+
+    ~LaneLocker()
+    {
+        QMutexLocker portLocker(&manager_->portMutex_);
+        *busy_ = false;
+        manager_->portFree_.wakeAll();
+    }
+
+    long port() const
+    {
+        return port_;
+    }
+
+private:
+    // high priority requests on their own port don't hold back the others
+    bool higherWaiting(Priority priority) const
+    {
+        const int first = manager_->highPort_.loadAcquire() ? High + 1 : High;
+        for(int p=first; p<priority; ++p)
+        {
+            if(manager_->lanes_[p].next != manager_->lanes_[p].serving)
+                return true;
+        }
+
+        return false;
+    }
+
+    Tc3Manager* manager_;
+    Lane& lane_;
+    bool* busy_;
+    long port_;
+};
+
+// Marks the handle of a slot as used by a request, evictHandles skips it until the request is
+// done. raise is called while holding writeMutex_, when the handle is taken from the store
+class Tc3Manager::HandleUse
+{
+public:
+    explicit HandleUse(Tc3Manager* manager) :
+        manager_(manager),
+        index_(Tc3ValueStore::InvalidIndex)
+    {
+    }
+
+    ~HandleUse()
+    {
+        if(index_ == Tc3ValueStore::InvalidIndex)
+            return;
+
+        QMutexLocker writeLocker(&manager_->writeMutex_);
+        if(manager_->store_.isValid(index_) && manager_->store_.inFlight[static_cast<int>(index_)] > 0)
+            manager_->store_.inFlight[static_cast<int>(index_)]--;
+    }
+
+    void raise(Tc3ValueStore::Index i)
+    {
+        index_ = i;
+        manager_->store_.inFlight[static_cast<int>(i)]++;
+    }
+
+private:
+    Tc3Manager* manager_;
+    Tc3ValueStore::Index index_;
+};
+
 Tc3Manager::Tc3Manager(const QString& amsnetid/*=QString()*/, QObject *parent/*=nullptr*/) :
+    Tc3Manager(amsnetid, nullptr, parent)
+{
+}
+
+Tc3Manager::Tc3Manager(const QString& amsnetid, Tc3Transport* transport, QObject *parent/*=nullptr*/) :
+    Tc3Manager(amsnetid, Blocking, transport, parent)
+{
+}
+
+Tc3Manager::Tc3Manager(const QString& amsnetid, Tc3Manager::ConnectMode mode, Tc3Transport* transport/*=nullptr*/, QObject *parent/*=nullptr*/) :
     QObject(parent),
-    mutex_(QMutex::Recursive)
+    mutex_(QMutex::Recursive),
+    browser_(this),
+    idleTimer_(this),
+    cacheTimer_(this),
+    errorTimer_(this),
+    probeTimer_(this)
 {
+    transport_ = transport ? transport : new Tc3AdsTransport();
+
     // UniqueInst is for handling multiple manager instances on a system
     id_ = nid_++;
     uniqueInst_.insert(id_, this);
 
     // Auto reconnection handling if connection state changes
-    mhandle_ = 0;
+    mhandle_.store(0);
     mhandleMem_ = 0;
-    adsport_ = 0;
+    shandle_ = 0;
+    adsport_.store(0);
+    highPort_.store(0);
     reconnectTimer_ = -1;
+    stringEncoding_ = Tc3StringCodec::Windows1252;
+    writeMode_ = WriteThrough;
+    flushThread_ = nullptr;
+    browserValid_ = false;
+    symbolVersion_.store(-1);
+    rebindPending_.store(0);
+    dispatchPending_ = false;
+
+    portBusy_ = false;
+    highBusy_ = false;
+    for(Lane& lane : lanes_)
+    {
+        lane.next = 0;
+        lane.serving = 0;
+    }
+
+    // notifications follow their listeners
+    notificationGrace_ = 5000;
+    nextToken_ = 0;
+    sampleListeners_.store(0);
+    clock_.start();
+    idleTimer_.setSingleShot(true);
+    QObject::connect(&idleTimer_, &QTimer::timeout, this, &Tc3Manager::releaseIdleNotifications);
+
+    // handles are kept forever unless setHandleCache is used
+    handleCapacity_ = -1;
+    handleIdle_ = -1;
+    evictPending_ = false;
+    restorePending_ = false;
+    QObject::connect(&cacheTimer_, &QTimer::timeout, this, &Tc3Manager::evictHandles);
+
+    // the same error is reported at most once per second
+    errorInterval_ = 1000;
+    errorFlushPending_ = false;
+    errorTimer_.setSingleShot(true);
+    QObject::connect(&errorTimer_, &QTimer::timeout, this, &Tc3Manager::flushErrors);
+    qRegisterMetaType<Tc3Manager::ErrorEvent>("Tc3Manager::ErrorEvent");
+
+    // notification latency is only tracked on request
+    latencyTracking_.store(0);
+    latencyBudget_ = 0;
+    clockEpoch_ = QDateTime::currentMSecsSinceEpoch() * 10000 + unixEpochFiletime;
+    clockOffset_ = 0;
+    arrivalWindow_[0] = arrivalWindow_[1] = noSample;
+    roundTripWindow_[0] = roundTripWindow_[1] = noSample;
+    windowStart_ = 0;
+    QObject::connect(&probeTimer_, &QTimer::timeout, this, &Tc3Manager::probeRoundTrip);
+    qRegisterMetaType<Tc3Manager::LatencyEvent>("Tc3Manager::LatencyEvent");
+
+    // the plc side of released values is cleaned up in the background
+    releasePending_ = false;
+    releaseThread_ = nullptr;
+    releaser_ = nullptr;
+    startReleaser();
+
+    // in deferred mode nothing waits for the plc, neither the constructor nor value()
+    connectMode_ = mode;
+    resolvePending_ = false;
+    connectPending_.store(0);
+    resolveThread_ = nullptr;
+    resolver_ = nullptr;
+    if(connectMode_ == Deferred)
+    {
+        resolveThread_ = new QThread(this);
+        resolver_ = new QObject();
+        resolver_->moveToThread(resolveThread_);
+        QObject::connect(resolveThread_, &QThread::finished, resolver_, &QObject::deleteLater);
+        resolveThread_->start();
+    }
+
+    qRegisterMetaType<Tc3SampleBatch>("Tc3SampleBatch");
     QObject::connect(this, SIGNAL(connectionChanged(bool)), this, SLOT(onConnectionChanged(bool)));
+    QObject::connect(this, SIGNAL(symbolsChanged()), this, SLOT(onSymbolsChanged()));
 
     // If AmsNetId seems valid, try to connect to the ads router
     static QRegExp rx("(\\d+.\\d+\\.\\d+\\.\\d+\\.\\d+\\.\\d+):(\\d+)");
@@ -44,7 +302,10 @@ Tc3Manager::Tc3Manager(const QString& amsnetid/*=QString()*/, QObject *parent/*=
         for(int i=0; i<subadr.count(); i++)
             adsadr_.netId.b[i] = static_cast<unsigned char>(subadr[i].toInt());
 
-        connect();
+        if(connectMode_ == Deferred)
+            queueConnect();
+        else
+            connect();
     }
     else
     {
@@ -57,7 +318,19 @@ Tc3Manager::~Tc3Manager()
 {
     if(uniqueInst_.contains(id_))
         uniqueInst_.remove(id_);
+
+    // a connect or resolve that is still running finishes first, it locks mutex_ as well
+    stopResolver();
+
+    // write everything that is still pending before values are deleted
+    setWriteMode(WriteThrough);
+
+    // groups remove themselves from groups_
+    QList<Tc3ValueGroup*> groups = groups_;
+    qDeleteAll(groups);
+
     disconnect();
+    delete transport_;
 }
 
 bool Tc3Manager::connect()
@@ -66,7 +339,7 @@ bool Tc3Manager::connect()
     if(isConnected())
         return true;
 
-    long adsport = AdsPortOpenEx();
+    long adsport = transport_->portOpen();
 
     if(!adsport)
     {
@@ -78,7 +351,7 @@ bool Tc3Manager::connect()
     // check if plc is running
     if(adsState(adsport) != ADSSTATE_RUN)
     {
-        AdsPortCloseEx(adsport);
+        transport_->portClose(adsport);
         emit connectionChanged(false);
         emit error("AdsState is not ADSSTATE_RUN - check if PLC is still running");
         return false;
@@ -87,33 +360,54 @@ bool Tc3Manager::connect()
     // deal with old adsport, if we got to this point the plc is running
     // so we actually do some stuff (if stopped ads router doesn't respond
     // to most commands
-    if(adsport_)
+    const long oldPort = port();
+    if(oldPort)
     {
-        // deal with old notification handle - probably ads takes care of this automatically,
-        // but let's be sure
-        if(mhandleMem_)
+        htype oldHandle = 0;
         {
-            AdsSyncDelDeviceNotificationReqEx(adsport_, &adsadr_, mhandleMem_);
+            QMutexLocker locker(&mutex_);
+            oldHandle = mhandleMem_;
             mhandleMem_ = 0;
         }
+
+        // deal with old notification handle - probably ads takes care of this automatically,
+        // but let's be sure
+        if(oldHandle)
+            transport_->delNotification(oldPort, &adsadr_, oldHandle);
         
+        const long oldHighPort = highPort_.fetchAndStoreOrdered(0);
+        if(oldHighPort)
+            transport_->portClose(oldHighPort);
+
         // disconnect old port, we want to continue with the fresh adsport
         // and don't want multiple connections
-        long errorId = AdsPortCloseEx(adsport_);
+        long errorId = transport_->portClose(oldPort);
         if (errorId)
         {
-            AdsPortCloseEx(adsport);
+            transport_->portClose(adsport);
             emit connectionChanged(false);
-            emit error(tc3AdsError(errorId));
+            reportError(errorId, Connect);
             return false;
         }
         else
         {
-            adsport_ = 0;
+            adsport_.storeRelease(0);
         }
     }
 
-    adsport_ = adsport;
+    adsport_.storeRelease(adsport);
+
+    // high priority requests don't queue behind uploads and sum requests on adsport. If there is
+    // no port left they share adsport
+    highPort_.storeRelease(transport_->portOpen());
+
+    // handles and notifications of the old port are gone anyway. disconnect stops the releaser
+    {
+        QMutexLocker releaseLocker(&releaseMutex_);
+        releasedHandles_.clear();
+        releasedNotifications_.clear();
+    }
+    startReleaser();
 
     AdsNotificationAttrib   attrib;
     attrib.cbLength       = sizeof(short);
@@ -122,25 +416,49 @@ bool Tc3Manager::connect()
     attrib.dwChangeFilter = 0;
 
     // This automatically runs onConnectionChanged as well
-    long errorId = AdsSyncAddDeviceNotificationReqEx(adsport_, &adsadr_, ADSIGRP_DEVICE_DATA, ADSIOFFS_DEVDATA_ADSSTATE,
-                                                     &attrib, onConnectionChanged, static_cast<Tc3Manager::utype>(id_), &mhandle_);
+    htype mhandle = 0;
+    long errorId = transport_->addNotification(adsport, &adsadr_, ADSIGRP_DEVICE_DATA, ADSIOFFS_DEVDATA_ADSSTATE,
+                                                     &attrib, onConnectionChanged, static_cast<Tc3Manager::utype>(id_), &mhandle);
     if (errorId)
     {
-        mhandle_ = 0;
         emit connectionChanged(false);
-        emit error(tc3AdsError(errorId));
+        reportError(errorId, Connect);
         return false;
     }
+    mhandle_.storeRelease(mhandle);
+
+    // online changes increment the symbol version, value groups are expanded again then.
+    // Groups are not updated automatically if this fails, but this is not a reason to fail connecting
+    symbolVersion_.store(-1);
+    attrib.cbLength = 1;
+    htype shandle = 0;
+    errorId = transport_->addNotification(adsport, &adsadr_, Tc3Ads::SymVersion, 0,
+                                                &attrib, onSymbolVersionChanged, static_cast<Tc3Manager::utype>(id_), &shandle);
+    if (errorId)
+    {
+        shandle = 0;
+        reportError(errorId, Connect);
+    }
 
-    // connect to all already registered variables
-    foreach(Tc3Value* v, vars_)
+    // connect to all already registered variables, in deferred mode they are resolved in batches
     {
-        // try to reconnect to all values
-        v->connect();
+        QMutexLocker locker(&mutex_);
+        shandle_ = shandle;
+        for(int i=0; i<store_.size(); ++i)
+        {
+            if(store_.references[i] <= 0)
+                continue;
+
+            if(connectMode_ == Deferred)
+                queueResolve(static_cast<Tc3ValueStore::Index>(i));
+            else
+                connectValue(static_cast<Tc3ValueStore::Index>(i));
+        }
     }
 
-    // kill reconnection timer (only relevant of ::connect got called by timerEvent)
-    if(reconnectTimer_ >= 0)
+    // kill reconnection timer (only relevant of ::connect got called by timerEvent). A deferred
+    // connect doesn't run in the thread of the timer, onConnectionChanged kills it then
+    if(reconnectTimer_ >= 0 && thread() == QThread::currentThread())
     {
         killTimer(reconnectTimer_);
         reconnectTimer_ = -1;
@@ -154,27 +472,85 @@ bool Tc3Manager::connect()
 void Tc3Manager::disconnect()
 {
     QMutexLocker locker(&mutex_);
-    foreach(Tc3Value* v, vars_)
-        delete v;
-    vars_.clear();
+
+    // everything released from now on is released below at once
+    stopReleaser();
+
+    // facades created by the manager are deleted, facades created by the user outlive the manager
+    // and are detached, their reference is dropped with them
+    QList<Tc3Value*> facades;
+    for(int i=0; i<store_.size(); ++i)
+    {
+        Tc3Value* v = store_.references[i] > 0 ? store_.facades[i] : nullptr;
+        if(v && v->parent() == this)
+        {
+            facades.append(v);
+        }
+        else if(v)
+        {
+            v->manager_ = nullptr;
+            store_.facades[i] = nullptr;
+            releaseSlot(static_cast<Tc3ValueStore::Index>(i));
+        }
+    }
+    qDeleteAll(facades);
+
+    // Slots still held by handles, typed values, groups, ... stay allocated, their holders release
+    // them later and they are connected again by connect. Only their plc handles are released
+    for(int s=0; s<store_.size(); ++s)
+    {
+        if(store_.references[s] <= 0 || !store_.types[s])
+            continue;
+
+        const htype nh = store_.notifications[s];
+        if(nh)
+            notifications_.remove(nh);
+
+        queueRelease(store_.handles[s], nh);
+        idle_.remove(static_cast<Tc3ValueStore::Index>(s));
+
+        QMutexLocker writeLocker(&writeMutex_);
+        store_.handles[s] = 0;
+        store_.notifications[s] = 0;
+        store_.types[s] = nullptr;
+    }
 
     if(!isConnected())
         return;
 
-    long errorId = AdsSyncDelDeviceNotificationReqEx(adsport_, &adsadr_, mhandle_);
+    // closing the port removes the notifications, the handles are released with sum requests
+    QVector<htype> handles;
+    {
+        QMutexLocker releaseLocker(&releaseMutex_);
+        handles.swap(releasedHandles_);
+        releasedNotifications_.clear();
+    }
+    releaseHandles(handles);
+
+    if(shandle_)
+    {
+        transport_->delNotification(port(), &adsadr_, shandle_);
+        shandle_ = 0;
+    }
+
+    long errorId = transport_->delNotification(port(), &adsadr_, mhandle_.loadAcquire());
     if(errorId)
     {
-        emit error(tc3AdsError(errorId));
+        reportError(errorId, Connect);
     }
     else
     {
-        mhandle_ = 0;
+        mhandle_.storeRelease(0);
     }
 
-    errorId = AdsPortCloseEx(adsport_);
+    const long highPort = highPort_.fetchAndStoreOrdered(0);
+    if(highPort)
+        transport_->portClose(highPort);
+
+    errorId = transport_->portClose(port());
     if(errorId)
     {
-        emit error(tc3AdsError(errorId));
+        reportError(errorId, Connect);
     }
 
     emit connectionChanged(false);
@@ -187,11 +563,15 @@ Tc3Manager::htype Tc3Manager::connectHandle(const QString& name)
         return 0;
 
     int h=0;
-    long errorId = AdsSyncReadWriteReqEx2(adsport_, &adsadr_, ADSIGRP_SYM_HNDBYNAME, 0, sizeof(unsigned long),
-                                          &h, static_cast<unsigned int>(name.size()), name.toLatin1().data(), nullptr);
+    long errorId = 0;
+    {
+        LaneLocker lane(this, Bulk);
+        errorId = transport_->readWrite(port(), &adsadr_, ADSIGRP_SYM_HNDBYNAME, 0, sizeof(unsigned long),
+                                        &h, static_cast<unsigned int>(name.size()), name.toLatin1().data(), nullptr);
+    }
     if (errorId)
     {
-        emit error(tc3AdsError(errorId));
+        reportError(errorId, Handle, symbols_.find(name));
         return 0;
     }
 
@@ -200,10 +580,14 @@ Tc3Manager::htype Tc3Manager::connectHandle(const QString& name)
 
 void Tc3Manager::disconnectHandle(utype h)
 {
-    long errorId = AdsSyncWriteReqEx(adsport_,  &adsadr_, ADSIGRP_SYM_RELEASEHND, 0, sizeof(h), &h);
+    long errorId = 0;
+    {
+        LaneLocker lane(this, Bulk);
+        errorId = transport_->write(port(),  &adsadr_, ADSIGRP_SYM_RELEASEHND, 0, sizeof(h), &h);
+    }
     if (errorId)
     {
-        emit error(tc3AdsError(errorId));
+        reportError(errorId, Release);
     }
 }
 
@@ -214,256 +598,3075 @@ Tc3Manager::SymbolInfo Tc3Manager::symbolInfo(const QString& name)
 
     Tc3Manager::SymbolInfo r;
 
-    bool buffer[0xFFFF];
-    AdsSymbolEntry* pAdsSymbolEntry;
-
-    long errorId = AdsSyncReadWriteReqEx2(adsport_, &adsadr_, ADSIGRP_SYM_INFOBYNAMEEX, 0, sizeof(buffer), buffer,
-                                          name.size(), name.toLatin1().data(), nullptr);
-
+    QByteArray buffer;
+    long errorId = symbolEntry(name.toLatin1(), buffer);
     if (errorId)
     {
-        emit error(tc3AdsError(errorId));
+        reportError(errorId, Symbols, symbols_.find(name));
         return Tc3Manager::SymbolInfo();
     }
 
-    pAdsSymbolEntry = reinterpret_cast<AdsSymbolEntry*>(buffer);
-
-    r.group = pAdsSymbolEntry->iGroup;
-    r.offset = pAdsSymbolEntry->iOffs;
-    r.size = pAdsSymbolEntry->size;
+    const AdsSymbolEntry* pAdsSymbolEntry = reinterpret_cast<const AdsSymbolEntry*>(buffer.constData());
+    const char* text = reinterpret_cast<const char*>(pAdsSymbolEntry + 1);
 
-    int size=0;
-    size = std::min(SPSSTRINGLENGTH, (int)strlen(PADSSYMBOLNAME(pAdsSymbolEntry)));
-    memcpy(r.symbolName, PADSSYMBOLNAME(pAdsSymbolEntry), size);
-
-    size = std::min(SPSSTRINGLENGTH, (int)strlen(PADSSYMBOLTYPE(pAdsSymbolEntry)));
-    memcpy(r.symbolType, PADSSYMBOLTYPE(pAdsSymbolEntry), size);
-
-    size = std::min(SPSSTRINGLENGTH, (int)strlen(PADSSYMBOLCOMMENT(pAdsSymbolEntry)));
-    memcpy(r.symbolComment, PADSSYMBOLCOMMENT(pAdsSymbolEntry), size);
+    r.group = static_cast<int>(pAdsSymbolEntry->iGroup);
+    r.offset = static_cast<int>(pAdsSymbolEntry->iOffs);
+    r.size = static_cast<int>(pAdsSymbolEntry->size);
+    r.symbolName = QString::fromLatin1(text, pAdsSymbolEntry->nameLength);
+    text += pAdsSymbolEntry->nameLength + 1;
+    r.symbolType = QString::fromLatin1(text, pAdsSymbolEntry->typeLength);
+    text += pAdsSymbolEntry->typeLength + 1;
+    r.symbolComment = QString::fromLatin1(text, pAdsSymbolEntry->commentLength);
 
     return r;
 }
 
-bool Tc3Manager::syncReadReq(htype h, void *data, int size)
+bool Tc3Manager::resolveSymbol(Tc3SymbolTable::Id id)
 {
-    if(!h || !data || !isConnected() || size <= 0)
+    if (!isConnected())
         return false;
 
-    long errorId = AdsSyncReadReqEx2(adsport_, &adsadr_, ADSIGRP_SYM_VALBYHND, h, size, data, nullptr);
+    QByteArray buffer;
+    long errorId = symbolEntry(symbols_.name(id).toLatin1(), buffer);
     if (errorId)
     {
-        emit error(tc3AdsError(errorId));
+        reportError(errorId, Symbols, id);
+        return false;
     }
-    return !errorId;
+
+    setSymbolEntry(id, buffer);
+    return true;
 }
 
-bool Tc3Manager::syncWriteReq(htype h, const void *data, int size )
+// INFOBYNAMEEX of a symbol into entry, the ads error code is returned. Touches nothing but the
+// port, it can run without holding mutex_
+long Tc3Manager::symbolEntry(const QByteArray& name, QByteArray& entry)
 {
-    if(!h || !data || !isConnected())
-        return false;
+    entry.fill(0, 0xFFFF);
+    LaneLocker lane(this, Bulk);
+    return transport_->readWrite(port(), &adsadr_, ADSIGRP_SYM_INFOBYNAMEEX, 0, static_cast<unsigned int>(entry.size()), entry.data(),
+                                 static_cast<unsigned int>(name.size()), name.constData(), nullptr);
+}
 
-    // ugly const cast, but Twincat3 Api want's it that way
-    long errorId = AdsSyncWriteReqEx(adsport_, &adsadr_, ADSIGRP_SYM_VALBYHND, h, size,  const_cast<void*>(data));
-    if (errorId)
-    {
-        emit error(tc3AdsError(errorId));
-    }
-    return !errorId;
+// only keeps what is needed to access the symbol, the comment is dropped
+void Tc3Manager::setSymbolEntry(Tc3SymbolTable::Id id, const QByteArray& entry)
+{
+    const AdsSymbolEntry* pAdsSymbolEntry = reinterpret_cast<const AdsSymbolEntry*>(entry.constData());
+    const char* type = reinterpret_cast<const char*>(pAdsSymbolEntry + 1) + pAdsSymbolEntry->nameLength + 1;
+    symbols_.setInfo(id, pAdsSymbolEntry->iGroup, pAdsSymbolEntry->iOffs, pAdsSymbolEntry->size, type, pAdsSymbolEntry->typeLength);
 }
 
-Tc3Manager::htype Tc3Manager::enableNotify(htype h, int size, Tc3Manager::NotificationType type, int cycleTimeMillisecond, int maxDelayMilliseconds, PAdsNotificationFuncEx callbackPtr)
+QString Tc3Manager::symbolComment(const QString& name)
 {
-    if (!h || !isConnected())
-        return 0;
+    QMutexLocker locker(&mutex_);
+    return symbolInfo(name).symbolComment;
+}
 
-    AdsNotificationAttrib attrib;
-    attrib.cbLength = size;
-    attrib.nTransMode = type == Tc3Manager::NotificationType::Cycle ? ADSTRANS_SERVERCYCLE : ADSTRANS_SERVERONCHA;
-    attrib.nMaxDelay = maxDelayMilliseconds * 10000;
-    attrib.nCycleTime = cycleTimeMillisecond * 10000;
+Tc3Manager::MemoryFootprint Tc3Manager::memoryFootprint()
+{
+    QMutexLocker locker(&mutex_);
 
-    htype nh;
-    long errorId = AdsSyncAddDeviceNotificationReqEx(adsport_, &adsadr_, ADSIGRP_SYM_VALBYHND, h, &attrib, callbackPtr, id_, &nh );
-    if (errorId)
+    MemoryFootprint r;
+    r.symbols = symbols_.count();
+    r.values = store_.count();
+    r.handles = 0;
+    for(int s=0; s<store_.size(); ++s)
     {
-        emit error(tc3AdsError(errorId));
-        return 0;
+        if(store_.references[s] > 0 && store_.handles[s])
+            r.handles++;
     }
 
-    return nh;
+    r.symbolTable = symbols_.memoryUsage() + indexById_.capacity() * static_cast<qint64>(sizeof(Tc3ValueStore::Index));
+    r.valueState = store_.memoryUsage();
+
+    // a facade is a QObject, its private data is allocated separately and is larger than the object
+    foreach(Tc3Value* v, store_.facades)
+    {
+        if(!v)
+            continue;
+
+        r.valueState += static_cast<qint64>(sizeof(Tc3Value)) + objectPrivateSize;
+        if(v->diff_)
+            r.valueState += static_cast<qint64>(sizeof(Tc3StructDiff)) + v->diff_->image().capacity();
+    }
+
+    r.perSymbol = r.symbols > 0 ? (r.symbolTable + r.valueState) / r.symbols : 0;
+    return r;
 }
 
-void Tc3Manager::disableNotify(htype h)
+Tc3Manager::LaneStatistics Tc3Manager::laneStatistics(Tc3Manager::Priority priority) const
 {
-    if(!h)
-        return;
+    const Lane& lane = lanes_[priority];
 
-    long errorId = AdsSyncDelDeviceNotificationReqEx(adsport_, &adsadr_, h);
-    if (errorId)
+    LaneStatistics r;
+    r.requests = static_cast<quint64>(lane.requests.load());
+    r.totalWait_us = lane.wait_ns.load() / 1000;
+    r.maxWait_us = lane.maxWait_ns.load() / 1000;
+    return r;
+}
+
+void Tc3Manager::resetLaneStatistics()
+{
+    for(Lane& lane : lanes_)
     {
-        emit error(tc3AdsError(errorId));
+        lane.requests.store(0);
+        lane.wait_ns.store(0);
+        lane.maxWait_ns.store(0);
     }
 }
 
+void Tc3Manager::setErrorInterval(int interval_ms)
+{
+    QMutexLocker errorLocker(&errorMutex_);
+    errorInterval_ = interval_ms;
+}
+
+int Tc3Manager::errorInterval() const
+{
+    return errorInterval_;
+}
 
-Tc3Value * Tc3Manager::value(const QString& name, int datatypeSizeInByte/*=Tc3Manager::AutoType*/, Tc3Manager::NotificationType notificationType, int cycleTime_ms/*=300*/, int maxDelay_ms/*=1000*/)
+void Tc3Manager::setTransferClient(Tc3AmsClient* client)
 {
-    QMutexLocker locker(&mutex_);
+    transferClient_ = client;
+}
+
+Tc3AmsClient* Tc3Manager::transferClient() const
+{
+    return transferClient_;
+}
 
-    // check if we are already managing the requested value
-    foreach(Tc3Value* v, vars_)
+// Called from any thread. Duplicates within the error interval only increment a counter, nothing
+// is allocated and no signal is emitted for them
+void Tc3Manager::reportError(long code, Tc3Manager::Operation operation, Tc3SymbolTable::Id symbol/*=Tc3SymbolTable::InvalidId*/)
+{
     {
-        if(v->name_ == name)
-            return v;
-    }
+        QMutexLocker errorLocker(&errorMutex_);
+        const qint64 now = clock_.elapsed();
+        const quint64 key = errorKey(code, symbol);
+        auto it = errors_.find(key);
+        if(it != errors_.end() && now - it->reported < errorInterval_)
+        {
+            it->suppressed++;
+            it->operation = operation;
+            if(!errorFlushPending_)
+            {
+                errorFlushPending_ = true;
+                QMetaObject::invokeMethod(this, "flushErrors", Qt::QueuedConnection);
+            }
+            return;
+        }
 
-    // the value that has been requested is not yet connected to, so create a new value
-    Tc3Value *v = new Tc3Value(name, this, datatypeSizeInByte);
-    vars_.append(v);
-    v->enableNotify(notificationType, cycleTime_ms, maxDelay_ms);
+        if(errorInterval_ > 0)
+            errors_.insert(key, { now, 0, operation });
+    }
 
-    return v;
+    emitError(code, operation, symbol, 1);
 }
 
-Tc3Value *Tc3Manager::value(Tc3Manager::htype nhandle)
+void Tc3Manager::emitError(long code, Tc3Manager::Operation operation, Tc3SymbolTable::Id symbol, int count)
 {
-    QMutexLocker locker(&mutex_);
+    ErrorEvent e;
+    e.code = code;
+    e.operation = operation;
+    e.count = count;
+    if(symbol != Tc3SymbolTable::InvalidId)
+    {
+        QMutexLocker locker(&mutex_);
+        e.symbol = symbols_.name(symbol);
+    }
+
+    emit errorOccurred(e);
+    emit error(e.toString());
+}
 
-    // check if we are managing a value with the specified notification handle
-    foreach(Tc3Value* v, vars_)
+// runs in the thread of the manager, reports the suppressed errors of every expired interval and
+// drops the errors that didn't occur again
+void Tc3Manager::flushErrors()
+{
+    QVector<std::pair<quint64, ErrorState> > due;
     {
-        if(v->nh_ == nhandle)
-            return v;
+        QMutexLocker errorLocker(&errorMutex_);
+        const qint64 now = clock_.elapsed();
+        qint64 next = -1;
+        for(auto it=errors_.begin(); it!=errors_.end();)
+        {
+            const qint64 left = it->reported + errorInterval_ - now;
+            if(left > 0)
+            {
+                if(it->suppressed)
+                    next = next < 0 ? left : std::min(next, left);
+
+                ++it;
+            }
+            else if(it->suppressed)
+            {
+                // the next interval starts with this report
+                due.append(std::make_pair(it.key(), *it));
+                it->reported = now;
+                it->suppressed = 0;
+                ++it;
+            }
+            else
+            {
+                it = errors_.erase(it);
+            }
+        }
+
+        errorFlushPending_ = next >= 0;
+        if(errorFlushPending_)
+            errorTimer_.start(static_cast<int>(next));
     }
 
-    return nullptr;
+    for(const auto& d : due)
+        emitError(errorCode(d.first), d.second.operation, errorSymbol(d.first), d.second.suppressed);
 }
 
-void Tc3Manager::removeValue(Tc3Value *v)
+const Tc3TypeDescriptor* Tc3Manager::typeDescriptor(const QString& typeName, int size)
 {
-    QMutexLocker locker(&mutex_);
-    vars_.erase(std::remove_if(vars_.begin(), vars_.end(), [v](Tc3Value* vit){ return v == vit; }), vars_.end());
+    return types_.resolve(typeName, size, [this](const QString& name, QString& baseType){ return datatypeBaseType(name, baseType); });
 }
 
-bool Tc3Manager::isConnected() const
+// false if the datatype information could not be read, an unknown datatype has no base type
+bool Tc3Manager::datatypeBaseType(const QString& typeName, QString& baseType)
 {
-    return mhandle_ > 0;
+    baseType.clear();
+    if (!isConnected())
+        return false;
+
+    QByteArray name = typeName.toLatin1();
+    QByteArray buffer(0xFFFF, 0);
+    long errorId = 0;
+    {
+        LaneLocker lane(this, Bulk);
+        errorId = transport_->readWrite(port(), &adsadr_, Tc3Ads::SymDtInfoByNameEx, 0, static_cast<unsigned int>(buffer.size()), buffer.data(),
+                                        static_cast<unsigned int>(name.size()), name.constData(), nullptr);
+    }
+
+    // unknown datatypes are not an error here, they are simply not converted automatically
+    if (errorId)
+        return errorId == ADSERR_DEVICE_SYMBOLNOTFOUND;
+
+    const Tc3Ads::DatatypeEntry* entry = reinterpret_cast<const Tc3Ads::DatatypeEntry*>(buffer.constData());
+
+    // structs, function blocks and unions have sub items, aliases and enumerations have a base type
+    if(entry->subItems == 0)
+        baseType = QString::fromLatin1(Tc3Ads::datatypeType(entry), entry->typeLength);
+
+    return true;
 }
 
-void Tc3Manager::onConnectionChanged(bool connected)
+// direct members of a struct, function block or union, empty for everything else
+QVector<Tc3StructDiff::Field> Tc3Manager::datatypeMembers(const QString& typeName)
 {
-    QMutexLocker locker(&mutex_);
+    QVector<Tc3StructDiff::Field> r;
+    if (!isConnected())
+        return r;
 
-    // AdsRouter is disconnected, but Tc3Manager is not aware of it right now
-    if(isConnected() && !connected)
+    QByteArray name = typeName.toLatin1();
+    QByteArray buffer(0xFFFF, 0);
+    long errorId = 0;
     {
-        mhandleMem_ = mhandle_;
-        mhandle_ = 0;
-        emit error("AdsRouter disconnected!");
+        LaneLocker lane(this, Bulk);
+        errorId = transport_->readWrite(port(), &adsadr_, Tc3Ads::SymDtInfoByNameEx, 0, static_cast<unsigned int>(buffer.size()), buffer.data(),
+                                        static_cast<unsigned int>(name.size()), name.constData(), nullptr);
+    }
+    if (errorId)
+        return r;
 
-        // Set all values to invalid
-        foreach(Tc3Value* v, vars_)
-        {
-            v->invalidate();
-        }
+    const Tc3Ads::DatatypeEntry* entry = reinterpret_cast<const Tc3Ads::DatatypeEntry*>(buffer.constData());
+    const char* end = buffer.constData() + buffer.size();
+    const Tc3Ads::DatatypeEntry* item = Tc3Ads::datatypeFirstSubItem(entry);
+    for(int i=0; i<entry->subItems; ++i)
+    {
+        if(reinterpret_cast<const char*>(item) + sizeof(Tc3Ads::DatatypeEntry) > end || !item->entryLength)
+            break;
+
+        r.append({ QString::fromLatin1(Tc3Ads::datatypeName(item), item->nameLength), item->offs, item->size });
+        item = Tc3Ads::datatypeNextSubItem(item);
     }
 
-    // start a timer to reconnect to twincat in case we lose the connection - reconnecting will set all values to "not connected state"
-    if(!connected && reconnectTimer_ < 0)
-        reconnectTimer_ = startTimer(5000);
+    return r;
 }
 
-void Tc3Manager::timerEvent(QTimerEvent * event)
+// Member layout of the symbol of a slot. Types without members (arrays, aliases) have a single
+// field with an empty name that covers the whole image
+bool Tc3Manager::structLayout(Tc3ValueStore::Index i, Tc3StructDiff& diff)
 {
     QMutexLocker locker(&mutex_);
-    Q_UNUSED(event)
+    if(!store_.isValid(i) || !store_.types[static_cast<int>(i)])
+        return false;
 
-    // try to reconnect
-    if(!mhandle_)
-        connect();
+    const int s = static_cast<int>(i);
+    const QString type = symbols_.typeName(store_.symbols[s]);
+    auto it = layouts_.constFind(type);
+    if(it == layouts_.constEnd())
+        it = layouts_.insert(type, datatypeMembers(type));
+
+    QVector<Tc3StructDiff::Field> fields = it.value();
+    if(fields.isEmpty())
+        fields.append({ QString(), 0, static_cast<quint32>(store_.sizes[s]) });
+
+    diff.setLayout(fields, store_.sizes[s]);
+    return true;
 }
 
-unsigned short Tc3Manager::adsState(long port)
+long Tc3Manager::syncReadReq(htype h, void *data, int size, Priority priority/*=Normal*/)
 {
-    unsigned short adsState=0;
-    unsigned short deviceState;
-    long errorId = AdsSyncReadStateReqEx(port, &adsadr_, &adsState, &deviceState);
-    if(errorId)
+    if(!h || !data || !isConnected() || size <= 0)
+        return NotConnected;
+
+    long errorId = 0;
     {
-        emit error(tc3AdsError(errorId));
+        LaneLocker lane(this, priority);
+        errorId = transport_->read(lane.port(), &adsadr_, ADSIGRP_SYM_VALBYHND, h, size, data, nullptr);
     }
+    if (errorId)
+        checkSymbolVersion(errorId);
 
-    return adsState;
+    return errorId;
 }
 
-/*static*/
-int Tc3Manager::tc3ArraySize(const QString& symbolType, int *arrayStart /*= nullptr*/ )
+// raw read of an index group, e.g. the symbol upload
+bool Tc3Manager::syncReadReq(quint32 indexGroup, quint32 indexOffset, void *data, int size, utype *bytesRead)
 {
-    static QRegExp rx("ARRAY.\\[(\\d+)..(\\d+)\\].OF.(\\d+)");
+    if(!data || !isConnected() || size <= 0)
+        return false;
 
-    if(symbolType.left(5) == "ARRAY")
+    long errorId = 0;
     {
-        rx.indexIn(symbolType);
-        if(arrayStart)
-            *arrayStart = rx.cap(1).toInt();
-
-        return rx.cap(2).toInt() - rx.cap(1).toInt() + 1;
+        LaneLocker lane(this, Bulk);
+        errorId = transport_->read(port(), &adsadr_, indexGroup, indexOffset, static_cast<unsigned int>(size), data, bytesRead);
     }
-    else if(symbolType.left(7) == "WSTRING")
+    if (errorId)
     {
-        if(arrayStart)
-            *arrayStart = 0;
+        reportError(errorId, Symbols);
+    }
+    return !errorId;
+}
 
-        // abuse arraysize to distinct between 16bit/character strings (WSTRING) and 8bit/character strings (STRING),
-        // this make kinda sense
-        return 2;
+long Tc3Manager::syncWriteReq(htype h, const void *data, int size, Priority priority/*=Normal*/)
+{
+    if(!h || !data || !isConnected())
+        return NotConnected;
 
+    long errorId = 0;
+    {
+        LaneLocker lane(this, priority);
+        errorId = transport_->write(lane.port(), &adsadr_, ADSIGRP_SYM_VALBYHND, h, size, data);
     }
+    if (errorId)
+        checkSymbolVersion(errorId);
 
-    return 1;
+    return errorId;
 }
 
+// Values of high priority by index group and offset, the handles of adsport are not valid on
+// highPort_. The address of a slot is updated with its handle (attachValue)
+long Tc3Manager::highReadReq(quint32 indexGroup, quint32 indexOffset, void *data, int size)
+{
+    if(!indexGroup || !data || !isConnected() || size <= 0)
+        return NotConnected;
 
-/*static*/
-QVariant::Type Tc3Manager::tc3VariantType(const QString& symbolType, int size)
-{
-    // convert native twincat types to qvariant types
-    if(symbolType == "INT" || size == 2)
-        return static_cast<QVariant::Type>(QMetaType::Short);
-    else if(symbolType == "DINT")
-        return QVariant::Int;
-    else if(symbolType == "UDINT")
-        return QVariant::UInt;
-    else if(symbolType == "UINT")
-        return  static_cast<QVariant::Type>(QMetaType::UShort);
-    else if(symbolType == "BYTE")
-        return QVariant::Char;
-    else if(symbolType == "BOOL" || size == 1)
-        return QVariant::Bool;
-    else if(symbolType == "REAL" || size == 4)
-        return static_cast<QVariant::Type>(QMetaType::Float);
-    else if(symbolType == "LREAL" || size == 8)
-        return QVariant::Double;
-    else if(symbolType == "WORD")
-        return static_cast<QVariant::Type>(QMetaType::UShort);
-    else if(symbolType == "LWORD")
-        return QVariant::ULongLong;
-    else if(symbolType.left(7) == "WSTRING" || symbolType.left(6) == "STRING" || symbolType.right(QString("T_MaxString").length()) == "T_MaxString")
-        return QVariant::String; // Distinct between wchar and char with tc3ArraySize
-
-    // if we are dealing with an array, try to find it's type (only works if this is a native type)
-    static QRegExp rx("ARRAY.\\[(\\d+)..(\\d+)\\].OF.(\\D+)");
-    if(symbolType.left(5) == "ARRAY")	// e.g. ARRAY [1..12] OF REAL
-    {
-        rx.indexIn(symbolType);
-        return tc3VariantType(rx.cap(3), -1);
-    }
-
-    return QVariant::Type::Invalid;
+    long errorId = 0;
+    {
+        LaneLocker lane(this, High);
+        errorId = transport_->read(lane.port(), &adsadr_, indexGroup, indexOffset, static_cast<unsigned int>(size), data, nullptr);
+    }
+    if (errorId)
+        checkSymbolVersion(errorId);
+
+    return errorId;
 }
 
-/*static*/
+long Tc3Manager::highWriteReq(quint32 indexGroup, quint32 indexOffset, const void *data, int size)
+{
+    if(!indexGroup || !data || !isConnected())
+        return NotConnected;
+
+    long errorId = 0;
+    {
+        LaneLocker lane(this, High);
+        errorId = transport_->write(lane.port(), &adsadr_, indexGroup, indexOffset, static_cast<unsigned int>(size), data);
+    }
+    if (errorId)
+        checkSymbolVersion(errorId);
+
+    return errorId;
+}
+
+// Handles that became invalid with an online change are bound again, in case the notification
+// of the symbol version got lost
+void Tc3Manager::checkSymbolVersion(long errorId)
+{
+    if(errorId != ADSERR_DEVICE_SYMBOLNOTACTIVE && errorId != ADSERR_DEVICE_SYMBOLVERSIONINVALID)
+        return;
+
+    if(!rebindPending_.fetchAndStoreOrdered(1))
+        QMetaObject::invokeMethod(this, "onSymbolsChanged", Qt::QueuedConnection);
+}
+
+// acquires the handles of all names with as few requests as possible, the handle of a name
+// that can not be resolved is 0
+bool Tc3Manager::sumHandleReq(const QList<QByteArray>& names, QVector<htype>& handles)
+{
+    handles.fill(0, names.size());
+    if(names.isEmpty())
+        return true;
+
+    if(!isConnected())
+        return false;
+
+    QByteArray request;
+    QByteArray response;
+    for(int first=0; first<names.size(); first+=Tc3Ads::MaxSumRequests)
+    {
+        const int n = std::min(Tc3Ads::MaxSumRequests, names.size() - first);
+
+        request.clear();
+        for(int i=first; i<first+n; ++i)
+        {
+            const Tc3Ads::SumReadWriteRequest r = { ADSIGRP_SYM_HNDBYNAME, 0, sizeof(quint32), static_cast<quint32>(names[i].size()) };
+            request.append(reinterpret_cast<const char*>(&r), sizeof(r));
+        }
+        for(int i=first; i<first+n; ++i)
+            request.append(names[i]);
+
+        // error code and length of each sub request, followed by the handles
+        response.resize(n * static_cast<int>(3 * sizeof(quint32)));
+        utype bytesRead = 0;
+        long errorId = 0;
+        {
+            LaneLocker lane(this, Bulk);
+            errorId = transport_->readWrite(port(), &adsadr_, Tc3Ads::SumUpReadWrite, static_cast<unsigned int>(n),
+                                            static_cast<unsigned int>(response.size()), response.data(),
+                                            static_cast<unsigned int>(request.size()), request.constData(), &bytesRead);
+        }
+        if (errorId)
+        {
+            reportError(errorId, Handle);
+            return false;
+        }
+
+        const quint32* header = reinterpret_cast<const quint32*>(response.constData());
+        const char* data = response.constData() + n * static_cast<int>(2 * sizeof(quint32));
+        const char* end = response.constData() + std::min(static_cast<int>(bytesRead), response.size());
+        for(int i=0; i<n; ++i)
+        {
+            const quint32 result = header[2 * i];
+            const quint32 length = header[2 * i + 1];
+            if(data + length > end)
+                break;
+
+            if(result)
+                reportError(static_cast<long>(result), Handle, symbols_.find(QString::fromLatin1(names[first + i])));
+            else if(length == sizeof(quint32))
+                handles[first + i] = *reinterpret_cast<const quint32*>(data);
+
+            data += length;
+        }
+    }
+
+    return true;
+}
+
+// the data of all sub requests is returned back to back, also for failed sub requests
+bool Tc3Manager::sumReadReq(const QVector<Tc3Ads::SumRequest>& requests, QByteArray& data, QVector<quint32>& results)
+{
+    results.fill(0, requests.size());
+    data.clear();
+    if(requests.isEmpty())
+        return true;
+
+    if(!isConnected())
+        return false;
+
+    QByteArray response;
+    for(int first=0; first<requests.size(); first+=Tc3Ads::MaxSumRequests)
+    {
+        const int n = std::min(Tc3Ads::MaxSumRequests, requests.size() - first);
+        int length = 0;
+        for(int i=first; i<first+n; ++i)
+            length += static_cast<int>(requests[i].length);
+
+        response.resize(n * static_cast<int>(sizeof(quint32)) + length);
+        long errorId = 0;
+        {
+            LaneLocker lane(this, Bulk);
+            errorId = transport_->readWrite(port(), &adsadr_, Tc3Ads::SumUpRead, static_cast<unsigned int>(n),
+                                            static_cast<unsigned int>(response.size()), response.data(),
+                                            static_cast<unsigned int>(n * sizeof(Tc3Ads::SumRequest)), requests.constData() + first, nullptr);
+        }
+        if (errorId)
+        {
+            reportError(errorId, Read);
+            return false;
+        }
+
+        memcpy(results.data() + first, response.constData(), n * sizeof(quint32));
+        data.append(response.constData() + n * static_cast<int>(sizeof(quint32)), length);
+    }
+
+    return true;
+}
+
+bool Tc3Manager::sumWriteReq(const QVector<Tc3Ads::SumRequest>& requests, const QByteArray& data, QVector<quint32>& results, Priority priority/*=Bulk*/)
+{
+    results.fill(0, requests.size());
+    if(requests.isEmpty())
+        return true;
+
+    if(!isConnected())
+        return false;
+
+    // the plc limits the number of sub requests, split into several sum requests if needed
+    int offset = 0;
+    QByteArray request;
+    for(int first=0; first<requests.size(); first+=Tc3Ads::MaxSumRequests)
+    {
+        const int n = std::min(Tc3Ads::MaxSumRequests, requests.size() - first);
+        int length = 0;
+        for(int i=first; i<first+n; ++i)
+            length += static_cast<int>(requests[i].length);
+
+        request.clear();
+        request.append(reinterpret_cast<const char*>(requests.constData() + first), n * static_cast<int>(sizeof(Tc3Ads::SumRequest)));
+        request.append(data.constData() + offset, length);
+        offset += length;
+
+        long errorId = 0;
+        {
+            LaneLocker lane(this, priority);
+            errorId = transport_->readWrite(lane.port(), &adsadr_, Tc3Ads::SumUpWrite, static_cast<unsigned int>(n),
+                                            static_cast<unsigned int>(n * sizeof(quint32)), results.data() + first,
+                                            static_cast<unsigned int>(request.size()), request.constData(), nullptr);
+        }
+        if (errorId)
+        {
+            reportError(errorId, Write);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Tc3Manager::htype Tc3Manager::enableNotify(htype h, int size, Tc3Manager::NotificationType type, int cycleTimeMillisecond, int maxDelayMilliseconds, PAdsNotificationFuncEx callbackPtr)
+{
+    if (!h || !isConnected())
+        return 0;
+
+    AdsNotificationAttrib attrib;
+    attrib.cbLength = size;
+    attrib.nTransMode = type == Tc3Manager::NotificationType::Cycle ? ADSTRANS_SERVERCYCLE : ADSTRANS_SERVERONCHA;
+    attrib.nMaxDelay = maxDelayMilliseconds * 10000;
+    attrib.nCycleTime = cycleTimeMillisecond * 10000;
+
+    htype nh;
+    long errorId = 0;
+    {
+        LaneLocker lane(this, Bulk);
+        errorId = transport_->addNotification(port(), &adsadr_, ADSIGRP_SYM_VALBYHND, h, &attrib, callbackPtr, id_, &nh );
+    }
+    if (errorId)
+    {
+        reportError(errorId, Notify);
+        return 0;
+    }
+
+    return nh;
+}
+
+void Tc3Manager::disableNotify(htype h)
+{
+    if(!h)
+        return;
+
+    {
+        QMutexLocker locker(&mutex_);
+        notifications_.remove(h);
+    }
+
+    long errorId = 0;
+    {
+        LaneLocker lane(this, Bulk);
+        errorId = transport_->delNotification(port(), &adsadr_, h);
+    }
+    if (errorId)
+    {
+        reportError(errorId, Notify);
+    }
+}
+
+
+Tc3Value * Tc3Manager::value(const QString& name, int datatypeSizeInByte/*=Tc3Manager::AutoType*/, Tc3Manager::NotificationType notificationType, int cycleTime_ms/*=300*/, int maxDelay_ms/*=1000*/)
+{
+    QMutexLocker locker(&mutex_);
+
+    // check if we are already managing the requested value, it is notified at the faster rate
+    const Tc3SymbolTable::Id id = symbols_.insert(name);
+    Tc3ValueStore::Index i = indexOf(id);
+    if(store_.isValid(i) && store_.facades[static_cast<int>(i)])
+    {
+        if(!fits(i, datatypeSizeInByte))
+        {
+            reportError(SizeMismatch, Connect, id);
+            return nullptr;
+        }
+
+        mergeNotification(i, notificationType, cycleTime_ms, maxDelay_ms);
+        return store_.facades[static_cast<int>(i)];
+    }
+
+    // the value that has been requested has no facade yet, but it may be used by handles already
+    const bool created = !store_.isValid(i);
+    i = acquire(name, datatypeSizeInByte);
+    if(!store_.isValid(i))
+        return nullptr;
+
+    Tc3Value *v = new Tc3Value(this, i, this);
+
+    // don't turn off the notification of handles
+    if(created)
+        setNotification(i, notificationType, cycleTime_ms, maxDelay_ms);
+    else
+        mergeNotification(i, notificationType, cycleTime_ms, maxDelay_ms);
+
+    return v;
+}
+
+Tc3Handle Tc3Manager::handle(const QString& name, int datatypeSizeInByte/*=Tc3Manager::AutoType*/)
+{
+    return Tc3Handle(this, acquire(name, datatypeSizeInByte));
+}
+
+void Tc3Manager::release(const Tc3Handle& handle)
+{
+    if(handle.manager_ == this)
+        releaseSlot(handle.index_);
+}
+
+void Tc3Manager::release(const QVector<Tc3Handle>& handles)
+{
+    QMutexLocker locker(&mutex_);
+    foreach(const Tc3Handle& h, handles)
+        release(h);
+}
+
+void Tc3Manager::release(const QList<Tc3Value*>& values)
+{
+    QMutexLocker locker(&mutex_);
+    foreach(Tc3Value* v, values)
+    {
+        if(v && v->manager_ == this)
+            delete v;
+    }
+}
+
+Tc3ValueGroup *Tc3Manager::subscribe(const QString& pattern, Tc3Manager::NotificationType notificationType/*=NotificationType::None*/, int cycleTime_ms/*=300*/, int maxDelay_ms/*=1000*/)
+{
+    QMutexLocker locker(&mutex_);
+
+    Tc3ValueGroup *group = new Tc3ValueGroup(pattern, this, notificationType, cycleTime_ms, maxDelay_ms);
+    groups_.append(group);
+    group->refresh();
+
+    return group;
+}
+
+// Values for all nodes, like calling value(name) for each of them. Symbol information is taken
+// from the nodes and the handles of all new values are acquired with sum requests, so
+// registering thousands of values takes a few requests instead of two per value. Notifications
+// are still added one by one, AdsLib only dispatches to callbacks of notifications it added itself
+QList<Tc3Value*> Tc3Manager::values(const QVector<Tc3SymbolBrowser::Node>& nodes, Tc3Manager::NotificationType notificationType, int cycleTime_ms, int maxDelay_ms)
+{
+    QMutexLocker locker(&mutex_);
+
+    QList<Tc3Value*> r;
+    QList<int> created;
+    QList<Tc3SymbolTable::Id> ids;
+    QList<QByteArray> names;
+    foreach(const Tc3SymbolBrowser::Node& n, nodes)
+    {
+        const Tc3SymbolTable::Id id = symbols_.insert(n.name);
+        const Tc3ValueStore::Index i = indexOf(id);
+        if(store_.isValid(i))
+        {
+            r.append(facade(i));
+            continue;
+        }
+
+        const QByteArray type = n.type.toLatin1();
+        symbols_.setInfo(id, n.group, n.offset, n.size, type.constData(), type.size());
+
+        created.append(r.size());
+        ids.append(id);
+        names.append(n.name.toLatin1());
+        r.append(nullptr);
+    }
+
+    if(created.isEmpty())
+        return r;
+
+    // without a connection the values connect one by one after reconnecting
+    QVector<htype> handles;
+    if(!sumHandleReq(names, handles))
+        handles.fill(0, names.size());
+
+    QList<Tc3Value*> read;
+    for(int i=0; i<created.size(); ++i)
+    {
+        Tc3ValueStore::Index v;
+        {
+            QMutexLocker writeLocker(&writeMutex_);
+            v = store_.allocate(ids[i], AutoType);
+        }
+        setIndexOf(ids[i], v);
+
+        // without a handle, the value is connected when the manager reconnects. The settings are the
+        // request of the facade, attachValue merges the subscriptions of the slot
+        const int s = static_cast<int>(v);
+        setNotification(v, notificationType, cycleTime_ms, maxDelay_ms);
+        if(handles[i])
+            attachValue(v, handles[i]);
+
+        // the facade takes over the reference of the new slot
+        Tc3Value *f = new Tc3Value(this, v, this);
+        r[created[i]] = f;
+
+        const Tc3TypeDescriptor* type = store_.types[s];
+        if(type && type->decode)
+            read.append(f);
+    }
+
+    // initial values of all new values in one go
+    emitInitialValues(read);
+    return r;
+}
+
+// reads the values of all facades with sum requests and emits changed for each of them
+void Tc3Manager::emitInitialValues(const QList<Tc3Value*>& facades)
+{
+    QVector<Tc3Ads::SumRequest> requests;
+    foreach(Tc3Value* f, facades)
+    {
+        const int s = static_cast<int>(f->index_);
+        requests.append({ ADSIGRP_SYM_VALBYHND, static_cast<quint32>(store_.handles[s]), static_cast<quint32>(store_.sizes[s]) });
+    }
+
+    QByteArray data;
+    QVector<quint32> results;
+    if(!sumReadReq(requests, data, results))
+        return;
+
+    const char* p = data.constData();
+    for(int i=0; i<facades.size(); ++i)
+    {
+        Tc3Value *f = facades[i];
+        const int s = static_cast<int>(f->index_);
+        const Tc3TypeDescriptor* type = store_.types[s];
+        if(!results[i] && type->decode(*type, p, store_.sizes[s], f->cached_))
+            emit f->changed(f->cached_);
+
+        p += store_.sizes[s];
+    }
+}
+
+// Most handles stay valid with an online change. The uploaded symbol table is compared with the
+// metadata the values have been bound with, only values whose symbol moved, changed its type or
+// size, disappeared or appeared are bound again, with sum requests for the handles and values
+void Tc3Manager::rebindValues()
+{
+    QMutexLocker locker(&mutex_);
+    Tc3SymbolBrowser* browser = symbolBrowser();
+    if(!browser)
+        return;
+
+    QVector<Tc3ValueStore::Index> rebind;
+    QVector<htype> released;
+    for(int s=0; s<store_.size(); ++s)
+    {
+        if(store_.references[s] <= 0)
+            continue;
+
+        const Tc3SymbolTable::Id id = store_.symbols[s];
+        const Tc3SymbolBrowser::Node n = browser->node(symbols_.name(id));
+        const bool bound = store_.types[s] != nullptr;
+        if(bound)
+        {
+            const Tc3SymbolTable::Symbol& old = symbols_.symbol(id);
+            if(n.isValid() && n.group == old.group && n.offset == old.offset && n.size == old.size && n.type == symbols_.typeName(id))
+                continue;
+
+            // the old handle is released, also if the symbol is gone
+            if(store_.notifications[s])
+            {
+                disableNotify(store_.notifications[s]);
+                store_.notifications[s] = 0;
+            }
+
+            released.append(store_.handles[s]);
+            QMutexLocker writeLocker(&writeMutex_);
+            store_.handles[s] = 0;
+            store_.types[s] = nullptr;
+        }
+
+        if(!n.isValid())
+        {
+            if(bound && store_.facades[s])
+                emit store_.facades[s]->changed(QVariant());
+
+            continue;
+        }
+
+        const QByteArray type = n.type.toLatin1();
+        symbols_.setInfo(id, n.group, n.offset, n.size, type.constData(), type.size());
+        rebind.append(static_cast<Tc3ValueStore::Index>(s));
+    }
+
+    releaseHandles(released);
+    if(rebind.isEmpty())
+        return;
+
+    QList<QByteArray> names;
+    foreach(Tc3ValueStore::Index i, rebind)
+        names.append(symbols_.name(store_.symbols[static_cast<int>(i)]).toLatin1());
+
+    QVector<htype> handles;
+    if(!sumHandleReq(names, handles))
+        return;
+
+    QList<Tc3Value*> read;
+    for(int k=0; k<rebind.size(); ++k)
+    {
+        if(!handles[k])
+            continue;
+
+        const int s = static_cast<int>(rebind[k]);
+        attachValue(rebind[k], handles[k]);
+
+        Tc3Value* f = store_.facades[s];
+        if(f && store_.types[s]->decode)
+            read.append(f);
+    }
+
+    emitInitialValues(read);
+}
+
+// called with the handle and notification of a slot that has been released
+void Tc3Manager::queueRelease(htype h, htype nh)
+{
+    QMutexLocker releaseLocker(&releaseMutex_);
+    if(h)
+        releasedHandles_.append(h);
+
+    if(nh)
+        releasedNotifications_.append(nh);
+
+    // whatever is released until the thread gets to it is released in one go
+    if(releasePending_ || !releaser_)
+        return;
+
+    releasePending_ = true;
+    QMetaObject::invokeMethod(releaser_, [this](){ processReleases(); }, Qt::QueuedConnection);
+}
+
+// runs in releaseThread_. Notifications are deleted one by one, AdsLib keeps track of the
+// notifications it added itself and has no sum command for deleting them
+void Tc3Manager::processReleases()
+{
+    QVector<htype> handles;
+    QVector<htype> notifications;
+    {
+        QMutexLocker releaseLocker(&releaseMutex_);
+        handles.swap(releasedHandles_);
+        notifications.swap(releasedNotifications_);
+        releasePending_ = false;
+    }
+
+    if(!isConnected())
+        return;
+
+    foreach(htype nh, notifications)
+    {
+        long errorId = 0;
+        {
+            LaneLocker lane(this, Bulk);
+            errorId = transport_->delNotification(port(), &adsadr_, nh);
+        }
+        if (errorId)
+            reportError(errorId, Release);
+    }
+
+    releaseHandles(handles);
+}
+
+// the thread has no parent, connect may run in the resolver thread
+void Tc3Manager::startReleaser()
+{
+    QMutexLocker releaseLocker(&releaseMutex_);
+    if(releaseThread_)
+        return;
+
+    releasePending_ = false;
+    releaseThread_ = new QThread();
+    releaser_ = new QObject();
+    releaser_->moveToThread(releaseThread_);
+    QObject::connect(releaseThread_, &QThread::finished, releaser_, &QObject::deleteLater);
+    releaseThread_->start();
+}
+
+void Tc3Manager::stopReleaser()
+{
+    QThread* thread = nullptr;
+    {
+        QMutexLocker releaseLocker(&releaseMutex_);
+        thread = releaseThread_;
+        releaseThread_ = nullptr;
+        releaser_ = nullptr;
+    }
+
+    if(!thread)
+        return;
+
+    thread->quit();
+    thread->wait();
+    delete thread;
+}
+
+Tc3Manager::ConnectMode Tc3Manager::connectMode() const
+{
+    return connectMode_;
+}
+
+void Tc3Manager::queueConnect()
+{
+    // a connect that is still running is not queued again by the reconnect timer
+    if(!resolver_ || !connectPending_.testAndSetOrdered(0, 1))
+        return;
+
+    QMetaObject::invokeMethod(resolver_, [this](){ connectDeferred(); }, Qt::QueuedConnection);
+}
+
+// runs in resolveThread_, mutex_ is only held while the values are queued for resolvePending
+void Tc3Manager::connectDeferred()
+{
+    connect();
+    connectPending_.store(0);
+}
+
+void Tc3Manager::queueResolve(Tc3ValueStore::Index i)
+{
+    QMutexLocker locker(&mutex_);
+    unresolved_.append(i);
+
+    // whatever is requested until the thread gets to it is resolved in one go
+    if(resolvePending_ || !resolver_)
+        return;
+
+    resolvePending_ = true;
+    QMetaObject::invokeMethod(resolver_, [this](){ resolvePending(); }, Qt::QueuedConnection);
+}
+
+// runs in resolveThread_. The handles of the batch are acquired with sum requests, the metadata
+// comes from the uploaded symbol table and the initial values are read with sum requests as well.
+// mutex_ is not held during any request, the values are attached in the thread of the manager
+void Tc3Manager::resolvePending()
+{
+    QVector<Tc3ValueStore::Index> batch;
+    QVector<Tc3SymbolTable::Id> ids;
+    QList<QByteArray> names;
+    bool browserValid = false;
+    {
+        QMutexLocker locker(&mutex_);
+        resolvePending_ = false;
+
+        QSet<Tc3ValueStore::Index> queued;
+        foreach(Tc3ValueStore::Index i, unresolved_)
+        {
+            const int s = static_cast<int>(i);
+            if(!store_.isValid(i) || store_.types[s] || queued.contains(i))
+                continue;
+
+            queued.insert(i);
+            batch.append(i);
+            ids.append(store_.symbols[s]);
+            names.append(symbols_.name(store_.symbols[s]).toLatin1());
+        }
+        unresolved_.clear();
+        browserValid = browserValid_;
+    }
+
+    // values requested while not connected are queued again by connect
+    if(batch.isEmpty() || !isConnected())
+        return;
+
+    if(!browserValid)
+    {
+        Tc3SymbolBrowser browser(this);
+        if(browser.refresh())
+        {
+            QMutexLocker locker(&mutex_);
+            if(!browserValid_)
+            {
+                browser_ = browser;
+                browserValid_ = true;
+            }
+        }
+    }
+
+    QVector<htype> handles;
+    if(!sumHandleReq(names, handles))
+        return;
+
+    QVector<bool> found(batch.size(), false);
+    {
+        QMutexLocker locker(&mutex_);
+        for(int k=0; k<batch.size(); ++k)
+        {
+            // released in the meantime, the handle is given back below
+            if(!handles[k] || !holds(batch[k], ids[k], names[k]))
+                continue;
+
+            const Tc3SymbolBrowser::Node n = browserValid_ ? browser_.node(QString::fromLatin1(names[k])) : Tc3SymbolBrowser::Node();
+            if(!n.isValid())
+                continue;
+
+            const QByteArray type = n.type.toLatin1();
+            symbols_.setInfo(ids[k], n.group, n.offset, n.size, type.constData(), type.size());
+            found[k] = true;
+        }
+    }
+
+    // symbols missing in the upload (or without an upload) are looked up one by one, each is a
+    // round trip and runs without mutex_ as well
+    QVector<long> errors(batch.size(), 0);
+    QVector<QByteArray> entries(batch.size());
+    for(int k=0; k<batch.size(); ++k)
+    {
+        if(handles[k] && !found[k])
+            errors[k] = symbolEntry(names[k], entries[k]);
+    }
+
+    QVector<Tc3Ads::SumRequest> requests;
+    {
+        QMutexLocker locker(&mutex_);
+        for(int k=0; k<batch.size(); ++k)
+        {
+            if(!handles[k])
+                continue;
+
+            const bool released = !holds(batch[k], ids[k], names[k]);
+            if(released || (!found[k] && errors[k]))
+            {
+                if(!released)
+                    reportError(errors[k], Symbols, ids[k]);
+
+                queueRelease(handles[k], 0);
+                handles[k] = 0;
+                continue;
+            }
+
+            if(!found[k])
+                setSymbolEntry(ids[k], entries[k]);
+
+            requests.append({ ADSIGRP_SYM_VALBYHND, static_cast<quint32>(handles[k]), symbols_.symbol(ids[k]).size });
+        }
+    }
+
+    // a failed read only costs the initial values, the values are connected anyway
+    QByteArray data;
+    QVector<quint32> results;
+    QVector<QByteArray> images(batch.size());
+    if(sumReadReq(requests, data, results))
+    {
+        int r = 0;
+        int offset = 0;
+        for(int k=0; k<batch.size(); ++k)
+        {
+            if(!handles[k])
+                continue;
+
+            const int size = static_cast<int>(requests[r].length);
+            if(!results[r])
+                images[k] = data.mid(offset, size);
+
+            offset += size;
+            ++r;
+        }
+    }
+
+    QMetaObject::invokeMethod(this, [this, batch, ids, names, handles, images](){ completeResolve(batch, ids, names, handles, images); }, Qt::QueuedConnection);
+}
+
+// attaches the values of a batch of resolvePending, values that have been released or
+// connected otherwise in the meantime only give back their handle
+void Tc3Manager::completeResolve(const QVector<Tc3ValueStore::Index>& batch, const QVector<Tc3SymbolTable::Id>& ids, const QList<QByteArray>& names, const QVector<htype>& handles, const QVector<QByteArray>& images)
+{
+    QMutexLocker locker(&mutex_);
+
+    // the handles belong to the old port after a reconnect, connect has queued the values again
+    if(!isConnected())
+        return;
+
+    for(int k=0; k<batch.size(); ++k)
+    {
+        if(!handles[k])
+            continue;
+
+        const Tc3ValueStore::Index i = batch[k];
+        const int s = static_cast<int>(i);
+        if(!holds(i, ids[k], names[k]) || store_.types[s])
+        {
+            queueRelease(handles[k], 0);
+            continue;
+        }
+
+        attachValue(i, handles[k]);
+
+        Tc3Value* f = store_.facades[s];
+        if(!f)
+            continue;
+
+        const Tc3TypeDescriptor* type = store_.types[s];
+        if(type->decode && images[k].size() == store_.sizes[s] && type->decode(*type, images[k].constData(), images[k].size(), f->cached_))
+            emit f->changed(f->cached_);
+
+        emit f->ready();
+    }
+}
+
+void Tc3Manager::stopResolver()
+{
+    if(!resolveThread_)
+        return;
+
+    {
+        QMutexLocker locker(&mutex_);
+        resolver_ = nullptr;
+    }
+
+    resolveThread_->quit();
+    resolveThread_->wait();
+    delete resolveThread_;
+    resolveThread_ = nullptr;
+}
+
+// releases handles with sum requests, results are ignored as the handles may be invalid already
+void Tc3Manager::releaseHandles(const QVector<htype>& handles)
+{
+    QVector<Tc3Ads::SumRequest> requests;
+    QByteArray data;
+    foreach(htype h, handles)
+    {
+        if(!h)
+            continue;
+
+        const quint32 handle = static_cast<quint32>(h);
+        requests.append({ ADSIGRP_SYM_RELEASEHND, 0, sizeof(handle) });
+        data.append(reinterpret_cast<const char*>(&handle), sizeof(handle));
+    }
+
+    QVector<quint32> results;
+    sumWriteReq(requests, data, results);
+}
+
+Tc3Value *Tc3Manager::value(Tc3Manager::htype nhandle)
+{
+    QMutexLocker locker(&mutex_);
+    const Tc3ValueStore::Index i = notifications_.value(nhandle, Tc3ValueStore::InvalidIndex);
+    return store_.isValid(i) ? store_.facades[static_cast<int>(i)] : nullptr;
+}
+
+Tc3ValueStore::Index Tc3Manager::indexOf(Tc3SymbolTable::Id id) const
+{
+    return static_cast<int>(id) < indexById_.size() ? indexById_[static_cast<int>(id)] : static_cast<Tc3ValueStore::Index>(Tc3ValueStore::InvalidIndex);
+}
+
+// whether a request of datatypeSizeInByte can share the slot, automatic types take any slot
+bool Tc3Manager::fits(Tc3ValueStore::Index i, int datatypeSizeInByte) const
+{
+    const int s = static_cast<int>(i);
+    if(datatypeSizeInByte < 0)
+        return true;
+
+    if(store_.requestedSize[s] >= 0 && store_.requestedSize[s] != datatypeSizeInByte)
+        return false;
+
+    return !store_.types[s] || store_.sizes[s] == datatypeSizeInByte;
+}
+
+void Tc3Manager::setIndexOf(Tc3SymbolTable::Id id, Tc3ValueStore::Index i)
+{
+    while(indexById_.size() <= static_cast<int>(id))
+        indexById_.append(Tc3ValueStore::InvalidIndex);
+
+    indexById_[static_cast<int>(id)] = i;
+}
+
+// slot of a symbol, with one more reference. A new slot tries to connect right away
+Tc3ValueStore::Index Tc3Manager::acquire(const QString& name, int datatypeSizeInByte)
+{
+    QMutexLocker locker(&mutex_);
+
+    const Tc3SymbolTable::Id id = symbols_.insert(name);
+    Tc3ValueStore::Index i = indexOf(id);
+    if(store_.isValid(i))
+    {
+        // the slot is shared, a user type of another size would read past its buffer
+        if(!fits(i, datatypeSizeInByte))
+        {
+            reportError(SizeMismatch, Connect, id);
+            return Tc3ValueStore::InvalidIndex;
+        }
+
+        store_.references[static_cast<int>(i)]++;
+        return i;
+    }
+
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        i = store_.allocate(id, datatypeSizeInByte);
+    }
+    setIndexOf(id, i);
+
+    if(connectMode_ == Deferred)
+        queueResolve(i);
+    else
+        connectValue(i);
+
+    return i;
+}
+
+// drops a reference, the handle and notification on the plc are released with the last one
+void Tc3Manager::releaseSlot(Tc3ValueStore::Index i)
+{
+    QMutexLocker locker(&mutex_);
+    if(!store_.isValid(i))
+        return;
+
+    const int s = static_cast<int>(i);
+    if(store_.references[s] > 1)
+    {
+        store_.references[s]--;
+        return;
+    }
+
+    // remove the value first, such that it doesn't get flushed or notified anymore
+    const Tc3SymbolTable::Id id = store_.symbols[s];
+    const bool named = indexOf(id) == i;
+    if(named)
+        indexById_[static_cast<int>(id)] = Tc3ValueStore::InvalidIndex;
+
+    const htype nh = store_.notifications[s];
+    if(nh && notifications_.value(nh, Tc3ValueStore::InvalidIndex) == i)
+        notifications_.remove(nh);
+
+    idle_.remove(i);
+    latency_.remove(i);
+
+    if(store_.types[s])
+        queueRelease(store_.handles[s], nh);
+
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        if(store_.dirty[s])
+            dirty_.removeAll(i);
+
+        store_.release(i);
+    }
+
+    // names of symbols without a slot, e.g. misspelled ones, would stay in the table forever
+    if(named)
+        releaseSymbol(id);
+}
+
+// the id of the name is reused afterwards. Errors of the symbol that are still suppressed are
+// reported right away, they would carry the name of another symbol later
+void Tc3Manager::releaseSymbol(Tc3SymbolTable::Id id)
+{
+    QVector<std::pair<quint64, ErrorState> > due;
+    {
+        QMutexLocker errorLocker(&errorMutex_);
+        for(auto it=errors_.begin(); it!=errors_.end();)
+        {
+            if(errorSymbol(it.key()) != id)
+            {
+                ++it;
+                continue;
+            }
+
+            if(it->suppressed)
+                due.append(std::make_pair(it.key(), *it));
+
+            it = errors_.erase(it);
+        }
+    }
+
+    for(const auto& d : due)
+        emitError(errorCode(d.first), d.second.operation, id, d.second.suppressed);
+
+    symbols_.remove(id);
+}
+
+// whether slot i still holds the symbol, slots and ids of released symbols are reused
+bool Tc3Manager::holds(Tc3ValueStore::Index i, Tc3SymbolTable::Id id, const QByteArray& name) const
+{
+    return store_.isValid(i) && store_.symbols[static_cast<int>(i)] == id && symbols_.name(id).toLatin1() == name;
+}
+
+bool Tc3Manager::connectValue(Tc3ValueStore::Index i)
+{
+    QMutexLocker locker(&mutex_);
+    if(!store_.isValid(i))
+        return false;
+
+    const int s = static_cast<int>(i);
+    if(store_.types[s])
+        return true;
+
+    const Tc3SymbolTable::Id id = store_.symbols[s];
+    htype h = connectHandle(symbols_.name(id));
+    if(!h)
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        store_.handles[s] = 0;
+        return false;
+    }
+
+    if(!resolveSymbol(id))
+    {
+        disconnectHandle(h);
+        QMutexLocker writeLocker(&writeMutex_);
+        store_.handles[s] = 0;
+        return false;
+    }
+
+    attachValue(i, h);
+
+    // read current value from the plc, user types report their members with the first notification
+    Tc3Value* f = store_.facades[s];
+    if(f && store_.types[s]->decode)
+    {
+        emit f->changed(f->get());
+    }
+
+    return true;
+}
+
+void Tc3Manager::attachValue(Tc3ValueStore::Index i, htype h)
+{
+    const int s = static_cast<int>(i);
+    const Tc3SymbolTable::Id id = store_.symbols[s];
+    const int size = static_cast<int>(symbols_.symbol(id).size);
+
+    // user types are checked once here, accesses only compare the size afterwards
+    if(store_.requestedSize[s] >= 0 && store_.requestedSize[s] != size)
+        reportError(SizeMismatch, Connect, id);
+
+    // resolve the conversion once, samples are decoded without looking at the type name again
+    const Tc3TypeDescriptor* type = store_.requestedSize[s] < 0 ? typeDescriptor(symbols_.typeName(id), size) : Tc3TypeRegistry::userType();
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        store_.handles[s] = h;
+        store_.sizes[s] = size;
+        store_.groups[s] = symbols_.symbol(id).group;
+        store_.offsets[s] = symbols_.symbol(id).offset;
+        store_.types[s] = type;
+        store_.accessed[s] = clock_.elapsed();
+    }
+
+    applyNotification(i, true);
+    scheduleEviction();
+}
+
+void Tc3Manager::setFacade(Tc3ValueStore::Index i, Tc3Value* facade)
+{
+    QMutexLocker locker(&mutex_);
+    if(store_.isValid(i))
+        store_.facades[static_cast<int>(i)] = facade;
+}
+
+void Tc3Manager::releaseFacade(Tc3Value* facade)
+{
+    QMutexLocker locker(&mutex_);
+    const Tc3ValueStore::Index i = facade->index_;
+    if(!store_.isValid(i))
+        return;
+
+    if(store_.facades[static_cast<int>(i)] == facade)
+    {
+        store_.facades[static_cast<int>(i)] = nullptr;
+        store_.listened[static_cast<int>(i)] = false;
+    }
+
+    // handles may still use the slot
+    releaseSlot(i);
+    updateNotification(i);
+}
+
+// facade of a slot, a new facade takes one more reference of the slot
+Tc3Value *Tc3Manager::facade(Tc3ValueStore::Index i)
+{
+    QMutexLocker locker(&mutex_);
+    if(!store_.isValid(i))
+        return nullptr;
+
+    const int s = static_cast<int>(i);
+    if(store_.facades[s])
+        return store_.facades[s];
+
+    store_.references[s]++;
+    return new Tc3Value(this, i, this);
+}
+
+// the request of value() and the Tc3Value (token 0), subscriptions of handles are kept
+void Tc3Manager::setNotification(Tc3ValueStore::Index i, Tc3Manager::NotificationType type, int cycleTimeMillisecond, int maxDelayMillisecond)
+{
+    QMutexLocker locker(&mutex_);
+    if(!store_.isValid(i))
+        return;
+
+    QVector<Tc3ValueStore::Subscription>& subscriptions = store_.subscriptions[static_cast<int>(i)];
+    for(int k=0; k<subscriptions.size(); ++k)
+    {
+        if(subscriptions[k].token == 0)
+        {
+            subscriptions.remove(k);
+            break;
+        }
+    }
+
+    if(type != NotificationType::None)
+        subscriptions.append({ 0, Tc3ValueStore::Callback(), static_cast<quint8>(type), cycleTimeMillisecond, maxDelayMillisecond });
+
+    applyNotification(i);
+}
+
+// Several requests of the same value are served by one notification with the faster settings,
+// a change notification serves cycle requests as well
+void Tc3Manager::mergeNotification(Tc3ValueStore::Index i, Tc3Manager::NotificationType type, int cycleTimeMillisecond, int maxDelayMillisecond)
+{
+    QMutexLocker locker(&mutex_);
+    if(!store_.isValid(i) || type == NotificationType::None)
+        return;
+
+    foreach(const Tc3ValueStore::Subscription& subscription, store_.subscriptions[static_cast<int>(i)])
+    {
+        if(subscription.token != 0)
+            continue;
+
+        const NotificationType current = static_cast<NotificationType>(subscription.type);
+        type = current == NotificationType::Change || type == NotificationType::Change ? NotificationType::Change : NotificationType::Cycle;
+        cycleTimeMillisecond = std::min(subscription.cycleTime, cycleTimeMillisecond);
+        maxDelayMillisecond = std::min(subscription.maxDelay, maxDelayMillisecond);
+    }
+
+    setNotification(i, type, cycleTimeMillisecond, maxDelayMillisecond);
+}
+
+// a callback with its own notification settings, until it is removed with its token
+quint32 Tc3Manager::addSubscription(Tc3ValueStore::Index i, const Tc3ValueStore::Callback& callback, Tc3Manager::NotificationType type, int cycleTimeMillisecond, int maxDelayMillisecond)
+{
+    QMutexLocker locker(&mutex_);
+    if(!store_.isValid(i))
+        return 0;
+
+    // 0 is the request of the facade
+    if(++nextToken_ == 0)
+        ++nextToken_;
+
+    const quint32 token = nextToken_;
+    store_.subscriptions[static_cast<int>(i)].append({ token, callback, static_cast<quint8>(type), cycleTimeMillisecond, maxDelayMillisecond });
+    applyNotification(i);
+    return token;
+}
+
+void Tc3Manager::removeSubscription(Tc3ValueStore::Index i, quint32 token)
+{
+    QMutexLocker locker(&mutex_);
+    if(!store_.isValid(i) || token == 0)
+        return;
+
+    QVector<Tc3ValueStore::Subscription>& subscriptions = store_.subscriptions[static_cast<int>(i)];
+    for(int k=0; k<subscriptions.size(); ++k)
+    {
+        if(subscriptions[k].token == token)
+        {
+            subscriptions.remove(k);
+            applyNotification(i);
+            return;
+        }
+    }
+}
+
+// The notification on the plc serves all subscriptions of a slot: change wins over cycle, the
+// fastest cycle time and max delay win. It is only added again if the merged settings changed,
+// force adds it after the value has been (re)connected
+void Tc3Manager::applyNotification(Tc3ValueStore::Index i, bool force/*=false*/)
+{
+    const int s = static_cast<int>(i);
+    NotificationType type = NotificationType::None;
+    int cycleTime = 0;
+    int maxDelay = 0;
+    foreach(const Tc3ValueStore::Subscription& subscription, store_.subscriptions[s])
+    {
+        const NotificationType t = static_cast<NotificationType>(subscription.type);
+        if(t == NotificationType::None)
+            continue;
+
+        if(type == NotificationType::None)
+        {
+            type = t;
+            cycleTime = subscription.cycleTime;
+            maxDelay = subscription.maxDelay;
+            continue;
+        }
+
+        type = type == NotificationType::Change || t == NotificationType::Change ? NotificationType::Change : NotificationType::Cycle;
+        cycleTime = std::min(cycleTime, subscription.cycleTime);
+        maxDelay = std::min(maxDelay, subscription.maxDelay);
+    }
+
+    const bool changed = type != static_cast<NotificationType>(store_.notificationTypes[s]) || cycleTime != store_.cycleTimes[s] || maxDelay != store_.maxDelays[s];
+    store_.notificationTypes[s] = static_cast<quint8>(type);
+    store_.cycleTimes[s] = cycleTime;
+    store_.maxDelays[s] = maxDelay;
+
+    if(!store_.types[s])
+        return;
+
+    if(changed || force)
+    {
+        deactivateNotification(i);
+        idle_.remove(i);
+    }
+
+    // without listeners, the notification is added once the first one connects
+    updateNotification(i);
+}
+
+// called by the facade whenever a signal is connected or disconnected, from any thread
+void Tc3Manager::setListened(Tc3ValueStore::Index i, bool listened)
+{
+    QMutexLocker locker(&mutex_);
+    if(!store_.isValid(i) || store_.listened[static_cast<int>(i)] == listened)
+        return;
+
+    store_.listened[static_cast<int>(i)] = listened;
+    updateNotification(i);
+}
+
+bool Tc3Manager::hasListeners(Tc3ValueStore::Index i) const
+{
+    const int s = static_cast<int>(i);
+    return store_.listened[s] || store_.hasCallbacks(i) || (store_.sampled[s] && sampleListeners_.load());
+}
+
+// values that are only consumed through samplesReceived, e.g. by a recorder
+void Tc3Manager::setSampled(Tc3ValueStore::Index i, bool sampled)
+{
+    QMutexLocker locker(&mutex_);
+    if(!store_.isValid(i) || store_.sampled[static_cast<int>(i)] == sampled)
+        return;
+
+    store_.sampled[static_cast<int>(i)] = sampled;
+    updateNotification(i);
+}
+
+// adds the notification of a slot that got a listener, the notification of a slot without
+// listeners is deleted after the grace period
+void Tc3Manager::updateNotification(Tc3ValueStore::Index i)
+{
+    QMutexLocker locker(&mutex_);
+    if(!store_.isValid(i))
+        return;
+
+    const int s = static_cast<int>(i);
+    if(hasListeners(i))
+    {
+        idle_.remove(i);
+        if(!store_.notifications[s] && store_.types[s] && store_.notificationTypes[s] != NotificationType::None)
+            activateNotification(i);
+    }
+    else if(store_.notifications[s] && notificationGrace_ >= 0 && !idle_.contains(i))
+    {
+        idle_.insert(i, clock_.elapsed() + notificationGrace_);
+        QMetaObject::invokeMethod(this, "scheduleIdleNotifications", Qt::QueuedConnection);
+    }
+}
+
+// samples are matched to slots by their notification handle
+void Tc3Manager::activateNotification(Tc3ValueStore::Index i)
+{
+    // evicted values get their handle back first, together with all others that got a listener
+    const int s = static_cast<int>(i);
+    if(!store_.handles[s])
+    {
+        queueRestore(i);
+        return;
+    }
+
+    const htype nh = enableNotify(store_.handles[s], store_.sizes[s], static_cast<NotificationType>(store_.notificationTypes[s]),
+                                  store_.cycleTimes[s], store_.maxDelays[s], onNotification);
+    if(nh)
+    {
+        store_.notifications[s] = nh;
+        notifications_.insert(nh, i);
+    }
+}
+
+void Tc3Manager::deactivateNotification(Tc3ValueStore::Index i)
+{
+    const int s = static_cast<int>(i);
+    if(!store_.notifications[s])
+        return;
+
+    disableNotify(store_.notifications[s]);
+    store_.notifications[s] = 0;
+
+    // the handle is kept for the idle time of the cache from now on
+    QMutexLocker writeLocker(&writeMutex_);
+    store_.accessed[s] = clock_.elapsed();
+}
+
+// runs in the thread of the manager, idleTimer_ runs until the earliest deadline
+void Tc3Manager::scheduleIdleNotifications()
+{
+    if(!idleTimer_.isActive())
+        releaseIdleNotifications();
+}
+
+void Tc3Manager::releaseIdleNotifications()
+{
+    QMutexLocker locker(&mutex_);
+    const qint64 now = clock_.elapsed();
+    qint64 next = -1;
+    for(auto it=idle_.begin(); it!=idle_.end();)
+    {
+        const Tc3ValueStore::Index i = it.key();
+        if(!store_.isValid(i) || hasListeners(i))
+        {
+            it = idle_.erase(it);
+        }
+        else if(it.value() <= now)
+        {
+            deactivateNotification(i);
+            it = idle_.erase(it);
+        }
+        else
+        {
+            next = next < 0 ? it.value() : std::min(next, it.value());
+            ++it;
+        }
+    }
+
+    if(next >= 0)
+        idleTimer_.start(static_cast<int>(next - now));
+}
+
+void Tc3Manager::setNotificationGrace(int grace_ms)
+{
+    QMutexLocker locker(&mutex_);
+    notificationGrace_ = grace_ms;
+}
+
+int Tc3Manager::notificationGrace() const
+{
+    return notificationGrace_;
+}
+
+void Tc3Manager::connectNotify(const QMetaMethod& signal)
+{
+    if(signal == QMetaMethod::fromSignal(&Tc3Manager::samplesReceived))
+        updateSampleListeners();
+}
+
+void Tc3Manager::disconnectNotify(const QMetaMethod& signal)
+{
+    // an invalid signal stands for disconnecting everything
+    if(!signal.isValid() || signal == QMetaMethod::fromSignal(&Tc3Manager::samplesReceived))
+        updateSampleListeners();
+}
+
+// a listener of samplesReceived listens to the values marked with setSampled
+void Tc3Manager::updateSampleListeners()
+{
+    const int listened = isSignalConnected(QMetaMethod::fromSignal(&Tc3Manager::samplesReceived)) ? 1 : 0;
+    if(sampleListeners_.fetchAndStoreOrdered(listened) == listened)
+        return;
+
+    QMutexLocker locker(&mutex_);
+    for(int s=0; s<store_.size(); ++s)
+    {
+        if(store_.references[s] > 0)
+            updateNotification(static_cast<Tc3ValueStore::Index>(s));
+    }
+}
+
+void Tc3Manager::setHandleCache(int capacity, int idle_ms/*=60000*/)
+{
+    QMutexLocker locker(&mutex_);
+    handleCapacity_ = capacity;
+    handleIdle_ = idle_ms;
+
+    if(capacity < 0 && idle_ms < 0)
+    {
+        cacheTimer_.stop();
+        return;
+    }
+
+    // idle handles are looked for a few times per idle time
+    cacheTimer_.start(idle_ms >= 0 ? qBound(1000, idle_ms / 4, 60000) : 10000);
+    scheduleEviction();
+}
+
+int Tc3Manager::handleCacheCapacity() const
+{
+    return handleCapacity_;
+}
+
+int Tc3Manager::handleCacheIdleTime() const
+{
+    return handleIdle_;
+}
+
+// new handles may exceed the capacity, the least recently used ones are evicted once the
+// current event has been processed
+void Tc3Manager::scheduleEviction()
+{
+    if(handleCapacity_ < 0 || evictPending_)
+        return;
+
+    evictPending_ = true;
+    QMetaObject::invokeMethod(this, "evictHandles", Qt::QueuedConnection);
+}
+
+// Releases the handles of idle values and of the least recently used values beyond the capacity.
+// Values with listeners, a notification, high priority or a request in flight are never evicted.
+// Evicted values keep their type and stay connected, only the handle is released in the background
+void Tc3Manager::evictHandles()
+{
+    QMutexLocker locker(&mutex_);
+    evictPending_ = false;
+    if(handleCapacity_ < 0 && handleIdle_ < 0)
+        return;
+
+    const qint64 now = clock_.elapsed();
+    QVector<htype> released;
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+
+        int held = 0;
+        QVector<std::pair<qint64, int> > candidates;
+        for(int s=0; s<store_.size(); ++s)
+        {
+            if(store_.references[s] <= 0 || !store_.handles[s])
+                continue;
+
+            held++;
+            if(store_.notifications[s] || store_.listened[s] || store_.hasCallbacks(static_cast<Tc3ValueStore::Index>(s)) || store_.priorities[s] == High)
+                continue;
+
+            // a request is running with the handle, releasing it now lets the plc hand out its
+            // number again and the request may access another symbol
+            if(!store_.inFlight[s])
+                candidates.append(std::make_pair(store_.accessed[s], s));
+        }
+
+        // least recently used first, the idle ones are at the front
+        std::sort(candidates.begin(), candidates.end());
+        foreach(const auto& c, candidates)
+        {
+            const bool idle = handleIdle_ >= 0 && now - c.first >= handleIdle_;
+            const bool full = handleCapacity_ >= 0 && held > handleCapacity_;
+            if(!idle && !full)
+                break;
+
+            released.append(store_.handles[c.second]);
+            store_.handles[c.second] = 0;
+            held--;
+        }
+    }
+
+    foreach(htype h, released)
+        queueRelease(h, 0);
+}
+
+void Tc3Manager::queueRestore(Tc3ValueStore::Index i)
+{
+    restore_.append(i);
+    if(restorePending_)
+        return;
+
+    restorePending_ = true;
+    QMetaObject::invokeMethod(this, "restoreQueuedHandles", Qt::QueuedConnection);
+}
+
+// e.g. all values of a page that is shown again, with a single sum request
+void Tc3Manager::restoreQueuedHandles()
+{
+    QVector<Tc3ValueStore::Index> queued;
+    {
+        QMutexLocker locker(&mutex_);
+        restorePending_ = false;
+        queued.swap(restore_);
+    }
+    restoreHandles(queued);
+}
+
+// handle of an evicted value for a read or write, queued values are restored along with it
+Tc3Manager::htype Tc3Manager::restoreHandle(Tc3ValueStore::Index i)
+{
+    QVector<Tc3ValueStore::Index> indices;
+    {
+        QMutexLocker locker(&mutex_);
+        indices.swap(restore_);
+    }
+    indices.append(i);
+    restoreHandles(indices);
+
+    QMutexLocker writeLocker(&writeMutex_);
+    return store_.isValid(i) ? store_.handles[static_cast<int>(i)] : 0;
+}
+
+// Acquires the handles of evicted values with sum requests and adds the notifications of those
+// that have listeners by now. Values that are not connected are left to connectValue. Like the
+// resolver, the names are taken under mutex_ and the sum request runs without it, such that
+// dispatching and value() don't wait for the network. Callers must not hold mutex_
+void Tc3Manager::restoreHandles(const QVector<Tc3ValueStore::Index>& indices)
+{
+    QSet<Tc3ValueStore::Index> seen;
+    QVector<Tc3ValueStore::Index> restore;
+    QVector<Tc3SymbolTable::Id> ids;
+    QList<QByteArray> names;
+    {
+        QMutexLocker locker(&mutex_);
+        foreach(Tc3ValueStore::Index i, indices)
+        {
+            const int s = static_cast<int>(i);
+            if(!store_.isValid(i) || !store_.types[s] || store_.handles[s] || seen.contains(i))
+                continue;
+
+            seen.insert(i);
+            restore.append(i);
+            ids.append(store_.symbols[s]);
+            names.append(symbols_.name(store_.symbols[s]).toLatin1());
+        }
+    }
+
+    if(restore.isEmpty())
+        return;
+
+    QVector<htype> handles;
+    if(!sumHandleReq(names, handles))
+        return;
+
+    // slots released or restored by another thread in the meantime don't take the new handle
+    QMutexLocker locker(&mutex_);
+    const qint64 now = clock_.elapsed();
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        for(int k=0; k<restore.size(); ++k)
+        {
+            const int s = static_cast<int>(restore[k]);
+            if(!holds(restore[k], ids[k], names[k]) || !store_.types[s] || store_.handles[s])
+            {
+                queueRelease(handles[k], 0);
+                continue;
+            }
+
+            store_.handles[s] = handles[k];
+            store_.accessed[s] = now;
+        }
+    }
+
+    foreach(Tc3ValueStore::Index i, restore)
+    {
+        const int s = static_cast<int>(i);
+        if(store_.isValid(i) && store_.handles[s] && !store_.notifications[s] && store_.notificationTypes[s] != NotificationType::None && hasListeners(i))
+            activateNotification(i);
+    }
+
+    scheduleEviction();
+}
+
+void Tc3Manager::setPriority(Tc3ValueStore::Index i, Tc3Manager::Priority priority)
+{
+    QMutexLocker locker(&mutex_);
+    QMutexLocker writeLocker(&writeMutex_);
+    if(store_.isValid(i))
+        store_.priorities[static_cast<int>(i)] = static_cast<quint8>(priority);
+}
+
+Tc3Manager::Priority Tc3Manager::priority(Tc3ValueStore::Index i)
+{
+    QMutexLocker writeLocker(&writeMutex_);
+    return store_.isValid(i) ? static_cast<Priority>(store_.priorities[static_cast<int>(i)]) : Normal;
+}
+
+bool Tc3Manager::isValueConnected(Tc3ValueStore::Index i)
+{
+    QMutexLocker locker(&mutex_);
+    return store_.isValid(i) && store_.types[static_cast<int>(i)];
+}
+
+bool Tc3Manager::isValueDirty(Tc3ValueStore::Index i)
+{
+    QMutexLocker writeLocker(&writeMutex_);
+    return store_.isValid(i) && store_.dirty[static_cast<int>(i)];
+}
+
+QString Tc3Manager::valueName(Tc3ValueStore::Index i)
+{
+    QMutexLocker locker(&mutex_);
+    return symbols_.name(store_.symbol(i));
+}
+
+int Tc3Manager::valueSize(Tc3ValueStore::Index i)
+{
+    QMutexLocker locker(&mutex_);
+    return store_.isValid(i) ? store_.sizes[static_cast<int>(i)] : 0;
+}
+
+// Requests run without holding the mutex, the image is read into a buffer on the stack. pending
+// is set if the value has been set in write behind mode and not been written yet
+long Tc3Manager::readValue(Tc3ValueStore::Index i, QVariant& v, bool* pending/*=nullptr*/, bool report/*=true*/)
+{
+    {
+        // the plc still has the old value until the next flush
+        QMutexLocker writeLocker(&writeMutex_);
+        const int s = static_cast<int>(i);
+        if(store_.isValid(i) && store_.dirty[s] && !store_.pendingRaw[s])
+        {
+            v = store_.pending[s];
+            if(pending)
+                *pending = true;
+
+            return 0;
+        }
+    }
+
+    htype h = 0;
+    quint32 group = 0;
+    quint32 offset = 0;
+    int size = 0;
+    const Tc3TypeDescriptor* type = nullptr;
+    Priority priority = Normal;
+    Tc3SymbolTable::Id symbol = Tc3SymbolTable::InvalidId;
+    HandleUse use(this);
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        if(!store_.isValid(i))
+            return NotConnected;
+
+        use.raise(i);
+        h = store_.handles[static_cast<int>(i)];
+        group = store_.groups[static_cast<int>(i)];
+        offset = store_.offsets[static_cast<int>(i)];
+        size = store_.sizes[static_cast<int>(i)];
+        type = store_.types[static_cast<int>(i)];
+        priority = static_cast<Priority>(store_.priorities[static_cast<int>(i)]);
+        symbol = store_.symbols[static_cast<int>(i)];
+        store_.accessed[static_cast<int>(i)] = clock_.elapsed();
+    }
+
+    // not reported, bindings read unresolved values (e.g. placeholders of Deferred) all the time
+    auto fail = [&](long code) { if(report) reportError(code, Read, symbol); return code; };
+    if(!type)
+        return NotConnected;
+
+    // use Tc3Value::get<T> for user types
+    if(!type->decode)
+        return fail(UserTypeAccess);
+
+    // the handle may have been evicted from the cache, restoreHandle reports why it failed. High
+    // priority values are read by address and need no handle
+    if(!h && priority != High)
+        h = restoreHandle(i);
+
+    if(!h && priority != High)
+        return NotConnected;
+
+    QVarLengthArray<char, 256> image(size);
+    const long errorId = priority == High ? highReadReq(group, offset, image.data(), size)
+                                          : syncReadReq(h, image.data(), size, priority);
+    if(errorId)
+        return fail(errorId);
+
+    if(!type->decode(*type, image.constData(), size, v))
+        return fail(ConversionFailed);
+
+    return 0;
+}
+
+// written is what actually has been written, such that notifications compare correctly
+long Tc3Manager::writeValue(Tc3ValueStore::Index i, const QVariant& v, QVariant* written/*=nullptr*/, bool report/*=true*/)
+{
+    // values with high priority are always written immediately
+    if(writeMode_ == WriteBehind && priority(i) != High)
+    {
+        markDirty(i, v);
+        return 0;
+    }
+
+    htype h = 0;
+    quint32 group = 0;
+    quint32 offset = 0;
+    int size = 0;
+    const Tc3TypeDescriptor* type = nullptr;
+    Priority priority = Normal;
+    Tc3SymbolTable::Id symbol = Tc3SymbolTable::InvalidId;
+    HandleUse use(this);
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        if(!store_.isValid(i))
+            return NotConnected;
+
+        use.raise(i);
+        h = store_.handles[static_cast<int>(i)];
+        group = store_.groups[static_cast<int>(i)];
+        offset = store_.offsets[static_cast<int>(i)];
+        size = store_.sizes[static_cast<int>(i)];
+        type = store_.types[static_cast<int>(i)];
+        priority = static_cast<Priority>(store_.priorities[static_cast<int>(i)]);
+        symbol = store_.symbols[static_cast<int>(i)];
+        store_.accessed[static_cast<int>(i)] = clock_.elapsed();
+    }
+
+    auto fail = [&](long code) { if(report) reportError(code, Write, symbol); return code; };
+    if(!type)
+        return fail(NotConnected);
+
+    // use Tc3Value::set<T> for user types
+    if(!type->encode)
+        return fail(UserTypeAccess);
+
+    if(!h && priority != High)
+        h = restoreHandle(i);
+
+    if(!h && priority != High)
+        return NotConnected;
+
+    QVarLengthArray<char, 256> image(size);
+    if(!type->encode(*type, v, image.data(), size))
+        return fail(ConversionFailed);
+
+    const long errorId = priority == High ? highWriteReq(group, offset, image.constData(), size)
+                                          : syncWriteReq(h, image.constData(), size, priority);
+    if(errorId)
+        return fail(errorId);
+
+    if(written && type->decode)
+        type->decode(*type, image.constData(), size, *written);
+
+    return 0;
+}
+
+long Tc3Manager::readRaw(Tc3ValueStore::Index i, void* data, int size, bool report/*=true*/)
+{
+    htype h = 0;
+    quint32 group = 0;
+    quint32 offset = 0;
+    int actual = 0;
+    bool connected = false;
+    Priority priority = Normal;
+    Tc3SymbolTable::Id symbol = Tc3SymbolTable::InvalidId;
+    HandleUse use(this);
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        if(!store_.isValid(i))
+            return NotConnected;
+
+        use.raise(i);
+        h = store_.handles[static_cast<int>(i)];
+        group = store_.groups[static_cast<int>(i)];
+        offset = store_.offsets[static_cast<int>(i)];
+        actual = store_.sizes[static_cast<int>(i)];
+        connected = store_.types[static_cast<int>(i)] != nullptr;
+        priority = static_cast<Priority>(store_.priorities[static_cast<int>(i)]);
+        symbol = store_.symbols[static_cast<int>(i)];
+        store_.accessed[static_cast<int>(i)] = clock_.elapsed();
+    }
+
+    auto fail = [&](long code) { if(report) reportError(code, Read, symbol); return code; };
+    if(!connected)
+        return fail(NotConnected);
+
+    // the template argument doesn't match the symbol
+    if(size != actual)
+        return fail(SizeMismatch);
+
+    if(!h && priority != High)
+        h = restoreHandle(i);
+
+    if(!h && priority != High)
+        return NotConnected;
+
+    const long errorId = priority == High ? highReadReq(group, offset, data, size)
+                                          : syncReadReq(h, data, size, priority);
+    if(errorId)
+        return fail(errorId);
+
+    return 0;
+}
+
+long Tc3Manager::writeRaw(Tc3ValueStore::Index i, const void* data, int size, bool report/*=true*/)
+{
+    // the size is checked when the value is actually written
+    if(writeMode_ == WriteBehind && priority(i) != High)
+    {
+        markDirty(i, QByteArray(static_cast<const char*>(data), size), true);
+        return 0;
+    }
+
+    htype h = 0;
+    quint32 group = 0;
+    quint32 offset = 0;
+    int actual = 0;
+    bool connected = false;
+    Priority priority = Normal;
+    Tc3SymbolTable::Id symbol = Tc3SymbolTable::InvalidId;
+    HandleUse use(this);
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        if(!store_.isValid(i))
+            return NotConnected;
+
+        use.raise(i);
+        h = store_.handles[static_cast<int>(i)];
+        group = store_.groups[static_cast<int>(i)];
+        offset = store_.offsets[static_cast<int>(i)];
+        actual = store_.sizes[static_cast<int>(i)];
+        connected = store_.types[static_cast<int>(i)] != nullptr;
+        priority = static_cast<Priority>(store_.priorities[static_cast<int>(i)]);
+        symbol = store_.symbols[static_cast<int>(i)];
+        store_.accessed[static_cast<int>(i)] = clock_.elapsed();
+    }
+
+    auto fail = [&](long code) { if(report) reportError(code, Write, symbol); return code; };
+    if(!connected)
+        return fail(NotConnected);
+
+    if(size != actual)
+        return fail(SizeMismatch);
+
+    if(!h && priority != High)
+        h = restoreHandle(i);
+
+    if(!h && priority != High)
+        return NotConnected;
+
+    const long errorId = priority == High ? highWriteReq(group, offset, data, size)
+                                          : syncWriteReq(h, data, size, priority);
+    if(errorId)
+        return fail(errorId);
+
+    return 0;
+}
+
+bool Tc3Manager::decodeValue(Tc3ValueStore::Index i, const char* data, int size, QVariant& v)
+{
+    QMutexLocker locker(&mutex_);
+    if(!store_.isValid(i))
+        return false;
+
+    const int s = static_cast<int>(i);
+    const Tc3TypeDescriptor* type = store_.types[s];
+    if(!type || !type->decode || size < store_.sizes[s])
+        return false;
+
+    return type->decode(*type, data, store_.sizes[s], v);
+}
+
+// Large symbols are transferred by index group and offset in chunks, parallel workers take the
+// next chunk until all are done and copy straight from or into data. The calling thread only
+// waits for chunks and reports the progress. Chunks go over ports of their own or the transfer
+// client, they bypass the lanes and are not counted in laneStatistics
+bool Tc3Manager::transferChunked(Tc3ValueStore::Index i, char* data, qint64 size, bool write, const Progress& progress, int chunkSize, int parallel)
+{
+    quint32 group = 0;
+    quint32 offset = 0;
+    qint64 actual = 0;
+    bool connected = false;
+    Tc3SymbolTable::Id id = Tc3SymbolTable::InvalidId;
+    {
+        QMutexLocker locker(&mutex_);
+        if(!store_.isValid(i))
+            return false;
+
+        const int s = static_cast<int>(i);
+        id = store_.symbols[s];
+        const Tc3SymbolTable::Symbol& symbol = symbols_.symbol(id);
+        group = symbol.group;
+        offset = symbol.offset;
+        actual = store_.sizes[s];
+        connected = store_.types[s] != nullptr;
+    }
+
+    if(!connected)
+    {
+        reportError(NotConnected, write ? Write : Read, id);
+        return false;
+    }
+
+    if(!data || size != actual)
+    {
+        reportError(SizeMismatch, write ? Write : Read, id);
+        return false;
+    }
+
+    if(chunkSize <= 0)
+        chunkSize = defaultChunkSize;
+
+    const int chunks = static_cast<int>((size + chunkSize - 1) / chunkSize);
+    parallel = std::max(1, std::min(parallel, chunks));
+
+    Tc3AmsClient* client = transferClient_;
+    if(client && client->isOpen())
+    {
+        qint64 transferred = 0;
+        const long errorId = transferPipelined(client, group, offset, data, size, write, progress, chunkSize, parallel, transferred);
+        if(errorId)
+        {
+            reportError(errorId, write ? Write : Read, id);
+            checkSymbolVersion(errorId);
+            return false;
+        }
+
+        return transferred == size;
+    }
+
+    // every worker sends on an ads port of its own, the port of the manager only takes one request
+    // at a time (see Lane). Chunks are addressed by index group and offset, which are the same on
+    // every port, unlike handles
+    QVector<long> ports;
+    for(int k=0; k<parallel; ++k)
+    {
+        const long port = transport_->portOpen();
+        if(!port)
+            break;
+
+        ports.append(port);
+    }
+
+    if(ports.isEmpty())
+    {
+        reportError(NotConnected, write ? Write : Read, id);
+        return false;
+    }
+
+    QAtomicInt next(0);
+    QAtomicInt cancelled(0);
+    QAtomicInt failure(0);
+    QAtomicInteger<qint64> done(0);
+    QSemaphore completed;
+
+    // every chunk that is started is released as completed, also if it failed
+    auto work = [&](long port)
+    {
+        while(!cancelled.load())
+        {
+            const int c = next.fetchAndAddOrdered(1);
+            if(c >= chunks)
+                break;
+
+            const qint64 at = static_cast<qint64>(c) * chunkSize;
+            const utype n = static_cast<utype>(std::min<qint64>(chunkSize, size - at));
+            const utype chunkOffset = static_cast<utype>(offset + at);
+            const long errorId = write ? transport_->write(port, &adsadr_, group, chunkOffset, n, data + at)
+                                       : transport_->read(port, &adsadr_, group, chunkOffset, n, data + at, nullptr);
+
+            if(errorId)
+            {
+                failure.testAndSetOrdered(0, static_cast<int>(errorId));
+                cancelled.store(1);
+            }
+            else
+            {
+                done.fetchAndAddOrdered(n);
+            }
+
+            completed.release();
+        }
+    };
+
+    QList<Worker*> workers;
+    foreach(long port, ports)
+    {
+        workers.append(new Worker([&work, port]() { work(port); }));
+        workers.last()->start();
+    }
+
+    for(int finished=0; finished<chunks && !cancelled.load(); ++finished)
+    {
+        completed.acquire();
+        if(progress && !cancelled.load() && !progress(done.load(), size))
+            cancelled.store(1);
+    }
+
+    // running chunks are finished, no new ones are started after cancelling
+    cancelled.store(1);
+    foreach(Worker* w, workers)
+        w->wait();
+    qDeleteAll(workers);
+
+    foreach(long port, ports)
+        transport_->portClose(port);
+
+    if(failure.load())
+    {
+        reportError(failure.load(), write ? Write : Read, id);
+        checkSymbolVersion(failure.load());
+        return false;
+    }
+
+    return done.load() == size;
+}
+
+// Chunks on the connection of client, with up to parallel requests in flight. The callbacks run in
+// the thread of the client, everything else in the calling thread, which processes events while
+// waiting if it is the thread of the client. Every request is waited for, also after cancelling,
+// responses are written into data
+long Tc3Manager::transferPipelined(Tc3AmsClient* client, quint32 group, quint32 offset, char* data, qint64 size, bool write, const Progress& progress, int chunkSize, int parallel, qint64& done)
+{
+    const int chunks = static_cast<int>((size + chunkSize - 1) / chunkSize);
+    const bool sameThread = client->thread() == QThread::currentThread();
+
+    QMutex mutex;
+    QSemaphore completed;
+    long failure = 0;
+    done = 0;
+
+    auto issue = [&](int c)
+    {
+        const qint64 at = static_cast<qint64>(c) * chunkSize;
+        const int n = static_cast<int>(std::min<qint64>(chunkSize, size - at));
+        const utype chunkOffset = static_cast<utype>(offset + at);
+
+        auto callback = [&, at, n](long errorId, const QByteArray& response)
+        {
+            QMutexLocker locker(&mutex);
+            if(!errorId && !write && response.size() != n)
+                errorId = SizeMismatch;
+
+            if(errorId)
+            {
+                if(!failure)
+                    failure = errorId;
+            }
+            else
+            {
+                if(!write)
+                    memcpy(data + at, response.constData(), static_cast<size_t>(n));
+
+                done += n;
+            }
+
+            completed.release();
+        };
+
+        if(write)
+            client->write(group, chunkOffset, QByteArray(data + at, n), callback);
+        else
+            client->read(group, chunkOffset, static_cast<utype>(n), callback);
+    };
+
+    int issued = 0;
+    for(; issued<parallel; ++issued)
+        issue(issued);
+
+    bool cancelled = false;
+    for(int finished=0; finished<issued; ++finished)
+    {
+        if(sameThread)
+        {
+            while(!completed.tryAcquire())
+                QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+        else
+        {
+            completed.acquire();
+        }
+
+        qint64 transferred = 0;
+        {
+            QMutexLocker locker(&mutex);
+            cancelled = cancelled || failure;
+            transferred = done;
+        }
+
+        if(!cancelled && progress && !progress(transferred, size))
+            cancelled = true;
+
+        if(!cancelled && issued < chunks)
+            issue(issued++);
+    }
+
+    QMutexLocker locker(&mutex);
+    return failure;
+}
+
+// address of a connected slot for requests outside of the ads port, 0 or a ClientError
+long Tc3Manager::asyncTarget(Tc3ValueStore::Index i, quint32& group, quint32& offset, int& size, Tc3AmsClient*& client)
+{
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        if(!store_.isValid(i) || !store_.types[static_cast<int>(i)])
+            return NotConnected;
+
+        const int s = static_cast<int>(i);
+        group = store_.groups[s];
+        offset = store_.offsets[s];
+        size = store_.sizes[s];
+        store_.accessed[s] = clock_.elapsed();
+    }
+
+    client = transferClient_;
+    if(!client || !client->isOpen())
+        return NotConnected;
+
+    return 0;
+}
+
+// Reads by index group and offset on the connection of the transfer client, any number of them
+// can be in flight. The callback runs in the thread of the client, errors are left to it
+long Tc3Manager::readAsync(Tc3ValueStore::Index i, const AsyncCallback& callback)
+{
+    quint32 group = 0;
+    quint32 offset = 0;
+    int size = 0;
+    Tc3AmsClient* client = nullptr;
+    const long errorId = asyncTarget(i, group, offset, size, client);
+    if(errorId)
+        return errorId;
+
+    client->read(group, offset, static_cast<utype>(size), callback);
+    return 0;
+}
+
+long Tc3Manager::writeAsync(Tc3ValueStore::Index i, const QByteArray& data, const AsyncCallback& callback)
+{
+    quint32 group = 0;
+    quint32 offset = 0;
+    int size = 0;
+    Tc3AmsClient* client = nullptr;
+    const long errorId = asyncTarget(i, group, offset, size, client);
+    if(errorId)
+        return errorId;
+
+    if(data.size() != size)
+        return SizeMismatch;
+
+    client->write(group, offset, data, callback);
+    return 0;
+}
+
+// called in the notification thread of ADS, the samples are dispatched in the thread of the manager
+void Tc3Manager::queueSample(htype nh, quint64 timestamp, const char* data, int size)
+{
+    QMutexLocker sampleLocker(&sampleMutex_);
+    queued_.append(timestamp, data, size);
+    queuedHandles_.append(nh);
+    queuedArrivals_.append(hostTime());
+
+    if(!dispatchPending_)
+    {
+        dispatchPending_ = true;
+        QMetaObject::invokeMethod(this, "dispatchSamples", Qt::QueuedConnection);
+    }
+}
+
+void Tc3Manager::dispatchSamples()
+{
+    Tc3SampleBatch batch;
+    QVector<htype> handles;
+    QVector<qint64> arrivals;
+    {
+        QMutexLocker sampleLocker(&sampleMutex_);
+        batch = queued_;
+        handles = queuedHandles_;
+        arrivals = queuedArrivals_;
+        queued_.clear();
+        queuedHandles_.clear();
+        queuedArrivals_.clear();
+        dispatchPending_ = false;
+    }
+
+    QMutexLocker locker(&mutex_);
+
+    // samples of values that have been removed in the meantime are dropped
+    QVector<Tc3Sample>& samples = batch.samples_;
+    int n = 0;
+    for(int i=0; i<samples.size(); ++i)
+    {
+        const Tc3ValueStore::Index v = notifications_.value(handles[i], Tc3ValueStore::InvalidIndex);
+        if(!store_.isValid(v))
+            continue;
+
+        const int s = static_cast<int>(v);
+        if(!store_.types[s] || samples[i].size < store_.sizes[s])
+            continue;
+
+        samples[i].index = v;
+        samples[i].type = store_.types[s];
+        samples[i].size = store_.sizes[s];
+        arrivals[n] = arrivals[i];
+        samples[n++] = samples[i];
+    }
+    samples.resize(n);
+
+    if(batch.isEmpty())
+        return;
+
+    // the latency of a sample is taken when its delivery starts
+    if(latencyTracking_.load())
+    {
+        for(int i=0; i<samples.size(); ++i)
+            arrivalWindow_[0] = std::min(arrivalWindow_[0], arrivals[i] - static_cast<qint64>(samples[i].timestamp));
+
+        updateClockOffset();
+
+        const qint64 now = hostTime();
+        for(int i=0; i<samples.size(); ++i)
+            recordDelivery(samples[i].index, samples[i].timestamp, arrivals[i], now);
+    }
+
+    // callbacks of handles get every sample. A callback may release slots or subscribe, so
+    // everything is looked up again for each sample
+    for(int i=0; i<samples.size(); ++i)
+    {
+        const Tc3ValueStore::Index v = samples[i].index;
+        if(!store_.isValid(v))
+            continue;
+
+        const QVector<Tc3ValueStore::Subscription> subscriptions = store_.subscriptions[static_cast<int>(v)];
+        foreach(const Tc3ValueStore::Subscription& subscription, subscriptions)
+        {
+            if(subscription.callback)
+                subscription.callback(batch.data(samples[i]), samples[i].size, samples[i].timestamp);
+        }
+    }
+
+    // values only report their latest sample, the history is in the batch
+    QHash<Tc3ValueStore::Index, int> latest;
+    for(int i=0; i<samples.size(); ++i)
+    {
+        if(store_.isValid(samples[i].index) && store_.facades[static_cast<int>(samples[i].index)])
+            latest.insert(samples[i].index, i);
+    }
+
+    for(int i=0; i<samples.size(); ++i)
+    {
+        const Tc3ValueStore::Index v = samples[i].index;
+        if(latest.value(v, -1) != i || !store_.isValid(v))
+            continue;
+
+        Tc3Value* f = store_.facades[static_cast<int>(v)];
+        if(f)
+            f->update(batch.data(samples[i]), samples[i].size);
+    }
+
+    locker.unlock();
+    emit samplesReceived(batch);
+}
+
+void Tc3Manager::setLatencyTracking(bool enabled, int budget_ms/*=0*/)
+{
+    QMutexLocker locker(&mutex_);
+    latencyTracking_.store(enabled ? 1 : 0);
+    latencyBudget_ = static_cast<qint64>(std::max(budget_ms, 0)) * 10000;
+
+    if(!enabled)
+    {
+        probeTimer_.stop();
+        return;
+    }
+
+    probeTimer_.start(probeInterval_ms);
+    QMetaObject::invokeMethod(this, "probeRoundTrip", Qt::QueuedConnection);
+}
+
+bool Tc3Manager::latencyTracking() const
+{
+    return latencyTracking_.load() != 0;
+}
+
+// latencies of all values
+Tc3LatencyHistogram Tc3Manager::latency(Tc3Manager::LatencyStage stage)
+{
+    QMutexLocker locker(&mutex_);
+    return latencyTotals_[stage];
+}
+
+Tc3LatencyHistogram Tc3Manager::latency(Tc3ValueStore::Index i, Tc3Manager::LatencyStage stage)
+{
+    QMutexLocker locker(&mutex_);
+    auto it = latency_.constFind(i);
+    return it != latency_.constEnd() ? it->stages[stage] : Tc3LatencyHistogram();
+}
+
+void Tc3Manager::resetLatency()
+{
+    QMutexLocker locker(&mutex_);
+    latency_.clear();
+    for(Tc3LatencyHistogram& h : latencyTotals_)
+        h.reset();
+}
+
+qint64 Tc3Manager::clockOffset()
+{
+    QMutexLocker locker(&mutex_);
+    return clockOffset_ / 10;
+}
+
+qint64 Tc3Manager::hostTime() const
+{
+    return clockEpoch_ + clock_.nsecsElapsed() / 100;
+}
+
+// The fastest sample took at least half of the shortest round trip, everything above is the
+// offset of the clocks. Windows are restarted such that the estimate follows drifting clocks
+void Tc3Manager::updateClockOffset()
+{
+    const qint64 arrival = std::min(arrivalWindow_[0], arrivalWindow_[1]);
+    const qint64 roundTrip = std::min(roundTripWindow_[0], roundTripWindow_[1]);
+    if(arrival != noSample)
+        clockOffset_ = arrival - (roundTrip != noSample ? roundTrip / 2 : 0);
+
+    const qint64 now = hostTime();
+    if(now - windowStart_ > offsetWindow)
+    {
+        arrivalWindow_[1] = arrivalWindow_[0];
+        arrivalWindow_[0] = noSample;
+        roundTripWindow_[1] = roundTripWindow_[0];
+        roundTripWindow_[0] = noSample;
+        windowStart_ = now;
+    }
+}
+
+// a small request on the high priority lane, timed once the lane has been acquired such that
+// the round trip doesn't include waiting for the running request
+void Tc3Manager::probeRoundTrip()
+{
+    if(!latencyTracking_.load() || !isConnected())
+        return;
+
+    unsigned short adsState = 0;
+    unsigned short deviceState = 0;
+    qint64 roundTrip = 0;
+    long errorId = 0;
+    {
+        LaneLocker lane(this, High);
+        const qint64 sent = hostTime();
+        errorId = transport_->readState(lane.port(), &adsadr_, &adsState, &deviceState);
+        roundTrip = hostTime() - sent;
+    }
+    if(errorId)
+        return;
+
+    QMutexLocker locker(&mutex_);
+    roundTripWindow_[0] = std::min(roundTripWindow_[0], roundTrip);
+    updateClockOffset();
+}
+
+void Tc3Manager::recordDelivery(Tc3ValueStore::Index i, quint64 timestamp, qint64 arrival, qint64 now)
+{
+    LatencyRecord& r = latency_[i];
+    const qint64 plc = static_cast<qint64>(timestamp) + clockOffset_;
+    r.timestamp = timestamp;
+    r.delivered = now;
+    r.transport = arrival - plc;
+    r.dispatch = now - arrival;
+
+    r.stages[Transport].record(r.transport / 10);
+    r.stages[Dispatch].record(r.dispatch / 10);
+    latencyTotals_[Transport].record(r.transport / 10);
+    latencyTotals_[Dispatch].record(r.dispatch / 10);
+
+    // values that are acknowledged are measured up to the acknowledge
+    if(r.acknowledged)
+        return;
+
+    r.stages[EndToEnd].record((now - plc) / 10);
+    latencyTotals_[EndToEnd].record((now - plc) / 10);
+    checkLatencyBudget(i, r.transport, r.dispatch, -1, now - plc);
+}
+
+// the consumer is done with the latest sample, e.g. it has been rendered
+void Tc3Manager::acknowledge(Tc3ValueStore::Index i)
+{
+    QMutexLocker locker(&mutex_);
+    auto it = latency_.find(i);
+    if(!latencyTracking_.load() || it == latency_.end() || !it->delivered)
+        return;
+
+    const qint64 now = hostTime();
+    const qint64 consumer = now - it->delivered;
+    const qint64 total = now - (static_cast<qint64>(it->timestamp) + clockOffset_);
+    it->acknowledged = true;
+    it->delivered = 0;
+
+    it->stages[Consumer].record(consumer / 10);
+    it->stages[EndToEnd].record(total / 10);
+    latencyTotals_[Consumer].record(consumer / 10);
+    latencyTotals_[EndToEnd].record(total / 10);
+    checkLatencyBudget(i, it->transport, it->dispatch, consumer, total);
+}
+
+void Tc3Manager::checkLatencyBudget(Tc3ValueStore::Index i, qint64 transport, qint64 dispatch, qint64 consumer, qint64 total)
+{
+    if(latencyBudget_ <= 0 || total <= latencyBudget_ || !store_.isValid(i))
+        return;
+
+    LatencyRecord& r = latency_[i];
+    const qint64 now = hostTime();
+    if(r.reported && now - r.reported < latencyEventInterval)
+        return;
+
+    r.reported = now;
+
+    LatencyEvent e;
+    e.symbol = symbols_.name(store_.symbols[static_cast<int>(i)]);
+    e.transport_us = transport / 10;
+    e.dispatch_us = dispatch / 10;
+    e.consumer_us = consumer < 0 ? -1 : consumer / 10;
+    e.total_us = total / 10;
+    emit latencyExceeded(e);
+}
+
+void Tc3Manager::removeGroup(Tc3ValueGroup *group)
+{
+    QMutexLocker locker(&mutex_);
+    groups_.removeAll(group);
+}
+
+// the symbol tables are uploaded on first use and again after reconnecting or online changes
+Tc3SymbolBrowser *Tc3Manager::symbolBrowser()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        if(!isConnected())
+            return nullptr;
+
+        if(browserValid_)
+            return &browser_;
+    }
+
+    // uploads without mutex_, the tables are swapped in under it
+    const bool ok = browser_.refresh();
+
+    QMutexLocker locker(&mutex_);
+    if(ok)
+        browserValid_ = true;
+
+    return browserValid_ ? &browser_ : nullptr;
+}
+
+void Tc3Manager::setWriteMode(WriteMode mode, int flushInterval_ms/*=50*/)
+{
+    stopFlusher();
+    writeMode_ = mode;
+
+    // switching back to write through, whatever is still pending is written now
+    if(mode == WriteThrough)
+    {
+        flushWrites();
+        return;
+    }
+
+    // the timer lives in the flush thread, such that requests don't block the thread of the manager
+    flushThread_ = new QThread(this);
+    QTimer* timer = new QTimer();
+    timer->setInterval(flushInterval_ms);
+    timer->moveToThread(flushThread_);
+
+    QObject::connect(timer, &QTimer::timeout, timer, [this](){ flushWrites(); });
+    QObject::connect(flushThread_, &QThread::started, timer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    QObject::connect(flushThread_, &QThread::finished, timer, &QObject::deleteLater);
+    flushThread_->start();
+}
+
+Tc3Manager::WriteMode Tc3Manager::writeMode() const
+{
+    return writeMode_;
+}
+
+void Tc3Manager::stopFlusher()
+{
+    if(!flushThread_)
+        return;
+
+    flushThread_->quit();
+    flushThread_->wait();
+    delete flushThread_;
+    flushThread_ = nullptr;
+}
+
+// only takes writeMutex_, slots are allocated and released while holding it as well
+void Tc3Manager::markDirty(Tc3ValueStore::Index i, const QVariant& pending, bool raw/*=false*/)
+{
+    QMutexLocker writeLocker(&writeMutex_);
+    if(!store_.isValid(i))
+        return;
+
+    const int s = static_cast<int>(i);
+    store_.pending[s] = pending;
+    store_.pendingRaw[s] = raw;
+
+    if(!store_.dirty[s])
+    {
+        store_.dirty[s] = true;
+        dirty_.append(i);
+    }
+}
+
+void Tc3Manager::flushWrites()
+{
+    QMutexLocker locker(&mutex_);
+    if(!isConnected())
+        return;
+
+    struct Pending
+    {
+        Tc3ValueStore::Index index;
+        Tc3SymbolTable::Id symbol;
+        QVariant data;
+        bool raw;
+    };
+
+    // evicted handles of the dirty values are acquired in one go
+    QVector<Tc3ValueStore::Index> evicted;
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        foreach(Tc3ValueStore::Index i, dirty_)
+        {
+            if(store_.types[static_cast<int>(i)] && !store_.handles[static_cast<int>(i)])
+                evicted.append(i);
+        }
+    }
+    locker.unlock();
+    restoreHandles(evicted);
+    locker.relock();
+
+    // take the latest value of every connected dirty value, values that are not connected
+    // stay dirty until they are connected again
+    const qint64 now = clock_.elapsed();
+    QVector<Pending> pending;
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        for(auto it=dirty_.begin(); it!=dirty_.end();)
+        {
+            const int s = static_cast<int>(*it);
+            if(!store_.types[s] || !store_.handles[s])
+            {
+                ++it;
+                continue;
+            }
+
+            store_.accessed[s] = now;
+            store_.inFlight[s]++;
+            pending.append({ *it, store_.symbols[s], store_.pending[s], store_.pendingRaw[s] });
+            store_.pending[s] = QVariant();
+            store_.dirty[s] = false;
+            it = dirty_.erase(it);
+        }
+    }
+
+    if(pending.isEmpty())
+        return;
+
+    QVector<Tc3Ads::SumRequest> requests;
+    QVector<Pending> written;
+    QByteArray data;
+    requests.reserve(pending.size());
+    written.reserve(pending.size());
+
+    foreach(const Pending& p, pending)
+    {
+        const int s = static_cast<int>(p.index);
+        const Tc3TypeDescriptor* type = store_.types[s];
+        const int size = store_.sizes[s];
+        const int at = data.size();
+        data.resize(at + size);
+
+        bool ok = false;
+        if(p.raw)
+        {
+            const QByteArray raw = p.data.toByteArray();
+            ok = raw.size() == size;
+            if(ok)
+                memcpy(data.data() + at, raw.constData(), static_cast<size_t>(size));
+        }
+        else if(type->encode)
+        {
+            ok = type->encode(*type, p.data, data.data() + at, size);
+        }
+
+        if(!ok)
+        {
+            data.resize(at);
+            reportError(ConversionFailed, Write, p.symbol);
+            continue;
+        }
+
+        requests.append({ ADSIGRP_SYM_VALBYHND, static_cast<quint32>(store_.handles[s]), static_cast<quint32>(size) });
+        written.append(p);
+    }
+
+    // values can be read and set while the request is running
+    locker.unlock();
+    QVector<quint32> results;
+    const bool ok = sumWriteReq(requests, data, results, Normal);
+    locker.relock();
+
+    // the handles can be evicted again
+    {
+        QMutexLocker writeLocker(&writeMutex_);
+        foreach(const Pending& p, pending)
+        {
+            const int s = static_cast<int>(p.index);
+            if(store_.isValid(p.index) && store_.symbols[s] == p.symbol && store_.inFlight[s] > 0)
+                store_.inFlight[s]--;
+        }
+    }
+
+    if(!ok)
+    {
+        // keep the values pending for the next try, unless they have been set again or released
+        // in the meantime
+        QMutexLocker writeLocker(&writeMutex_);
+        foreach(const Pending& p, written)
+        {
+            const int s = static_cast<int>(p.index);
+            if(store_.isValid(p.index) && store_.symbols[s] == p.symbol && !store_.dirty[s])
+            {
+                store_.pending[s] = p.data;
+                store_.pendingRaw[s] = p.raw;
+                store_.dirty[s] = true;
+                dirty_.append(p.index);
+            }
+        }
+        return;
+    }
+
+    for(int i=0; i<results.size(); ++i)
+    {
+        if(results[i])
+            reportError(static_cast<long>(results[i]), Write, written[i].symbol);
+    }
+}
+
+bool Tc3Manager::isConnected() const
+{
+    return mhandle_.loadAcquire() > 0;
+}
+
+long Tc3Manager::port() const
+{
+    return adsport_.loadAcquire();
+}
+
+void Tc3Manager::setStringEncoding(Tc3StringCodec::Encoding encoding)
+{
+    QMutexLocker locker(&mutex_);
+    stringEncoding_ = encoding;
+    types_.setStringEncoding(encoding);
+}
+
+Tc3StringCodec::Encoding Tc3Manager::stringEncoding() const
+{
+    return stringEncoding_;
+}
+
+void Tc3Manager::onConnectionChanged(bool connected)
+{
+    QMutexLocker locker(&mutex_);
+
+    // AdsRouter is disconnected, but Tc3Manager is not aware of it right now
+    if(isConnected() && !connected)
+    {
+        mhandleMem_ = mhandle_.fetchAndStoreOrdered(0);
+        emit error("AdsRouter disconnected!");
+
+        // Set all values to invalid
+        for(int i=0; i<store_.size(); ++i)
+        {
+            if(store_.references[i] <= 0)
+                continue;
+
+            {
+                QMutexLocker writeLocker(&writeMutex_);
+                store_.types[i] = nullptr;
+            }
+
+            if(store_.facades[i])
+                emit store_.facades[i]->changed(QVariant());
+        }
+    }
+
+    // symbols may have changed while we were not connected
+    if(connected && isConnected())
+        onSymbolsChanged();
+
+    if(connected && isConnected() && reconnectTimer_ >= 0)
+    {
+        killTimer(reconnectTimer_);
+        reconnectTimer_ = -1;
+    }
+
+    // start a timer to reconnect to twincat in case we lose the connection - reconnecting will set all values to "not connected state"
+    if(!connected && reconnectTimer_ < 0)
+        reconnectTimer_ = startTimer(5000);
+}
+
+void Tc3Manager::onSymbolsChanged()
+{
+    QMutexLocker locker(&mutex_);
+    browserValid_ = false;
+    layouts_.clear();
+
+    // aliases and enumerations may have changed, values that are bound again resolve their types anew
+    types_.clear();
+
+    // only after a new symbol version, after reconnecting all values have been connected again
+    if(rebindPending_.fetchAndStoreOrdered(0))
+        rebindValues();
+
+    QList<Tc3ValueGroup*> groups = groups_;
+    foreach(Tc3ValueGroup* g, groups)
+        g->refresh();
+}
+
+void Tc3Manager::timerEvent(QTimerEvent * event)
+{
+    QMutexLocker locker(&mutex_);
+    Q_UNUSED(event)
+
+    // try to reconnect
+    if(!isConnected())
+    {
+        if(connectMode_ == Deferred)
+            queueConnect();
+        else
+            connect();
+    }
+}
+
+unsigned short Tc3Manager::adsState(long port)
+{
+    unsigned short adsState=0;
+    unsigned short deviceState;
+    long errorId = transport_->readState(port, &adsadr_, &adsState, &deviceState);
+    if(errorId)
+    {
+        reportError(errorId, Connect);
+    }
+
+    return adsState;
+}
+
+/*static*/
 QString Tc3Manager::tc3AdsError(long errorId)
 {
     switch(errorId)
@@ -532,6 +3735,10 @@ QString Tc3Manager::tc3AdsError(long errorId)
     case ADSERR_CLIENT_NOMORESYM			: return QString("no more symbols in cache");
     case ADSERR_CLIENT_SYNCRESINVALID		: return QString("invalid response received");
     case ADSERR_CLIENT_SYNCPORTLOCKED		: return QString("sync port is locked");
+    case NotConnected                       : return QString("not connected");
+    case SizeMismatch                       : return QString("size not matching the symbol");
+    case ConversionFailed                   : return QString("can not convert the value");
+    case UserTypeAccess                     : return QString("use get<T> and set<T> for user types");
     }
 
     return QString();
@@ -546,7 +3753,7 @@ void Tc3Manager::onConnectionChanged(AmsAddr* addr, AdsNotificationHeader* heade
 {
     Q_UNUSED(addr)
 #ifdef __linux__
-    const char data = *(reinterpret_cast<char*>(const_cast<AdsNotificationHeader*>(header)) + sizeof(header));
+    const unsigned short data = *reinterpret_cast<const unsigned short*>(header + 1);
 #elif _WIN32
     unsigned char data = header->data[0];
 #else
@@ -570,13 +3777,116 @@ void Tc3Manager::onConnectionChanged(AmsAddr* addr, AdsNotificationHeader* heade
     }
 }
 
+/*static*/
+#ifdef __linux__
+void Tc3Manager::onSymbolVersionChanged(const AmsAddr* addr, const AdsNotificationHeader* header, Tc3Manager::utype userdata)
+#elif _WIN32
+void Tc3Manager::onSymbolVersionChanged(AmsAddr* addr, AdsNotificationHeader* header, Tc3Manager::utype userdata)
+#endif
+{
+    Q_UNUSED(addr)
+#ifdef __linux__
+    const int version = *reinterpret_cast<const unsigned char*>(header + 1);
+#elif _WIN32
+    const int version = header->data[0];
+#endif
+
+    Tc3Manager *self = nullptr;
+    if(uniqueInst_.contains(userdata))
+        self = uniqueInst_[userdata];
+
+    if(!self)
+        return;
+
+    // the first notification only reports the current version
+    const int previous = self->symbolVersion_.fetchAndStoreOrdered(version);
+    if(previous >= 0 && previous != version)
+    {
+        self->rebindPending_.store(1);
+        emit self->symbolsChanged();
+    }
+}
+
+/*static*/
+#ifdef __linux__
+void Tc3Manager::onNotification(const AmsAddr* addr, const AdsNotificationHeader* header, Tc3Manager::utype userdata)
+#elif _WIN32
+void Tc3Manager::onNotification(AmsAddr* addr, AdsNotificationHeader* header, Tc3Manager::utype userdata)
+#endif
+{
+    Q_UNUSED(addr)
+
+    // find the manager for this value. it would be great if we could simply use the pointer to it
+    // as userdata, however, this doesn't work with AdsAPI on 64 bit systems.
+    Tc3Manager *self = nullptr;
+    if(uniqueInst_.contains(userdata))
+        self = uniqueInst_[userdata];
+
+    if(!self)
+        return;
+
+    // data starts right after the header, don't use header->data as this is not implemented on Linux
+#ifdef __linux__
+    const char* data = reinterpret_cast<const char*>(header + 1);
+#elif _WIN32
+    const char* data = reinterpret_cast<const char*>(&header->data);
+#endif
+
+    // don't block the notification thread, the samples are decoded when the manager dispatches them
+    self->queueSample(header->hNotification, static_cast<quint64>(header->nTimeStamp), data, static_cast<int>(header->cbSampleSize));
+}
 
 Tc3Manager::SymbolInfo::SymbolInfo()
 {
-    memset(symbolName, 0, sizeof(char)*SPSSTRINGLENGTH);
-    memset(symbolType, 0, sizeof(char)*SPSSTRINGLENGTH);
-    memset(symbolComment, 0, sizeof(char)*SPSSTRINGLENGTH);
     group = 0;
     offset = 0;
     size = 0;
 }
+
+Tc3Manager::LaneStatistics::LaneStatistics()
+{
+    requests = 0;
+    totalWait_us = 0;
+    maxWait_us = 0;
+}
+
+Tc3Manager::LatencyEvent::LatencyEvent()
+{
+    transport_us = 0;
+    dispatch_us = 0;
+    consumer_us = -1;
+    total_us = 0;
+}
+
+Tc3Manager::LatencyRecord::LatencyRecord()
+{
+    timestamp = 0;
+    delivered = 0;
+    transport = 0;
+    dispatch = 0;
+    acknowledged = false;
+    reported = 0;
+}
+
+Tc3Manager::ErrorEvent::ErrorEvent()
+{
+    code = 0;
+    operation = Read;
+    count = 0;
+}
+
+// e.g. "MAIN.value: symbol not found (12 times)"
+QString Tc3Manager::ErrorEvent::toString() const
+{
+    QString text = tc3AdsError(code);
+    if(text.isEmpty())
+        text = QString("ads error 0x%1").arg(code, 0, 16);
+
+    if(!symbol.isEmpty())
+        text = QString("%1: %2").arg(symbol, text);
+
+    if(count > 1)
+        text += QString(" (%1 times)").arg(count);
+
+    return text;
+}
@@ -0,0 +1,80 @@
+#include <include/tc3sample.h>
+#include <include/tc3typeregistry.h>
+
+namespace
+{
+
+// milliseconds between 1601-01-01 and 1970-01-01
+const qint64 fileTimeEpochOffset = 11644473600000LL;
+
+}
+
+QDateTime Tc3Sample::dateTime() const
+{
+    return QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(timestamp / 10000) - fileTimeEpochOffset, Qt::UTC);
+}
+
+int Tc3SampleBatch::size() const
+{
+    return samples_.size();
+}
+
+bool Tc3SampleBatch::isEmpty() const
+{
+    return samples_.isEmpty();
+}
+
+const Tc3Sample& Tc3SampleBatch::at(int i) const
+{
+    return samples_.at(i);
+}
+
+const Tc3Sample& Tc3SampleBatch::operator[](int i) const
+{
+    return samples_.at(i);
+}
+
+QVector<Tc3Sample>::const_iterator Tc3SampleBatch::begin() const
+{
+    return samples_.begin();
+}
+
+QVector<Tc3Sample>::const_iterator Tc3SampleBatch::end() const
+{
+    return samples_.end();
+}
+
+const char* Tc3SampleBatch::data(const Tc3Sample& sample) const
+{
+    return data_.constData() + sample.offset;
+}
+
+QVariant Tc3SampleBatch::value(const Tc3Sample& sample) const
+{
+    QVariant v;
+    const Tc3TypeDescriptor* type = sample.type;
+    if(!type || !type->decode)
+        return v;
+
+    type->decode(*type, data(sample), sample.size, v);
+    return v;
+}
+
+void Tc3SampleBatch::append(quint64 timestamp, const char* data, int size)
+{
+    Tc3Sample s;
+    s.index = 0xFFFFFFFFu;
+    s.type = nullptr;
+    s.timestamp = timestamp;
+    s.offset = data_.size();
+    s.size = size;
+
+    samples_.append(s);
+    data_.append(data, size);
+}
+
+void Tc3SampleBatch::clear()
+{
+    samples_.clear();
+    data_.clear();
+}
@@ -0,0 +1,375 @@
+#include <include/tc3shared.h>
+#include <QThread>
+#include <atomic>
+#include <algorithm>
+
+namespace
+{
+
+// slot number and size of a forwarded write, followed by the data
+const int writeHeaderSize = 2 * sizeof(quint32);
+
+// tries of a read before the slot is considered abandoned
+const int maxReadAttempts = 1000;
+
+}
+
+Tc3SharedPublisher::Tc3SharedPublisher(Tc3Manager* manager, const QString& key, const QStringList& names,
+                                       Tc3Manager::NotificationType notificationType/*=Tc3Manager::NotificationType::Change*/,
+                                       int cycleTime_ms/*=100*/, int maxDelay_ms/*=0*/, QObject *parent/*=nullptr*/) :
+    QObject(parent)
+{
+    manager_ = manager;
+    key_ = key;
+    names_ = names;
+    notificationType_ = notificationType;
+    cycleTimeMillisecond_ = cycleTime_ms;
+    maxDelayMillisecond_ = maxDelay_ms;
+
+    QObject::connect(&server_, &QLocalServer::newConnection, this, [this]()
+    {
+        while(QLocalSocket* socket = server_.nextPendingConnection())
+        {
+            QObject::connect(socket, &QLocalSocket::readyRead, this, [this, socket](){ receive(socket); });
+            QObject::connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+            QObject::connect(socket, &QObject::destroyed, this, [this, socket](){ received_.remove(socket); });
+        }
+    });
+}
+
+Tc3SharedPublisher::~Tc3SharedPublisher()
+{
+    // stop the callbacks before the segment goes away, a deleted manager has no callbacks left
+    if(manager_)
+    {
+        for(int i=0; i<handles_.size(); ++i)
+        {
+            handles_[i].unsubscribe();
+            manager_->release(handles_[i]);
+        }
+    }
+
+    server_.close();
+    memory_.detach();
+}
+
+bool Tc3SharedPublisher::start()
+{
+    if(isStarted())
+        return true;
+
+    if(!manager_)
+        return false;
+
+    if(handles_.isEmpty())
+    {
+        foreach(const QString& name, names_)
+            handles_.append(manager_->handle(name));
+    }
+
+    // the segment is sized with the symbols, all of them have to be connected
+    quint32 namesSize = 0;
+    foreach(const Tc3Handle& h, handles_)
+    {
+        if(!h.isConnected())
+        {
+            emit error(QString("%1: not connected").arg(h.name()));
+            return false;
+        }
+
+        namesSize += static_cast<quint32>(h.name().toLatin1().size());
+    }
+
+    const quint32 count = static_cast<quint32>(handles_.size());
+    const quint32 namesOffset = Tc3Shared::align(sizeof(Tc3Shared::Header) + count * sizeof(Tc3Shared::Entry));
+    quint32 size = Tc3Shared::align(namesOffset + namesSize);
+    QVector<Tc3Shared::Entry> entries(static_cast<int>(count));
+    quint32 nameOffset = 0;
+    for(int i=0; i<handles_.size(); ++i)
+    {
+        Tc3Shared::Entry& e = entries[i];
+        e.nameOffset = nameOffset;
+        e.nameLength = static_cast<quint32>(handles_[i].name().toLatin1().size());
+        e.slotOffset = size;
+        e.size = static_cast<quint32>(handles_[i].size());
+
+        nameOffset += e.nameLength;
+        size = Tc3Shared::align(size + sizeof(Tc3Shared::Slot) + e.size);
+    }
+
+    // a segment of a publisher that crashed may still exist on unix, attaching and detaching
+    // again removes it
+    memory_.setKey(key_);
+    if(!memory_.create(static_cast<int>(size)))
+    {
+        if(memory_.error() == QSharedMemory::AlreadyExists && memory_.attach())
+            memory_.detach();
+
+        if(!memory_.create(static_cast<int>(size)))
+        {
+            emit error(QString("%1: %2").arg(key_, memory_.errorString()));
+            return false;
+        }
+    }
+
+    char* segment = static_cast<char*>(memory_.data());
+    memset(segment, 0, size);
+
+    Tc3Shared::Header* header = reinterpret_cast<Tc3Shared::Header*>(segment);
+    header->magic = Tc3Shared::magic;
+    header->version = Tc3Shared::version;
+    header->count = count;
+    header->namesOffset = namesOffset;
+    memcpy(header + 1, entries.constData(), count * sizeof(Tc3Shared::Entry));
+
+    for(int i=0; i<handles_.size(); ++i)
+    {
+        const QByteArray name = handles_[i].name().toLatin1();
+        memcpy(segment + namesOffset + entries[i].nameOffset, name.constData(), static_cast<size_t>(name.size()));
+    }
+
+    QLocalServer::removeServer(key_);
+    if(!server_.listen(key_))
+        emit error(QString("%1: %2").arg(key_, server_.errorString()));
+
+    for(int i=0; i<handles_.size(); ++i)
+    {
+        handles_[i].subscribe([this, i](const char* data, int size, quint64 timestamp){ publish(i, data, size, timestamp); },
+                              notificationType_, cycleTimeMillisecond_, maxDelayMillisecond_);
+    }
+
+    return true;
+}
+
+bool Tc3SharedPublisher::isStarted() const
+{
+    return memory_.isAttached();
+}
+
+QString Tc3SharedPublisher::key() const
+{
+    return key_;
+}
+
+int Tc3SharedPublisher::count() const
+{
+    return handles_.size();
+}
+
+// called in the thread of the manager, the only writer of the segment
+void Tc3SharedPublisher::publish(int slot, const char* data, int size, quint64 timestamp)
+{
+    char* segment = static_cast<char*>(memory_.data());
+    const Tc3Shared::Entry& e = Tc3Shared::entries(segment)[slot];
+    Tc3Shared::Slot* s = reinterpret_cast<Tc3Shared::Slot*>(segment + e.slotOffset);
+
+    // odd while writing, readers retry
+    s->sequence.fetchAndAddOrdered(1);
+    memcpy(s + 1, data, static_cast<size_t>(std::min(size, static_cast<int>(e.size))));
+    s->timestamp = timestamp;
+    s->sequence.fetchAndAddOrdered(1);
+}
+
+void Tc3SharedPublisher::receive(QLocalSocket* socket)
+{
+    QByteArray& buffer = received_[socket];
+    buffer.append(socket->readAll());
+
+    // the handles are gone with their manager
+    if(!manager_)
+    {
+        buffer.clear();
+        return;
+    }
+
+    while(buffer.size() >= writeHeaderSize)
+    {
+        quint32 slot;
+        quint32 size;
+        memcpy(&slot, buffer.constData(), sizeof(slot));
+        memcpy(&size, buffer.constData() + sizeof(slot), sizeof(size));
+
+        // a write has exactly the size of its slot, anything else means the stream is out of step
+        // and nothing that follows can be trusted
+        if(slot >= static_cast<quint32>(handles_.size()) || size != Tc3Shared::entries(memory_.constData())[slot].size)
+        {
+            emit error(QString("%1: invalid write of %2 bytes to slot %3").arg(key_).arg(size).arg(slot));
+            buffer.clear();
+            socket->disconnectFromServer();
+            return;
+        }
+
+        if(buffer.size() < writeHeaderSize + static_cast<int>(size))
+            break;
+
+        handles_[static_cast<int>(slot)].write(buffer.constData() + writeHeaderSize, static_cast<int>(size));
+        buffer.remove(0, writeHeaderSize + static_cast<int>(size));
+    }
+}
+
+Tc3SharedSubscriber::Tc3SharedSubscriber(const QString& key, QObject *parent/*=nullptr*/) :
+    QObject(parent)
+{
+    key_ = key;
+    segment_ = nullptr;
+    count_ = 0;
+
+    QObject::connect(&socket_, &QLocalSocket::stateChanged, this, &Tc3SharedSubscriber::onStateChanged);
+}
+
+Tc3SharedSubscriber::~Tc3SharedSubscriber()
+{
+    QObject::disconnect(&socket_, nullptr, this, nullptr);
+    socket_.disconnectFromServer();
+    memory_.detach();
+}
+
+bool Tc3SharedSubscriber::attach()
+{
+    if(isAttached())
+        return true;
+
+    memory_.setKey(key_);
+    if(!memory_.attach(QSharedMemory::ReadOnly))
+    {
+        emit error(QString("%1: %2").arg(key_, memory_.errorString()));
+        return false;
+    }
+
+    const Tc3Shared::Header* header = static_cast<const Tc3Shared::Header*>(memory_.constData());
+    if(header->magic != Tc3Shared::magic || header->version != Tc3Shared::version)
+    {
+        memory_.detach();
+        emit error(QString("%1: not a segment of Tc3SharedPublisher").arg(key_));
+        return false;
+    }
+
+    segment_ = static_cast<const char*>(memory_.constData());
+    count_ = static_cast<int>(header->count);
+
+    index_.clear();
+    for(int i=0; i<count_; ++i)
+        index_.insert(name(i), i);
+
+    return true;
+}
+
+bool Tc3SharedSubscriber::isAttached() const
+{
+    return segment_ != nullptr;
+}
+
+int Tc3SharedSubscriber::count() const
+{
+    return count_;
+}
+
+int Tc3SharedSubscriber::indexOf(const QString& name) const
+{
+    return index_.value(name, -1);
+}
+
+QString Tc3SharedSubscriber::name(int slot) const
+{
+    if(slot < 0 || slot >= count_)
+        return QString();
+
+    const Tc3Shared::Header* header = reinterpret_cast<const Tc3Shared::Header*>(segment_);
+    const Tc3Shared::Entry& e = Tc3Shared::entries(segment_)[slot];
+    return QString::fromLatin1(segment_ + header->namesOffset + e.nameOffset, static_cast<int>(e.nameLength));
+}
+
+int Tc3SharedSubscriber::size(int slot) const
+{
+    if(slot < 0 || slot >= count_)
+        return 0;
+
+    return static_cast<int>(Tc3Shared::entries(segment_)[slot].size);
+}
+
+quint32 Tc3SharedSubscriber::sequence(int slot) const
+{
+    const Tc3Shared::Slot* s = this->slot(slot);
+    return s ? s->sequence.loadAcquire() : 0;
+}
+
+bool Tc3SharedSubscriber::read(int slot, void* data, int size, quint64* timestamp/*=nullptr*/) const
+{
+    const Tc3Shared::Slot* s = this->slot(slot);
+    if(!s || size != this->size(slot))
+        return false;
+
+    // seqlock, the publisher only holds a slot for a memcpy. A sequence that stays odd means the
+    // publisher died in the middle of a write, the read gives up then instead of spinning forever
+    for(int attempt=0; attempt<maxReadAttempts; ++attempt)
+    {
+        if(attempt)
+            QThread::yieldCurrentThread();
+
+        const quint32 before = s->sequence.loadAcquire();
+        if(!before)
+            return false;
+
+        if(before & 1)
+            continue;
+
+        memcpy(data, s + 1, static_cast<size_t>(size));
+        const quint64 t = s->timestamp;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(s->sequence.load() == before)
+        {
+            if(timestamp)
+                *timestamp = t;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Tc3SharedSubscriber::write(int slot, const void* data, int size)
+{
+    if(slot < 0 || slot >= count_ || size != this->size(slot))
+        return false;
+
+    const quint32 header[2] = { static_cast<quint32>(slot), static_cast<quint32>(size) };
+    if(socket_.state() == QLocalSocket::ConnectedState)
+    {
+        socket_.write(reinterpret_cast<const char*>(header), writeHeaderSize);
+        socket_.write(static_cast<const char*>(data), size);
+        return socket_.flush();
+    }
+
+    // sent by onStateChanged once connected, such that a missing publisher doesn't block the caller
+    queued_.append(reinterpret_cast<const char*>(header), writeHeaderSize);
+    queued_.append(static_cast<const char*>(data), size);
+    if(socket_.state() == QLocalSocket::UnconnectedState)
+        socket_.connectToServer(key_);
+
+    return true;
+}
+
+void Tc3SharedSubscriber::onStateChanged(QLocalSocket::LocalSocketState state)
+{
+    if(state == QLocalSocket::ConnectedState)
+    {
+        socket_.write(queued_);
+        queued_.clear();
+        socket_.flush();
+    }
+    else if(state == QLocalSocket::UnconnectedState && !queued_.isEmpty())
+    {
+        queued_.clear();
+        emit error(QString("%1: %2").arg(key_, socket_.errorString()));
+    }
+}
+
+const Tc3Shared::Slot* Tc3SharedSubscriber::slot(int slot) const
+{
+    if(slot < 0 || slot >= count_)
+        return nullptr;
+
+    return reinterpret_cast<const Tc3Shared::Slot*>(segment_ + Tc3Shared::entries(segment_)[slot].slotOffset);
+}
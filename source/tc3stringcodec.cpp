@@ -0,0 +1,235 @@
+#include <include/tc3stringcodec.h>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QADS_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+// Windows-1252 0x80-0x9F, the undefined positions are mapped 1:1 like Windows does
+const ushort cp1252[32] =
+{
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178
+};
+
+inline int firstBit(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+inline ushort toUnicode(uchar c, Tc3StringCodec::Encoding encoding)
+{
+    if(encoding == Tc3StringCodec::Windows1252 && c >= 0x80 && c < 0xA0)
+        return cp1252[c - 0x80];
+
+    return c;
+}
+
+inline char fromUnicode(ushort u, Tc3StringCodec::Encoding encoding)
+{
+    if(u < 0x80)
+        return static_cast<char>(u);
+
+    if(encoding == Tc3StringCodec::Latin1)
+        return u < 0x100 ? static_cast<char>(u) : '?';
+
+    if(u >= 0xA0 && u < 0x100)
+        return static_cast<char>(u);
+
+    for(int i=0; i<32; ++i)
+    {
+        if(cp1252[i] == u)
+            return static_cast<char>(0x80 + i);
+    }
+
+    return '?';
+}
+
+inline ushort loadUnit(const char* data)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(data);
+    return static_cast<ushort>(p[0] | (p[1] << 8));
+}
+
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+inline void storeUnit(char* data, ushort u)
+{
+    data[0] = static_cast<char>(u & 0xFF);
+    data[1] = static_cast<char>(u >> 8);
+}
+#endif
+
+}
+
+/*static*/
+int Tc3StringCodec::nulIndex(const char* data, int size)
+{
+    int i=0;
+#ifdef QADS_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 16 <= size; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero));
+        if(mask)
+            return i + firstBit(static_cast<unsigned int>(mask));
+    }
+#endif
+    for(; i < size; ++i)
+    {
+        if(!data[i])
+            return i;
+    }
+
+    return size;
+}
+
+/*static*/
+int Tc3StringCodec::nulIndex16(const char* data, int length)
+{
+    int i=0;
+#ifdef QADS_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 8 <= length; i += 8)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 2*i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(chunk, zero));
+        if(mask)
+            return i + (firstBit(static_cast<unsigned int>(mask)) >> 1);
+    }
+#endif
+    for(; i < length; ++i)
+    {
+        if(!loadUnit(data + 2*i))
+            return i;
+    }
+
+    return length;
+}
+
+/*static*/
+void Tc3StringCodec::decodeString(const char* data, int size, QString& out, Encoding encoding)
+{
+    const int length = nulIndex(data, size);
+    out.resize(length);
+
+    ushort* dst = reinterpret_cast<ushort*>(out.data());
+    const uchar* src = reinterpret_cast<const uchar*>(data);
+
+    int i=0;
+#ifdef QADS_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i minusOne = _mm_set1_epi8(-1);
+    const __m128i c1Limit = _mm_set1_epi8(0x20);
+    for(; i + 16 <= length; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+        // bytes in 0x80-0x9F are the only ones that differ between Latin-1 and Windows-1252,
+        // shifted by 0x80 they become the signed range 0..31
+        if(encoding == Windows1252)
+        {
+            __m128i shifted = _mm_xor_si128(chunk, bias);
+            __m128i c1 = _mm_and_si128(_mm_cmpgt_epi8(shifted, minusOne), _mm_cmplt_epi8(shifted, c1Limit));
+            if(_mm_movemask_epi8(c1))
+                break;
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(chunk, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(chunk, zero));
+    }
+#endif
+    for(; i < length; ++i)
+        dst[i] = toUnicode(src[i], encoding);
+}
+
+/*static*/
+void Tc3StringCodec::decodeWString(const char* data, int size, QString& out)
+{
+    const int length = nulIndex16(data, size >> 1);
+    out.resize(length);
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    memcpy(out.data(), data, static_cast<size_t>(length) * 2);
+#else
+    ushort* dst = reinterpret_cast<ushort*>(out.data());
+    for(int i=0; i<length; ++i)
+        dst[i] = loadUnit(data + 2*i);
+#endif
+}
+
+/*static*/
+int Tc3StringCodec::encodeString(const QString& text, char* data, int size, Encoding encoding)
+{
+    if(size <= 0)
+        return 0;
+
+    const int length = std::min(text.size(), size - 1);
+    const ushort* src = reinterpret_cast<const ushort*>(text.unicode());
+
+    int i=0;
+#ifdef QADS_SSE2
+    const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 16 <= length; i += 16)
+    {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+
+        // everything below 0x80 is the same in both encodings and can simply be narrowed
+        __m128i outside = _mm_and_si128(_mm_or_si128(lo, hi), nonAscii);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi16(outside, zero)) != 0xFFFF)
+            break;
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for(; i < length; ++i)
+        data[i] = fromUnicode(src[i], encoding);
+
+    memset(data + length, 0, static_cast<size_t>(size - length));
+    return length;
+}
+
+/*static*/
+int Tc3StringCodec::encodeWString(const QString& text, char* data, int size)
+{
+    const int capacity = size >> 1;
+    if(capacity <= 0)
+        return 0;
+
+    int length = std::min(text.size(), capacity - 1);
+
+    // don't leave half of a surrogate pair at the end of a truncated string
+    if(length < text.size() && length > 0 && text.at(length - 1).unicode() >= 0xD800 && text.at(length - 1).unicode() < 0xDC00)
+        --length;
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    memcpy(data, text.unicode(), static_cast<size_t>(length) * 2);
+#else
+    const ushort* src = reinterpret_cast<const ushort*>(text.unicode());
+    for(int i=0; i<length; ++i)
+        storeUnit(data + 2*i, src[i]);
+#endif
+
+    memset(data + 2*length, 0, static_cast<size_t>(size - 2*length));
+    return length;
+}
@@ -0,0 +1,189 @@
+#include <include/tc3structdiff.h>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QADS_SSE2
+#endif
+
+namespace
+{
+
+const int wordSize = 8;
+const int blockWords = 4;
+
+inline quint64 loadWord(const char* p)
+{
+    quint64 w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+}
+
+Tc3StructDiff::Tc3StructDiff()
+{
+    size_ = 0;
+}
+
+void Tc3StructDiff::setLayout(const QVector<Field>& fields, int size)
+{
+    fields_ = fields;
+    size_ = size;
+    image_.clear();
+    marked_.fill(0, fields_.size());
+
+    // counting sort of the fields by the words they overlap
+    const int words = (size + wordSize - 1) / wordSize;
+    wordStart_.fill(0, words + 1);
+    for(int i=0; i<fields_.size(); ++i)
+    {
+        const Field& f = fields_[i];
+        if(!f.size || static_cast<int>(f.offset) >= size)
+            continue;
+
+        const int last = (std::min(static_cast<int>(f.offset + f.size), size) - 1) / wordSize;
+        for(int w=static_cast<int>(f.offset) / wordSize; w<=last; ++w)
+            wordStart_[w + 1]++;
+    }
+
+    for(int w=0; w<words; ++w)
+        wordStart_[w + 1] += wordStart_[w];
+
+    wordFields_.fill(0, static_cast<int>(wordStart_[words]));
+    QVector<quint32> next = wordStart_;
+    for(int i=0; i<fields_.size(); ++i)
+    {
+        const Field& f = fields_[i];
+        if(!f.size || static_cast<int>(f.offset) >= size)
+            continue;
+
+        const int last = (std::min(static_cast<int>(f.offset + f.size), size) - 1) / wordSize;
+        for(int w=static_cast<int>(f.offset) / wordSize; w<=last; ++w)
+            wordFields_[static_cast<int>(next[w]++)] = static_cast<quint32>(i);
+    }
+}
+
+bool Tc3StructDiff::isValid() const
+{
+    return size_ > 0;
+}
+
+int Tc3StructDiff::size() const
+{
+    return size_;
+}
+
+const QVector<Tc3StructDiff::Field>& Tc3StructDiff::fields() const
+{
+    return fields_;
+}
+
+QVector<int> Tc3StructDiff::update(const char* data, int size)
+{
+    QVector<int> r;
+    if(!isValid() || size != size_)
+        return r;
+
+    if(image_.size() != size_)
+    {
+        image_ = QByteArray(data, size);
+        for(int i=0; i<fields_.size(); ++i)
+            r.append(i);
+
+        return r;
+    }
+
+    const char* previous = image_.constData();
+    const int words = size_ / wordSize;
+    int w = 0;
+#ifdef QADS_SSE2
+    // two words per compare, the mask of equal bytes tells which of them differ
+    for(; w+2<=words; w+=2)
+    {
+        const int equal = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + w * wordSize)),
+                                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + w * wordSize))));
+        if(equal == 0xFFFF)
+            continue;
+
+        if((equal & 0xFF) != 0xFF)
+            markWord(w, data, previous);
+
+        if((equal >> 8) != 0xFF)
+            markWord(w + 1, data, previous);
+    }
+#endif
+
+    // whole blocks without SSE2, the compiler turns the xor/or chain into vector instructions
+    for(; w+blockWords<=words; w+=blockWords)
+    {
+        const char* a = data + w * wordSize;
+        const char* b = previous + w * wordSize;
+        quint64 d = 0;
+        for(int k=0; k<blockWords; ++k)
+            d |= loadWord(a + k * wordSize) ^ loadWord(b + k * wordSize);
+
+        if(!d)
+            continue;
+
+        for(int k=0; k<blockWords; ++k)
+        {
+            if(loadWord(a + k * wordSize) != loadWord(b + k * wordSize))
+                markWord(w + k, data, previous);
+        }
+    }
+
+    for(; w<words; ++w)
+    {
+        if(loadWord(data + w * wordSize) != loadWord(previous + w * wordSize))
+            markWord(w, data, previous);
+    }
+
+    const int tail = words * wordSize;
+    if(tail < size_ && memcmp(data + tail, previous + tail, static_cast<size_t>(size_ - tail)))
+        markWord(words, data, previous);
+
+    for(int i=0; i<marked_.size(); ++i)
+    {
+        if(marked_[i])
+        {
+            r.append(i);
+            marked_[i] = 0;
+        }
+    }
+
+    if(!r.isEmpty())
+        memcpy(image_.data(), data, static_cast<size_t>(size_));
+
+    return r;
+}
+
+const QByteArray& Tc3StructDiff::image() const
+{
+    return image_;
+}
+
+void Tc3StructDiff::reset()
+{
+    image_.clear();
+}
+
+// marks the fields of a word that differ in the bytes they share with the word
+void Tc3StructDiff::markWord(int word, const char* data, const char* previous)
+{
+    const int begin = word * wordSize;
+    const int end = std::min(begin + wordSize, size_);
+    for(quint32 k=wordStart_[word]; k<wordStart_[word + 1]; ++k)
+    {
+        const int i = static_cast<int>(wordFields_[static_cast<int>(k)]);
+        if(marked_[i])
+            continue;
+
+        const Field& f = fields_[i];
+        const int from = std::max(begin, static_cast<int>(f.offset));
+        const int to = std::min(end, static_cast<int>(f.offset + f.size));
+        if(from < to && memcmp(data + from, previous + from, static_cast<size_t>(to - from)))
+            marked_[i] = 1;
+    }
+}
@@ -0,0 +1,772 @@
+#include <include/tc3symbolbrowser.h>
+#include <include/tc3manager.h>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QRegExp>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+// number of buckets of the trigram index
+const int trigramBuckets = 1 << 16;
+
+// sizes returned by Tc3Ads::SymUploadInfo2
+struct UploadInfo
+{
+    quint32 nSymbols;
+    quint32 nSymSize;
+    quint32 nDatatypes;
+    quint32 nDatatypeSize;
+    quint32 nMaxDynSymbols;
+    quint32 nUsedDynSymbols;
+};
+
+inline const char* symbolName(const AdsSymbolEntry* e)
+{
+    return reinterpret_cast<const char*>(e + 1);
+}
+
+inline const char* symbolType(const AdsSymbolEntry* e)
+{
+    return symbolName(e) + e->nameLength + 1;
+}
+
+inline const char* symbolComment(const AdsSymbolEntry* e)
+{
+    return symbolType(e) + e->typeLength + 1;
+}
+
+}
+
+Tc3SymbolBrowser::Node::Node()
+{
+    group = 0;
+    offset = 0;
+    size = 0;
+    expandable = false;
+}
+
+bool Tc3SymbolBrowser::Node::isValid() const
+{
+    return !name.isEmpty();
+}
+
+Tc3SymbolBrowser::Tc3SymbolBrowser(Tc3Manager* manager)
+{
+    manager_ = manager;
+}
+
+// The uploads run without mutex_ of the manager, its lane serializes them on the port. The index
+// is built aside, only the new tables are swapped in under the lock
+bool Tc3SymbolBrowser::refresh()
+{
+    UploadInfo info;
+    if(!manager_->syncReadReq(Tc3Ads::SymUploadInfo2, 0, &info, sizeof(info), nullptr))
+        return false;
+
+    QByteArray symbols(static_cast<int>(info.nSymSize), 0);
+    QByteArray datatypes(static_cast<int>(info.nDatatypeSize), 0);
+    if(!manager_->syncReadReq(ADSIGRP_SYM_UPLOAD, 0, symbols.data(), symbols.size(), nullptr) ||
+       !manager_->syncReadReq(Tc3Ads::SymDtUpload, 0, datatypes.data(), datatypes.size(), nullptr))
+    {
+        return false;
+    }
+
+    Tc3SymbolBrowser browser(manager_);
+    browser.symbols_ = symbols;
+    browser.datatypes_ = datatypes;
+    browser.buildIndex();
+
+    QMutexLocker locker(&manager_->mutex_);
+    *this = browser;
+    return true;
+}
+
+int Tc3SymbolBrowser::count() const
+{
+    return entries_.size();
+}
+
+QVector<Tc3SymbolBrowser::Node> Tc3SymbolBrowser::findPrefix(const QString& prefix, int limit/*=100*/) const
+{
+    QVector<Node> r;
+    const QByteArray p = lowerLatin1(prefix);
+    for(int id=lowerBound(p); id<entries_.size() && r.size()<limit && hasPrefix(id, p); ++id)
+        r.append(symbolNode(id));
+
+    return r;
+}
+
+QVector<Tc3SymbolBrowser::Node> Tc3SymbolBrowser::findSubstring(const QString& text, int limit/*=100*/) const
+{
+    QVector<Node> r;
+    const QByteArray t = lowerLatin1(text);
+    if(t.isEmpty())
+        return r;
+
+    auto contains = [this, &t](int id)
+    {
+        const char* begin = lower_.constData() + lowerOffsets_[id];
+        const char* end = lower_.constData() + lowerOffsets_[id + 1];
+        return std::search(begin, end, t.constData(), t.constData() + t.size()) != end;
+    };
+
+    // too short for the trigram index, these match so many names that the limit is reached quickly
+    if(t.size() < 3)
+    {
+        for(int id=0; id<entries_.size() && r.size()<limit; ++id)
+        {
+            if(contains(id))
+                r.append(symbolNode(id));
+        }
+        return r;
+    }
+
+    // every match contains all trigrams of the text, candidates are taken from the rarest one
+    quint32 best = trigram(t.constData());
+    for(int i=1; i+3<=t.size(); ++i)
+    {
+        quint32 b = trigram(t.constData() + i);
+        if(trigramStart_[static_cast<int>(b) + 1] - trigramStart_[static_cast<int>(b)] < trigramStart_[static_cast<int>(best) + 1] - trigramStart_[static_cast<int>(best)])
+            best = b;
+    }
+
+    for(quint32 i=trigramStart_[static_cast<int>(best)]; i<trigramStart_[static_cast<int>(best) + 1] && r.size()<limit; ++i)
+    {
+        const int id = static_cast<int>(trigrams_[static_cast<int>(i)]);
+        if(contains(id))
+            r.append(symbolNode(id));
+    }
+
+    return r;
+}
+
+Tc3SymbolBrowser::Node Tc3SymbolBrowser::node(const QString& path) const
+{
+    int id = findSymbol(path);
+    if(id >= 0)
+        return symbolNode(id);
+
+    // symbol names contain dots themselves (MAIN.axis), find the longest prefix that is a symbol
+    // and resolve the rest of the path member by member
+    for(int cut=path.size()-1; cut>0; --cut)
+    {
+        if(path[cut] != '.' && path[cut] != '[')
+            continue;
+
+        id = findSymbol(path.left(cut));
+        if(id < 0)
+            continue;
+
+        Node n = symbolNode(id);
+        int pos = cut;
+        while(n.isValid() && pos < path.size())
+        {
+            int end;
+            QString segment;
+            if(path[pos] == '[')
+            {
+                end = path.indexOf(']', pos);
+                if(end < 0)
+                    return Node();
+
+                segment = path.mid(pos, end - pos + 1);
+                pos = end + 1;
+            }
+            else if(path[pos] == '.')
+            {
+                end = pos + 1;
+                while(end < path.size() && path[end] != '.' && path[end] != '[')
+                    ++end;
+
+                segment = path.mid(pos + 1, end - pos - 1);
+                pos = end;
+            }
+            else
+            {
+                return Node();
+            }
+
+            n = child(n, segment);
+        }
+
+        return n;
+    }
+
+    // a namespace, i.e. the first part of symbol names
+    QByteArray p = lowerLatin1(path + '.');
+    id = lowerBound(p);
+    if(id < entries_.size() && hasPrefix(id, p))
+        return namespaceNode(path);
+
+    return Node();
+}
+
+QVector<Tc3SymbolBrowser::Node> Tc3SymbolBrowser::children(const QString& path, int first/*=0*/, int count/*=-1*/) const
+{
+    if(path.isEmpty())
+    {
+        // top level namespaces, names are sorted, so equal namespaces are adjacent
+        QVector<Node> r;
+        QByteArray last;
+        for(int id=0; id<entries_.size(); ++id)
+        {
+            const char* name = lower_.constData() + lowerOffsets_[id];
+            const int length = static_cast<int>(lowerOffsets_[id + 1] - lowerOffsets_[id]);
+            const char* dot = static_cast<const char*>(memchr(name, '.', static_cast<size_t>(length)));
+            const QByteArray ns(name, dot ? static_cast<int>(dot - name) : length);
+            if(ns == last)
+                continue;
+
+            last = ns;
+            if(dot)
+                r.append(namespaceNode(QString::fromLatin1(symbolName(entry(id)), ns.size())));
+            else
+                r.append(symbolNode(id));
+        }
+        return r.mid(first, count);
+    }
+
+    return children(node(path), first, count);
+}
+
+QVector<Tc3SymbolBrowser::Node> Tc3SymbolBrowser::children(const Node& node, int first/*=0*/, int count/*=-1*/) const
+{
+    QVector<Node> r;
+    if(!node.isValid() || !node.expandable)
+        return r;
+
+    // namespace, all symbols starting with its name
+    if(node.type.isEmpty())
+    {
+        const QByteArray p = lowerLatin1(node.name + '.');
+        int n = 0;
+        for(int id=lowerBound(p); id<entries_.size() && hasPrefix(id, p) && (count < 0 || r.size() < count); ++id)
+        {
+            if(n++ >= first)
+                r.append(symbolNode(id));
+        }
+        return r;
+    }
+
+    ArrayInfo info;
+    if(arrayInfo(node.type, info))
+    {
+        const int last = count < 0 ? info.count : std::min(info.count, first + count);
+        for(int i=std::max(0, first); i<last; ++i)
+            r.append(element(node, info, i));
+
+        return r;
+    }
+
+    // aliases of structs are expanded like the struct itself
+    const Tc3Ads::DatatypeEntry* dt = datatype(node.type);
+    for(int depth=0; dt && !dt->subItems && dt->typeLength && depth<16; ++depth)
+        dt = datatype(QString::fromLatin1(Tc3Ads::datatypeType(dt), dt->typeLength));
+
+    if(!dt)
+        return r;
+
+    const Tc3Ads::DatatypeEntry* item = Tc3Ads::datatypeFirstSubItem(dt);
+    for(int i=0; i<dt->subItems && (count < 0 || r.size() < count); ++i, item=Tc3Ads::datatypeNextSubItem(item))
+    {
+        if(i >= first)
+            r.append(member(node, item));
+    }
+
+    return r;
+}
+
+QVector<Tc3SymbolBrowser::Node> Tc3SymbolBrowser::match(const QString& pattern) const
+{
+    // split into segments, each one either a name or an index in brackets
+    QStringList segments;
+    int pos = 0;
+    while(pos < pattern.size())
+    {
+        int end;
+        if(pattern[pos] == '[')
+        {
+            end = pattern.indexOf(']', pos);
+            if(end < 0)
+                return QVector<Node>();
+
+            segments.append(pattern.mid(pos, end - pos + 1));
+            pos = end + 1;
+        }
+        else
+        {
+            if(pattern[pos] == '.')
+                ++pos;
+
+            end = pos;
+            while(end < pattern.size() && pattern[end] != '.' && pattern[end] != '[')
+                ++end;
+
+            segments.append(pattern.mid(pos, end - pos));
+            pos = end;
+        }
+    }
+
+    QVector<Node> current;
+    if(segments.isEmpty() || segments.first().isEmpty() || segments.first().startsWith('['))
+        return current;
+
+    // namespaces and symbols without namespace
+    if(isWildcard(segments.first()))
+    {
+        QRegExp rx(segments.first(), Qt::CaseInsensitive, QRegExp::Wildcard);
+        foreach(const Node& n, children(QString()))
+        {
+            if(rx.exactMatch(n.name))
+                current.append(n);
+        }
+    }
+    else
+    {
+        Node n = node(segments.first());
+        if(n.isValid())
+            current.append(n);
+    }
+
+    for(int s=1; s<segments.size() && !current.isEmpty(); ++s)
+    {
+        const QString& segment = segments[s];
+        const bool wildcard = isWildcard(segment);
+        QRegExp rx(segment, Qt::CaseInsensitive, QRegExp::Wildcard);
+
+        QVector<Node> next;
+        foreach(const Node& parent, current)
+        {
+            if(segment.startsWith('['))
+            {
+                ArrayInfo info;
+                QVector<int> indices;
+                if(!arrayInfo(parent.type, info) || !elementIndices(info, segment, indices))
+                    continue;
+
+                foreach(int i, indices)
+                    next.append(element(parent, info, i));
+            }
+            else if(wildcard)
+            {
+                foreach(const Node& n, children(parent))
+                {
+                    if(rx.exactMatch(n.name.mid(parent.name.size() + 1)))
+                        next.append(n);
+                }
+            }
+            else
+            {
+                Node n = descend(parent, segment);
+                if(n.isValid())
+                    next.append(n);
+            }
+        }
+        current = next;
+    }
+
+    return current;
+}
+
+const AdsSymbolEntry* Tc3SymbolBrowser::entry(int id) const
+{
+    return reinterpret_cast<const AdsSymbolEntry*>(symbols_.constData() + entries_[id]);
+}
+
+Tc3SymbolBrowser::Node Tc3SymbolBrowser::symbolNode(int id) const
+{
+    const AdsSymbolEntry* e = entry(id);
+
+    Node n;
+    n.name = QString::fromLatin1(symbolName(e), e->nameLength);
+    n.type = QString::fromLatin1(symbolType(e), e->typeLength);
+    n.comment = QString::fromLatin1(symbolComment(e), e->commentLength);
+    n.group = e->iGroup;
+    n.offset = e->iOffs;
+    n.size = e->size;
+    n.expandable = isExpandable(n.type);
+    return n;
+}
+
+Tc3SymbolBrowser::Node Tc3SymbolBrowser::namespaceNode(const QString& name) const
+{
+    Node n;
+    n.name = name;
+    n.expandable = true;
+    return n;
+}
+
+// first id with a name not less than lowerPrefix
+int Tc3SymbolBrowser::lowerBound(const QByteArray& lowerPrefix) const
+{
+    int lo = 0;
+    int hi = entries_.size();
+    while(lo < hi)
+    {
+        const int mid = (lo + hi) / 2;
+        const char* name = lower_.constData() + lowerOffsets_[mid];
+        const int length = static_cast<int>(lowerOffsets_[mid + 1] - lowerOffsets_[mid]);
+        const int c = memcmp(name, lowerPrefix.constData(), static_cast<size_t>(std::min(length, lowerPrefix.size())));
+        if(c < 0 || (c == 0 && length < lowerPrefix.size()))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+bool Tc3SymbolBrowser::hasPrefix(int id, const QByteArray& lowerPrefix) const
+{
+    const int length = static_cast<int>(lowerOffsets_[id + 1] - lowerOffsets_[id]);
+    return length >= lowerPrefix.size() && !memcmp(lower_.constData() + lowerOffsets_[id], lowerPrefix.constData(), static_cast<size_t>(lowerPrefix.size()));
+}
+
+int Tc3SymbolBrowser::findSymbol(const QString& name) const
+{
+    const QByteArray n = lowerLatin1(name);
+    const int id = lowerBound(n);
+    if(id < entries_.size() && static_cast<int>(lowerOffsets_[id + 1] - lowerOffsets_[id]) == n.size() && hasPrefix(id, n))
+        return id;
+
+    return -1;
+}
+
+const Tc3Ads::DatatypeEntry* Tc3SymbolBrowser::datatype(const QString& type) const
+{
+    auto it = datatypeIndex_.constFind(type.toLower());
+    if(it == datatypeIndex_.constEnd())
+        return nullptr;
+
+    return reinterpret_cast<const Tc3Ads::DatatypeEntry*>(datatypes_.constData() + it.value());
+}
+
+// arrays are described in the datatype table, but only if the plc uploads them. Fall back to
+// parsing the type name, e.g. ARRAY [1..10,0..2] OF ST_Axis
+bool Tc3SymbolBrowser::arrayInfo(const QString& type, ArrayInfo& info) const
+{
+    info.lowerBounds.clear();
+    info.elements.clear();
+    info.count = 1;
+
+    const Tc3Ads::DatatypeEntry* dt = datatype(type);
+    if(dt && dt->arrayDim > 0)
+    {
+        const Tc3Ads::DatatypeArrayInfo* dims = Tc3Ads::datatypeArrayInfo(dt);
+        for(int i=0; i<dt->arrayDim; ++i)
+        {
+            info.lowerBounds.append(dims[i].lBound);
+            info.elements.append(static_cast<int>(dims[i].elements));
+            info.count *= static_cast<int>(dims[i].elements);
+        }
+        info.elementType = QString::fromLatin1(Tc3Ads::datatypeType(dt), dt->typeLength);
+        return info.count > 0;
+    }
+
+    if(!type.startsWith("ARRAY"))
+        return false;
+
+    const int open = type.indexOf('[');
+    const int close = type.indexOf(']', open);
+    const int of = type.indexOf(" OF ", close);
+    if(open < 0 || close < 0 || of < 0)
+        return false;
+
+    foreach(const QString& dimension, type.mid(open + 1, close - open - 1).split(','))
+    {
+        QStringList bounds = dimension.split("..");
+        if(bounds.size() != 2)
+            return false;
+
+        const int lower = bounds[0].trimmed().toInt();
+        const int upper = bounds[1].trimmed().toInt();
+        info.lowerBounds.append(lower);
+        info.elements.append(upper - lower + 1);
+        info.count *= upper - lower + 1;
+    }
+
+    info.elementType = type.mid(of + 4).trimmed();
+    return info.count > 0;
+}
+
+bool Tc3SymbolBrowser::isExpandable(const QString& type) const
+{
+    // pointers and references don't point into the memory of the symbol, don't follow them
+    if(type.startsWith("POINTER TO") || type.startsWith("REFERENCE TO"))
+        return false;
+
+    if(type.startsWith("ARRAY"))
+        return true;
+
+    const Tc3Ads::DatatypeEntry* dt = datatype(type);
+    for(int depth=0; dt && depth<16; ++depth)
+    {
+        if(dt->subItems > 0 || dt->arrayDim > 0)
+            return true;
+
+        if(!dt->typeLength)
+            return false;
+
+        dt = datatype(QString::fromLatin1(Tc3Ads::datatypeType(dt), dt->typeLength));
+    }
+
+    return false;
+}
+
+Tc3SymbolBrowser::Node Tc3SymbolBrowser::member(const Node& parent, const Tc3Ads::DatatypeEntry* item) const
+{
+    Node n;
+    n.name = parent.name + '.' + QString::fromLatin1(Tc3Ads::datatypeName(item), item->nameLength);
+    n.type = QString::fromLatin1(Tc3Ads::datatypeType(item), item->typeLength);
+    n.comment = QString::fromLatin1(Tc3Ads::datatypeComment(item), item->commentLength);
+    n.group = parent.group;
+    n.offset = parent.offset + item->offs;
+    n.size = item->size;
+    n.expandable = isExpandable(n.type);
+    return n;
+}
+
+Tc3SymbolBrowser::Node Tc3SymbolBrowser::element(const Node& parent, const ArrayInfo& info, int index) const
+{
+    // row major, the last dimension changes fastest
+    QStringList indices;
+    int rest = index;
+    for(int d=info.elements.size()-1; d>=0; --d)
+    {
+        indices.prepend(QString::number(info.lowerBounds[d] + rest % info.elements[d]));
+        rest /= info.elements[d];
+    }
+
+    Node n;
+    n.name = parent.name + '[' + indices.join(',') + ']';
+    n.type = info.elementType;
+    n.group = parent.group;
+    n.size = parent.size / static_cast<quint32>(info.count);
+    n.offset = parent.offset + static_cast<quint32>(index) * n.size;
+    n.expandable = isExpandable(n.type);
+    return n;
+}
+
+// segment is either a member name or an index in brackets, e.g. [3] or [1,2]
+Tc3SymbolBrowser::Node Tc3SymbolBrowser::child(const Node& parent, const QString& segment) const
+{
+    if(segment.startsWith('['))
+    {
+        ArrayInfo info;
+        if(!arrayInfo(parent.type, info))
+            return Node();
+
+        QStringList indices = segment.mid(1, segment.size() - 2).split(',');
+        if(indices.size() != info.elements.size())
+            return Node();
+
+        int index = 0;
+        for(int d=0; d<indices.size(); ++d)
+        {
+            bool ok;
+            const int i = indices[d].trimmed().toInt(&ok) - info.lowerBounds[d];
+            if(!ok || i < 0 || i >= info.elements[d])
+                return Node();
+
+            index = index * info.elements[d] + i;
+        }
+
+        return element(parent, info, index);
+    }
+
+    const Tc3Ads::DatatypeEntry* dt = datatype(parent.type);
+    for(int depth=0; dt && !dt->subItems && dt->typeLength && depth<16; ++depth)
+        dt = datatype(QString::fromLatin1(Tc3Ads::datatypeType(dt), dt->typeLength));
+
+    if(!dt)
+        return Node();
+
+    const QByteArray name = lowerLatin1(segment);
+    const Tc3Ads::DatatypeEntry* item = Tc3Ads::datatypeFirstSubItem(dt);
+    for(int i=0; i<dt->subItems; ++i, item=Tc3Ads::datatypeNextSubItem(item))
+    {
+        if(item->nameLength == name.size() && lowerLatin1(QString::fromLatin1(Tc3Ads::datatypeName(item), item->nameLength)) == name)
+            return member(parent, item);
+    }
+
+    return Node();
+}
+
+// like child, but also for namespaces
+Tc3SymbolBrowser::Node Tc3SymbolBrowser::descend(const Node& parent, const QString& segment) const
+{
+    if(!parent.type.isEmpty())
+        return child(parent, segment);
+
+    const int id = findSymbol(parent.name + '.' + segment);
+    return id >= 0 ? symbolNode(id) : Node();
+}
+
+// flat (row major) indices of all elements selected by segment, e.g. [*], [3], [1..4,*]
+bool Tc3SymbolBrowser::elementIndices(const ArrayInfo& info, const QString& segment, QVector<int>& indices) const
+{
+    indices.clear();
+
+    QStringList dimensions = segment.mid(1, segment.size() - 2).split(',');
+    if(dimensions.size() == 1 && dimensions.first().trimmed() == "*")
+    {
+        indices.reserve(info.count);
+        for(int i=0; i<info.count; ++i)
+            indices.append(i);
+
+        return true;
+    }
+
+    if(dimensions.size() != info.elements.size())
+        return false;
+
+    indices.append(0);
+    for(int d=0; d<dimensions.size(); ++d)
+    {
+        // selected range of this dimension, zero based
+        const QString dimension = dimensions[d].trimmed();
+        int first = 0;
+        int last = info.elements[d] - 1;
+        if(dimension != "*")
+        {
+            QStringList bounds = dimension.split("..");
+            bool ok0 = true;
+            bool ok1 = true;
+            first = bounds.first().trimmed().toInt(&ok0) - info.lowerBounds[d];
+            last = bounds.size() == 2 ? bounds[1].trimmed().toInt(&ok1) - info.lowerBounds[d] : first;
+            if(!ok0 || !ok1 || bounds.size() > 2)
+                return false;
+
+            first = std::max(first, 0);
+            last = std::min(last, info.elements[d] - 1);
+        }
+
+        QVector<int> next;
+        foreach(int prefix, indices)
+        {
+            for(int i=first; i<=last; ++i)
+                next.append(prefix * info.elements[d] + i);
+        }
+        indices = next;
+    }
+
+    return true;
+}
+
+void Tc3SymbolBrowser::buildIndex()
+{
+    // datatypes by name
+    datatypeIndex_.clear();
+    for(int offset=0; offset + static_cast<int>(sizeof(Tc3Ads::DatatypeEntry)) <= datatypes_.size();)
+    {
+        const Tc3Ads::DatatypeEntry* dt = reinterpret_cast<const Tc3Ads::DatatypeEntry*>(datatypes_.constData() + offset);
+        if(!dt->entryLength)
+            break;
+
+        datatypeIndex_.insert(QString::fromLatin1(Tc3Ads::datatypeName(dt), dt->nameLength).toLower(), static_cast<quint32>(offset));
+        offset += static_cast<int>(dt->entryLength);
+    }
+
+    // all symbols, sorted by lowercase name
+    QVector<quint32> entries;
+    QByteArray lower;
+    QVector<quint32> offsets;
+    for(int offset=0; offset + static_cast<int>(sizeof(AdsSymbolEntry)) <= symbols_.size();)
+    {
+        const AdsSymbolEntry* e = reinterpret_cast<const AdsSymbolEntry*>(symbols_.constData() + offset);
+        if(!e->entryLength)
+            break;
+
+        entries.append(static_cast<quint32>(offset));
+        offsets.append(static_cast<quint32>(lower.size()));
+        lower.append(lowerLatin1(QString::fromLatin1(symbolName(e), e->nameLength)));
+        offset += static_cast<int>(e->entryLength);
+    }
+    offsets.append(static_cast<quint32>(lower.size()));
+
+    QVector<int> order(entries.size());
+    for(int i=0; i<order.size(); ++i)
+        order[i] = i;
+
+    std::sort(order.begin(), order.end(), [&lower, &offsets](int a, int b)
+    {
+        const int la = static_cast<int>(offsets[a + 1] - offsets[a]);
+        const int lb = static_cast<int>(offsets[b + 1] - offsets[b]);
+        const int c = memcmp(lower.constData() + offsets[a], lower.constData() + offsets[b], static_cast<size_t>(std::min(la, lb)));
+        return c < 0 || (c == 0 && la < lb);
+    });
+
+    entries_.clear();
+    lower_.clear();
+    lowerOffsets_.clear();
+    entries_.reserve(order.size());
+    lower_.reserve(lower.size());
+    lowerOffsets_.reserve(order.size() + 1);
+    foreach(int i, order)
+    {
+        entries_.append(entries[i]);
+        lowerOffsets_.append(static_cast<quint32>(lower_.size()));
+        lower_.append(lower.constData() + offsets[i], static_cast<int>(offsets[i + 1] - offsets[i]));
+    }
+    lowerOffsets_.append(static_cast<quint32>(lower_.size()));
+
+    // trigram index in two passes, count and fill. every id appears at most once per trigram
+    QVector<int> last(trigramBuckets, -1);
+    trigramStart_.fill(0, trigramBuckets + 1);
+    for(int id=0; id<entries_.size(); ++id)
+    {
+        for(quint32 i=lowerOffsets_[id]; i+3<=lowerOffsets_[id + 1]; ++i)
+        {
+            const int t = static_cast<int>(trigram(lower_.constData() + i));
+            if(last[t] != id)
+            {
+                last[t] = id;
+                ++trigramStart_[t + 1];
+            }
+        }
+    }
+
+    for(int t=0; t<trigramBuckets; ++t)
+        trigramStart_[t + 1] += trigramStart_[t];
+
+    trigrams_.resize(static_cast<int>(trigramStart_[trigramBuckets]));
+    QVector<quint32> fill = trigramStart_;
+    last.fill(-1);
+    for(int id=0; id<entries_.size(); ++id)
+    {
+        for(quint32 i=lowerOffsets_[id]; i+3<=lowerOffsets_[id + 1]; ++i)
+        {
+            const int t = static_cast<int>(trigram(lower_.constData() + i));
+            if(last[t] != id)
+            {
+                last[t] = id;
+                trigrams_[static_cast<int>(fill[t]++)] = static_cast<quint32>(id);
+            }
+        }
+    }
+}
+
+/*static*/
+bool Tc3SymbolBrowser::isWildcard(const QString& segment)
+{
+    return segment.contains('*') || segment.contains('?');
+}
+
+/*static*/
+QByteArray Tc3SymbolBrowser::lowerLatin1(const QString& text)
+{
+    return text.toLower().toLatin1();
+}
+
+/*static*/
+quint32 Tc3SymbolBrowser::trigram(const char* text)
+{
+    const quint32 t = (static_cast<quint32>(static_cast<uchar>(text[0])) << 16) |
+                      (static_cast<quint32>(static_cast<uchar>(text[1])) << 8) |
+                       static_cast<quint32>(static_cast<uchar>(text[2]));
+
+    return (t * 2654435761u) >> 16;
+}
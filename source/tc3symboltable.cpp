@@ -0,0 +1,268 @@
+#include <include/tc3symboltable.h>
+#include <cstring>
+
+namespace
+{
+
+const quint32 fnvOffset = 2166136261u;
+const quint32 fnvPrime = 16777619u;
+
+// removed names are dropped from the arena once they take more than half of it
+const int minimumCompaction = 4096;
+
+}
+
+Tc3SymbolTable::Tc3SymbolTable()
+{
+    mask_ = 0;
+    removedBytes_ = 0;
+    rehash(64);
+}
+
+Tc3SymbolTable::Id Tc3SymbolTable::insert(const QString& name)
+{
+    const quint32 h = hash(name);
+    int i = slot(name, h);
+    if(buckets_[i] != InvalidId)
+        return buckets_[i];
+
+    // keep the load factor below 1/2, such that probing stays short
+    if((count() + 1) * 2 > buckets_.size())
+    {
+        rehash(buckets_.size() * 2);
+        i = slot(name, h);
+    }
+
+    const QByteArray latin1 = name.toLatin1();
+
+    Symbol s;
+    s.name = static_cast<quint32>(names_.size());
+    s.nameLength = static_cast<quint32>(latin1.size());
+    s.type = InvalidId;
+    s.group = 0;
+    s.offset = 0;
+    s.size = 0;
+
+    names_.append(latin1);
+
+    Id id;
+    if(!free_.isEmpty())
+    {
+        id = free_.takeLast();
+        symbols_[static_cast<int>(id)] = s;
+    }
+    else
+    {
+        id = static_cast<Id>(symbols_.size());
+        symbols_.append(s);
+    }
+
+    buckets_[i] = id;
+    return id;
+}
+
+Tc3SymbolTable::Id Tc3SymbolTable::find(const QString& name) const
+{
+    return buckets_[slot(name, hash(name))];
+}
+
+// the id may be returned by the next insert, for another name
+void Tc3SymbolTable::remove(Id id)
+{
+    if(id >= static_cast<Id>(symbols_.size()) || symbols_[static_cast<int>(id)].name == InvalidId)
+        return;
+
+    int i = home(id);
+    while(buckets_[i] != id)
+        i = (i + 1) & mask_;
+
+    // backward shift deletion, ids that probed past the bucket move up, no tombstones needed
+    int j = i;
+    for(;;)
+    {
+        j = (j + 1) & mask_;
+        if(buckets_[j] == InvalidId)
+            break;
+
+        const int k = home(buckets_[j]);
+        if(i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+
+        buckets_[i] = buckets_[j];
+        i = j;
+    }
+    buckets_[i] = InvalidId;
+
+    Symbol& s = symbols_[static_cast<int>(id)];
+    removedBytes_ += static_cast<int>(s.nameLength);
+    s.name = InvalidId;
+    s.nameLength = 0;
+    s.type = InvalidId;
+    free_.append(id);
+
+    if(removedBytes_ >= minimumCompaction && removedBytes_ * 2 > names_.size())
+        compact();
+}
+
+int Tc3SymbolTable::count() const
+{
+    return symbols_.size() - free_.size();
+}
+
+const Tc3SymbolTable::Symbol& Tc3SymbolTable::symbol(Id id) const
+{
+    return symbols_.at(static_cast<int>(id));
+}
+
+QString Tc3SymbolTable::name(Id id) const
+{
+    if(id >= static_cast<Id>(symbols_.size()) || symbol(id).name == InvalidId)
+        return QString();
+
+    const Symbol& s = symbol(id);
+    return QString::fromLatin1(names_.constData() + s.name, static_cast<int>(s.nameLength));
+}
+
+QString Tc3SymbolTable::typeName(Id id) const
+{
+    if(!isResolved(id))
+        return QString();
+
+    return QString::fromLatin1(types_.constData() + typeOffsets_.at(static_cast<int>(symbol(id).type)));
+}
+
+bool Tc3SymbolTable::isResolved(Id id) const
+{
+    return id < static_cast<Id>(symbols_.size()) && symbol(id).type != InvalidId;
+}
+
+void Tc3SymbolTable::setInfo(Id id, quint32 group, quint32 offset, quint32 size, const char* type, int typeLength)
+{
+    Symbol& s = symbols_[static_cast<int>(id)];
+    s.group = group;
+    s.offset = offset;
+    s.size = size;
+    s.type = internType(type, typeLength);
+}
+
+qint64 Tc3SymbolTable::memoryUsage() const
+{
+    // QHash nodes are estimated, there are only a few hundred distinct types in a typical plc
+    return names_.capacity()
+         + static_cast<qint64>(symbols_.capacity()) * static_cast<qint64>(sizeof(Symbol))
+         + static_cast<qint64>(buckets_.capacity()) * static_cast<qint64>(sizeof(Id))
+         + static_cast<qint64>(free_.capacity()) * static_cast<qint64>(sizeof(Id))
+         + types_.capacity()
+         + static_cast<qint64>(typeOffsets_.capacity()) * static_cast<qint64>(sizeof(quint32))
+         + static_cast<qint64>(typeIds_.size()) * 64;
+}
+
+/*static*/
+quint32 Tc3SymbolTable::hash(const QString& name)
+{
+    // FNV-1a over the code units, for latin1 names identical to hashing the stored bytes
+    quint32 h = fnvOffset;
+    const QChar* c = name.unicode();
+    for(int i=0; i<name.size(); ++i)
+        h = (h ^ c[i].unicode()) * fnvPrime;
+
+    return h;
+}
+
+/*static*/
+quint32 Tc3SymbolTable::hash(const char* name, int length)
+{
+    quint32 h = fnvOffset;
+    for(int i=0; i<length; ++i)
+        h = (h ^ static_cast<uchar>(name[i])) * fnvPrime;
+
+    return h;
+}
+
+bool Tc3SymbolTable::equals(const Symbol& symbol, const QString& name) const
+{
+    if(static_cast<int>(symbol.nameLength) != name.size())
+        return false;
+
+    const uchar* stored = reinterpret_cast<const uchar*>(names_.constData() + symbol.name);
+    const QChar* c = name.unicode();
+    for(int i=0; i<name.size(); ++i)
+    {
+        if(stored[i] != c[i].unicode())
+            return false;
+    }
+
+    return true;
+}
+
+// bucket that either holds name or is the empty bucket where name has to be inserted
+int Tc3SymbolTable::slot(const QString& name, quint32 h) const
+{
+    int i = static_cast<int>(h & static_cast<quint32>(mask_));
+    while(buckets_[i] != InvalidId && !equals(symbols_[static_cast<int>(buckets_[i])], name))
+        i = (i + 1) & mask_;
+
+    return i;
+}
+
+// bucket the name of id hashes to
+int Tc3SymbolTable::home(Id id) const
+{
+    const Symbol& s = symbols_[static_cast<int>(id)];
+    return static_cast<int>(hash(names_.constData() + s.name, static_cast<int>(s.nameLength)) & static_cast<quint32>(mask_));
+}
+
+void Tc3SymbolTable::rehash(int buckets)
+{
+    buckets_.fill(InvalidId, buckets);
+    mask_ = buckets - 1;
+
+    for(int id=0; id<symbols_.size(); ++id)
+    {
+        if(symbols_[id].name == InvalidId)
+            continue;
+
+        int i = home(static_cast<Id>(id));
+        while(buckets_[i] != InvalidId)
+            i = (i + 1) & mask_;
+
+        buckets_[i] = static_cast<Id>(id);
+    }
+}
+
+// copies the names of the remaining symbols into a new arena, ids and buckets stay as they are
+void Tc3SymbolTable::compact()
+{
+    QByteArray names;
+    names.reserve(names_.size() - removedBytes_);
+    for(int id=0; id<symbols_.size(); ++id)
+    {
+        Symbol& s = symbols_[id];
+        if(s.name == InvalidId)
+            continue;
+
+        const quint32 offset = static_cast<quint32>(names.size());
+        names.append(names_.constData() + s.name, static_cast<int>(s.nameLength));
+        s.name = offset;
+    }
+
+    names_ = names;
+    removedBytes_ = 0;
+}
+
+quint32 Tc3SymbolTable::internType(const char* type, int length)
+{
+    const QByteArray key = QByteArray::fromRawData(type, length);
+    auto it = typeIds_.constFind(key);
+    if(it != typeIds_.constEnd())
+        return it.value();
+
+    const quint32 typeId = static_cast<quint32>(typeOffsets_.size());
+    typeOffsets_.append(static_cast<quint32>(types_.size()));
+    types_.append(type, length);
+    types_.append('\0');
+
+    // fromRawData doesn't own the data, store a deep copy as key
+    typeIds_.insert(QByteArray(type, length), typeId);
+    return typeId;
+}
@@ -0,0 +1,56 @@
+#include <include/tc3transport.h>
+
+// use the correct ads defintions, platform depend
+#ifdef __linux__
+#include "AdsLib.h"
+#elif _WIN32
+#include <TcAdsAPI.h>
+#else
+#endif
+
+Tc3Transport::~Tc3Transport()
+{
+}
+
+long Tc3AdsTransport::portOpen()
+{
+    return AdsPortOpenEx();
+}
+
+long Tc3AdsTransport::portClose(long port)
+{
+    return AdsPortCloseEx(port);
+}
+
+long Tc3AdsTransport::readState(long port, AmsAddr* addr, unsigned short* adsState, unsigned short* deviceState)
+{
+    return AdsSyncReadStateReqEx(port, addr, adsState, deviceState);
+}
+
+long Tc3AdsTransport::read(long port, AmsAddr* addr, utype group, utype offset, utype length, void* data, utype* bytesRead)
+{
+    return AdsSyncReadReqEx2(port, addr, group, offset, length, data, bytesRead);
+}
+
+long Tc3AdsTransport::write(long port, AmsAddr* addr, utype group, utype offset, utype length, const void* data)
+{
+    // ugly const cast, but Twincat3 Api want's it that way
+    return AdsSyncWriteReqEx(port, addr, group, offset, length, const_cast<void*>(data));
+}
+
+long Tc3AdsTransport::readWrite(long port, AmsAddr* addr, utype group, utype offset, utype readLength, void* readData,
+                                utype writeLength, const void* writeData, utype* bytesRead)
+{
+    return AdsSyncReadWriteReqEx2(port, addr, group, offset, readLength, readData, writeLength, const_cast<void*>(writeData), bytesRead);
+}
+
+long Tc3AdsTransport::addNotification(long port, AmsAddr* addr, utype group, utype offset, const AdsNotificationAttrib* attrib,
+                                      PAdsNotificationFuncEx callback, utype userdata, utype* handle)
+{
+    return AdsSyncAddDeviceNotificationReqEx(port, addr, group, offset, const_cast<AdsNotificationAttrib*>(attrib), callback, userdata, handle);
+}
+
+long Tc3AdsTransport::delNotification(long port, AmsAddr* addr, utype handle)
+{
+    return AdsSyncDelDeviceNotificationReqEx(port, addr, handle);
+}
@@ -0,0 +1,458 @@
+#include <include/tc3typeregistry.h>
+#include <QDateTime>
+#include <QStringList>
+#include <cstring>
+
+namespace
+{
+
+template<typename T>
+bool decodeValue(const Tc3TypeDescriptor&, const char* data, int, QVariant& out)
+{
+    T v;
+    memcpy(&v, data, sizeof(T));
+    out = QVariant::fromValue(v);
+    return true;
+}
+
+template<typename T>
+bool encodeValue(const Tc3TypeDescriptor&, const QVariant& in, char* data, int)
+{
+    QVariant v(in);
+    if(!v.convert(qMetaTypeId<T>()))
+        return false;
+
+    T t = v.value<T>();
+    memcpy(data, &t, sizeof(T));
+    return true;
+}
+
+bool decodeBool(const Tc3TypeDescriptor&, const char* data, int, QVariant& out)
+{
+    out = QVariant(data[0] != 0);
+    return true;
+}
+
+bool encodeBool(const Tc3TypeDescriptor&, const QVariant& in, char* data, int)
+{
+    data[0] = in.toBool() ? 1 : 0;
+    return true;
+}
+
+// DATE and DT are seconds since 1970-01-01, TOD is milliseconds since midnight
+bool decodeDate(const Tc3TypeDescriptor&, const char* data, int, QVariant& out)
+{
+    quint32 s;
+    memcpy(&s, data, sizeof(s));
+    out = QDateTime::fromSecsSinceEpoch(s, Qt::UTC).date();
+    return true;
+}
+
+bool encodeDate(const Tc3TypeDescriptor&, const QVariant& in, char* data, int)
+{
+    QDate d = in.toDate();
+    if(!d.isValid())
+        return false;
+
+    quint32 s = static_cast<quint32>(QDateTime(d, QTime(0, 0), Qt::UTC).toSecsSinceEpoch());
+    memcpy(data, &s, sizeof(s));
+    return true;
+}
+
+bool decodeDateAndTime(const Tc3TypeDescriptor&, const char* data, int, QVariant& out)
+{
+    quint32 s;
+    memcpy(&s, data, sizeof(s));
+    out = QDateTime::fromSecsSinceEpoch(s, Qt::UTC);
+    return true;
+}
+
+bool encodeDateAndTime(const Tc3TypeDescriptor&, const QVariant& in, char* data, int)
+{
+    QDateTime dt = in.toDateTime();
+    if(!dt.isValid())
+        return false;
+
+    quint32 s = static_cast<quint32>(dt.toSecsSinceEpoch());
+    memcpy(data, &s, sizeof(s));
+    return true;
+}
+
+bool decodeTimeOfDay(const Tc3TypeDescriptor&, const char* data, int, QVariant& out)
+{
+    quint32 ms;
+    memcpy(&ms, data, sizeof(ms));
+    out = QTime::fromMSecsSinceStartOfDay(static_cast<int>(ms));
+    return true;
+}
+
+bool encodeTimeOfDay(const Tc3TypeDescriptor&, const QVariant& in, char* data, int)
+{
+    QTime t = in.toTime();
+    if(!t.isValid())
+        return false;
+
+    quint32 ms = static_cast<quint32>(t.msecsSinceStartOfDay());
+    memcpy(data, &ms, sizeof(ms));
+    return true;
+}
+
+// LDATE, LDT and LTOD are nanoseconds, Qt only resolves milliseconds
+bool decodeLDateAndTime(const Tc3TypeDescriptor& type, const char* data, int, QVariant& out)
+{
+    quint64 ns;
+    memcpy(&ns, data, sizeof(ns));
+    QDateTime dt = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(ns / 1000000), Qt::UTC);
+
+    if(type.kind == Tc3TypeDescriptor::LDate)
+        out = dt.date();
+    else
+        out = dt;
+
+    return true;
+}
+
+bool encodeLDateAndTime(const Tc3TypeDescriptor&, const QVariant& in, char* data, int)
+{
+    QDateTime dt = in.type() == QVariant::Date ? QDateTime(in.toDate(), QTime(0, 0), Qt::UTC) : in.toDateTime();
+    if(!dt.isValid())
+        return false;
+
+    quint64 ns = static_cast<quint64>(dt.toMSecsSinceEpoch()) * 1000000;
+    memcpy(data, &ns, sizeof(ns));
+    return true;
+}
+
+bool decodeLTimeOfDay(const Tc3TypeDescriptor&, const char* data, int, QVariant& out)
+{
+    quint64 ns;
+    memcpy(&ns, data, sizeof(ns));
+    out = QTime::fromMSecsSinceStartOfDay(static_cast<int>(ns / 1000000));
+    return true;
+}
+
+bool encodeLTimeOfDay(const Tc3TypeDescriptor&, const QVariant& in, char* data, int)
+{
+    QTime t = in.toTime();
+    if(!t.isValid())
+        return false;
+
+    quint64 ns = static_cast<quint64>(t.msecsSinceStartOfDay()) * 1000000;
+    memcpy(data, &ns, sizeof(ns));
+    return true;
+}
+
+bool decodeString(const Tc3TypeDescriptor& type, const char* data, int size, QVariant& out)
+{
+    QString text;
+    if(type.kind == Tc3TypeDescriptor::WString)
+        Tc3StringCodec::decodeWString(data, size, text);
+    else
+        Tc3StringCodec::decodeString(data, size, text, type.encoding);
+
+    out = text;
+    return true;
+}
+
+bool encodeString(const Tc3TypeDescriptor& type, const QVariant& in, char* data, int size)
+{
+    if(type.kind == Tc3TypeDescriptor::WString)
+        Tc3StringCodec::encodeWString(in.toString(), data, size);
+    else
+        Tc3StringCodec::encodeString(in.toString(), data, size, type.encoding);
+
+    return true;
+}
+
+bool decodeArray(const Tc3TypeDescriptor& type, const char* data, int size, QVariant& out)
+{
+    const Tc3TypeDescriptor& element = *type.element;
+    if(type.count * element.size > size)
+        return false;
+
+    QVariantList list;
+    list.reserve(type.count);
+
+    QVariant v;
+    for(int i=0; i<type.count; ++i)
+    {
+        if(!element.decode(element, data + i * element.size, element.size, v))
+            return false;
+
+        list.append(v);
+    }
+
+    out = list;
+    return true;
+}
+
+bool encodeArray(const Tc3TypeDescriptor& type, const QVariant& in, char* data, int size)
+{
+    const Tc3TypeDescriptor& element = *type.element;
+    const QVariantList list = in.toList();
+    if(list.size() != type.count || type.count * element.size > size)
+        return false;
+
+    for(int i=0; i<type.count; ++i)
+    {
+        if(!element.encode(element, list.at(i), data + i * element.size, element.size))
+            return false;
+    }
+
+    return true;
+}
+
+#define QADS_TYPE(kind, type) { Tc3TypeDescriptor::kind, sizeof(type), decodeValue<type>, encodeValue<type>, nullptr, 1, 0, Tc3StringCodec::Windows1252 }
+#define QADS_TYPE_CONV(kind, size, conv) { Tc3TypeDescriptor::kind, size, decode##conv, encode##conv, nullptr, 1, 0, Tc3StringCodec::Windows1252 }
+
+const Tc3TypeDescriptor boolType = QADS_TYPE_CONV(Bool, 1, Bool);
+const Tc3TypeDescriptor sintType = QADS_TYPE(SInt, qint8);
+const Tc3TypeDescriptor usintType = QADS_TYPE(USInt, quint8);
+const Tc3TypeDescriptor intType = QADS_TYPE(Int, qint16);
+const Tc3TypeDescriptor uintType = QADS_TYPE(UInt, quint16);
+const Tc3TypeDescriptor dintType = QADS_TYPE(DInt, qint32);
+const Tc3TypeDescriptor udintType = QADS_TYPE(UDInt, quint32);
+const Tc3TypeDescriptor lintType = QADS_TYPE(LInt, qint64);
+const Tc3TypeDescriptor ulintType = QADS_TYPE(ULInt, quint64);
+const Tc3TypeDescriptor realType = QADS_TYPE(Real, float);
+const Tc3TypeDescriptor lrealType = QADS_TYPE(LReal, double);
+const Tc3TypeDescriptor timeType = QADS_TYPE(Time, quint32);         // milliseconds
+const Tc3TypeDescriptor ltimeType = QADS_TYPE(LTime, quint64);       // nanoseconds
+const Tc3TypeDescriptor dateType = QADS_TYPE_CONV(Date, 4, Date);
+const Tc3TypeDescriptor dtType = QADS_TYPE_CONV(DateAndTime, 4, DateAndTime);
+const Tc3TypeDescriptor todType = QADS_TYPE_CONV(TimeOfDay, 4, TimeOfDay);
+const Tc3TypeDescriptor ldateType = QADS_TYPE_CONV(LDate, 8, LDateAndTime);
+const Tc3TypeDescriptor ldtType = QADS_TYPE_CONV(LDateAndTime, 8, LDateAndTime);
+const Tc3TypeDescriptor ltodType = QADS_TYPE_CONV(LTimeOfDay, 8, LTimeOfDay);
+const Tc3TypeDescriptor userTypeType = { Tc3TypeDescriptor::UserType, 0, nullptr, nullptr, nullptr, 1, 0, Tc3StringCodec::Windows1252 };
+
+#undef QADS_TYPE
+#undef QADS_TYPE_CONV
+
+// nesting limit for aliases of aliases and arrays of arrays
+const int maxDepth = 16;
+
+}
+
+Tc3TypeRegistry::Tc3TypeRegistry() :
+    encoding_(Tc3StringCodec::Windows1252)
+{
+    complete_ = true;
+}
+
+Tc3TypeRegistry::~Tc3TypeRegistry()
+{
+    qDeleteAll(owned_);
+}
+
+const Tc3TypeDescriptor* Tc3TypeRegistry::resolve(const QString& typeName, int size, const BaseTypeLookup& lookup)
+{
+    const Tc3TypeDescriptor* type = resolved_.value(typeName, nullptr);
+    if(!type)
+    {
+        // a failed lookup gives a user type for now, the name is resolved again next time
+        complete_ = true;
+        type = parse(typeName, size, lookup, 0);
+        if(complete_)
+            resolved_.insert(typeName, type);
+    }
+
+    // never decode more or less than the symbol actually occupies
+    if(type->kind != Tc3TypeDescriptor::UserType && type->size != size)
+        return userType();
+
+    return type;
+}
+
+void Tc3TypeRegistry::clear()
+{
+    resolved_.clear();
+}
+
+void Tc3TypeRegistry::setStringEncoding(Tc3StringCodec::Encoding encoding)
+{
+    encoding_ = encoding;
+    foreach(Tc3TypeDescriptor* type, owned_)
+    {
+        if(type->kind == Tc3TypeDescriptor::String)
+            type->encoding = encoding;
+    }
+}
+
+/*static*/
+const Tc3TypeDescriptor* Tc3TypeRegistry::userType()
+{
+    return &userTypeType;
+}
+
+const Tc3TypeDescriptor* Tc3TypeRegistry::parse(const QString& typeName, int size, const BaseTypeLookup& lookup, int depth)
+{
+    if(depth > maxDepth)
+        return userType();
+
+    if(const Tc3TypeDescriptor* type = elementary(typeName))
+        return type;
+
+    if(typeName.startsWith("STRING"))
+        return string(Tc3TypeDescriptor::String, size);
+
+    if(typeName.startsWith("WSTRING"))
+        return string(Tc3TypeDescriptor::WString, size);
+
+    if(typeName.startsWith("ARRAY"))
+        return parseArray(typeName, size, lookup, depth);
+
+    // pointer sized types, we only expose the address
+    if(typeName.startsWith("POINTER TO") || typeName == "PVOID" || typeName == "UXINT" || typeName == "XWORD")
+        return integer(size, false);
+
+    if(typeName == "XINT")
+        return integer(size, true);
+
+    // a reference is read and written like the referenced value
+    if(typeName.startsWith("REFERENCE TO"))
+        return parse(typeName.mid(12).trimmed(), size, lookup, depth + 1);
+
+    // aliases and enumerations
+    QString baseType;
+    if(lookup && !lookup(typeName, baseType))
+        complete_ = false;
+
+    if(!baseType.isEmpty() && baseType != typeName)
+        return parse(baseType, size, lookup, depth + 1);
+
+    // Tc2_System alias, also recognize it if the datatype information is not available
+    if(typeName.endsWith("T_MaxString"))
+        return string(Tc3TypeDescriptor::String, size);
+
+    return userType();
+}
+
+// e.g. ARRAY [1..12] OF REAL, ARRAY [0..1,-2..2] OF E_Color
+const Tc3TypeDescriptor* Tc3TypeRegistry::parseArray(const QString& typeName, int size, const BaseTypeLookup& lookup, int depth)
+{
+    int open = typeName.indexOf('[');
+    int close = typeName.indexOf(']', open);
+    int of = typeName.indexOf(" OF ", close);
+    if(open < 0 || close < 0 || of < 0)
+        return userType();
+
+    int count = 1;
+    int lowerBound = 0;
+    QStringList dimensions = typeName.mid(open + 1, close - open - 1).split(',');
+    for(int i=0; i<dimensions.size(); ++i)
+    {
+        QStringList bounds = dimensions[i].split("..");
+        bool okLower, okUpper;
+        int lower = bounds.value(0).trimmed().toInt(&okLower);
+        int upper = bounds.value(1).trimmed().toInt(&okUpper);
+        if(bounds.size() != 2 || !okLower || !okUpper || upper < lower)
+            return userType();
+
+        if(i == 0)
+            lowerBound = lower;
+
+        count *= upper - lower + 1;
+    }
+
+    if(count <= 0 || size % count != 0)
+        return userType();
+
+    const Tc3TypeDescriptor* element = parse(typeName.mid(of + 4).trimmed(), size / count, lookup, depth + 1);
+    if(!element->decode || element->size != size / count)
+        return userType();
+
+    // descriptors are kept until the registry is deleted, resolving again after an online change
+    // shares the existing ones
+    foreach(const Tc3TypeDescriptor* type, owned_)
+    {
+        if(type->kind == Tc3TypeDescriptor::Array && type->size == size && type->element == element && type->count == count && type->lowerBound == lowerBound)
+            return type;
+    }
+
+    Tc3TypeDescriptor* type = new Tc3TypeDescriptor;
+    type->kind = Tc3TypeDescriptor::Array;
+    type->size = size;
+    type->decode = decodeArray;
+    type->encode = encodeArray;
+    type->element = element;
+    type->count = count;
+    type->lowerBound = lowerBound;
+    type->encoding = encoding_;
+    owned_.append(type);
+    return type;
+}
+
+const Tc3TypeDescriptor* Tc3TypeRegistry::string(Tc3TypeDescriptor::Kind kind, int size)
+{
+    // STRING(n) and WSTRING(n) only differ in size, share them between all symbols
+    foreach(const Tc3TypeDescriptor* type, owned_)
+    {
+        if(type->kind == kind && type->size == size)
+            return type;
+    }
+
+    Tc3TypeDescriptor* type = new Tc3TypeDescriptor;
+    type->kind = kind;
+    type->size = size;
+    type->decode = decodeString;
+    type->encode = encodeString;
+    type->element = nullptr;
+    type->count = 1;
+    type->lowerBound = 0;
+    type->encoding = encoding_;
+    owned_.append(type);
+    return type;
+}
+
+/*static*/
+const Tc3TypeDescriptor* Tc3TypeRegistry::elementary(const QString& typeName)
+{
+    static const QHash<QString, const Tc3TypeDescriptor*> types =
+    {
+        { "BOOL", &boolType },
+        { "BIT", &boolType },
+        { "SINT", &sintType },
+        { "USINT", &usintType },
+        { "BYTE", &usintType },
+        { "INT", &intType },
+        { "UINT", &uintType },
+        { "WORD", &uintType },
+        { "DINT", &dintType },
+        { "UDINT", &udintType },
+        { "DWORD", &udintType },
+        { "LINT", &lintType },
+        { "ULINT", &ulintType },
+        { "LWORD", &ulintType },
+        { "REAL", &realType },
+        { "LREAL", &lrealType },
+        { "TIME", &timeType },
+        { "LTIME", &ltimeType },
+        { "DATE", &dateType },
+        { "DT", &dtType },
+        { "DATE_AND_TIME", &dtType },
+        { "TOD", &todType },
+        { "TIME_OF_DAY", &todType },
+        { "LDATE", &ldateType },
+        { "LDT", &ldtType },
+        { "LDATE_AND_TIME", &ldtType },
+        { "LTOD", &ltodType },
+        { "LTIME_OF_DAY", &ltodType }
+    };
+
+    return types.value(typeName, nullptr);
+}
+
+/*static*/
+const Tc3TypeDescriptor* Tc3TypeRegistry::integer(int size, bool isSigned)
+{
+    switch(size)
+    {
+    case 1: return isSigned ? &sintType : &usintType;
+    case 2: return isSigned ? &intType : &uintType;
+    case 4: return isSigned ? &dintType : &udintType;
+    case 8: return isSigned ? &lintType : &ulintType;
+    }
+
+    return userType();
+}
@@ -4,267 +4,215 @@
 
 Tc3Value::Tc3Value(QObject *parent) : QObject(parent)
 {
-
+    diff_ = nullptr;
+    manager_ = nullptr;
+    index_ = Tc3ValueStore::InvalidIndex;
 }
 
 Tc3Value::Tc3Value( const QString& name, Tc3Manager* manager, int datatypeSizeInByte/*=Tc3Manager::AutoType*/, QObject *parent/*=nullptr*/ ) : QObject(parent)
 {
-    name_= name;
-
-    h_ = 0;
-    variantType_ = QVariant::Type::Invalid;
-    notificationType_ = Tc3Manager::NotificationType::None;
-    vdatasizeInByte_ = datatypeSizeInByte;
+    diff_ = nullptr;
+    manager_ = manager;
 
-    nh_ = 0;
-    astart_ = 0;
+    // try to connect
+    index_ = manager_->acquire(name, datatypeSizeInByte);
+    manager_->setFacade(index_, this);
+}
 
+Tc3Value::Tc3Value(Tc3Manager* manager, Tc3ValueStore::Index index, QObject *parent/*=nullptr*/) : QObject(parent)
+{
+    diff_ = nullptr;
     manager_ = manager;
-    connect();	// try to connect
+    index_ = index;
+    manager_->setFacade(index_, this);
 }
 
 Tc3Value::~Tc3Value()
 {
-    if(isConnected())
-    {
-        manager_->disableNotify(nh_);
-        manager_->disconnectHandle(h_);
-    }
+    // the slot is released with its last reference, lean handles may still use it
+    if(manager_)
+        manager_->releaseFacade(this);
 
-    // remove this value from the manager when it is deleted
-    manager_->removeValue(this);
+    // QObject disconnects the signals afterwards
+    manager_ = nullptr;
+    delete diff_;
 }
 
-void Tc3Value::connect()
+void Tc3Value::connectNotify(const QMetaMethod& signal)
 {
-    if(isConnected())
-        return;
+    if(signal == QMetaMethod::fromSignal(&Tc3Value::changed) || signal == QMetaMethod::fromSignal(&Tc3Value::fieldsChanged))
+        updateListened();
+}
 
-    h_ = manager_->connectHandle(name_);
-    if(!h_)
-    {
-        variantType_ = QVariant::Type::Invalid;
-        return;
-    }
+void Tc3Value::disconnectNotify(const QMetaMethod& signal)
+{
+    // an invalid signal stands for disconnecting everything
+    if(!signal.isValid() || signal == QMetaMethod::fromSignal(&Tc3Value::changed) || signal == QMetaMethod::fromSignal(&Tc3Value::fieldsChanged))
+        updateListened();
+}
 
-    vsymbolinfo_ = manager_->symbolInfo(name_);
-    asize_ = Tc3Manager::tc3ArraySize(vsymbolinfo_.symbolType, &astart_);
-    variantType_ = vdatasizeInByte_ < 0 ? Tc3Manager::tc3VariantType(vsymbolinfo_.symbolType, vsymbolinfo_.size) : QVariant::Type::UserType;
-    enableNotify(notificationType_, cycleTimeMillisecond_, maxDelayMillisecond_);
+void Tc3Value::updateListened()
+{
+    if(!manager_)
+        return;
 
-    // read current value from the plc
-    // todo this can be removed if notification for user types is implemented
-    if(variantType_ != QVariant::Type::UserType)
-    {
-        emit changed(get());
-    }
+    const bool listened = isSignalConnected(QMetaMethod::fromSignal(&Tc3Value::changed)) || isSignalConnected(QMetaMethod::fromSignal(&Tc3Value::fieldsChanged));
+    manager_->setListened(index_, listened);
 }
 
 bool Tc3Value::isConnected() const
 {
-    return variantType_ != QVariant::Type::Invalid;
+    return manager_ && manager_->isValueConnected(index_);
 }
 
-void Tc3Value::enableNotify(Tc3Manager::NotificationType type, int cycleTimeMillisecond=500, int maxDelayMillisecond=1000)
+QString Tc3Value::name() const
 {
-    notificationType_ = type;
-    cycleTimeMillisecond_ = cycleTimeMillisecond;
-    maxDelayMillisecond_ = maxDelayMillisecond;
+    return manager_ ? manager_->valueName(index_) : QString();
+}
 
-    if(!isConnected())
-        return;
+int Tc3Value::size() const
+{
+    return manager_ ? manager_->valueSize(index_) : 0;
+}
 
-    if(type != Tc3Manager::NotificationType::None)
-    {
-        if(nh_ > 0)
-        {
-            manager_->disableNotify(nh_);
-            nh_ = 0;
-        }
+void Tc3Value::enableNotify(Tc3Manager::NotificationType type, int cycleTimeMillisecond=500, int maxDelayMillisecond=1000)
+{
+    if(manager_)
+        manager_->setNotification(index_, type, cycleTimeMillisecond, maxDelayMillisecond);
+}
 
-        nh_ = manager_->enableNotify(h_, vsymbolinfo_.size, type, maxDelayMillisecond, cycleTimeMillisecond, onNotification);
-    }
-    else if(type == Tc3Manager::NotificationType::None && nh_ > 0)
-    {
-        manager_->disableNotify(nh_);
-        nh_ = 0;
-    }
+void Tc3Value::setPriority(Tc3Manager::Priority priority)
+{
+    if(manager_)
+        manager_->setPriority(index_, priority);
 }
 
-QVariant Tc3Value::get() const
+void Tc3Value::setSampled(bool sampled)
 {
-    if(!isConnected())
-        return QVariant();
+    if(manager_)
+        manager_->setSampled(index_, sampled);
+}
 
-    if(variantType_ == QVariant::Type::UserType)
-    {
-        emit manager_->error("use Tc3Value::get<T> template for usertypes");
+QVariant Tc3Value::get() const
+{
+    if(!manager_)
         return QVariant();
-    }
-
-    QVariant v(variantType_);
 
-    if(asize_ > 1)
-    {
-        // \todo implement arrays
-    }
-    else if(variantType_ == QVariant::String)
-    {
-        char* text = new char[vsymbolinfo_.size];
-
-        if(!manager_->syncReadReq(h_, text, vsymbolinfo_.size))
-            return QVariant();
-
-        if(asize_ == 1)
-        {
-            cached_ = text;
-        }
-        else if(asize_ == 2)
-        {
-            cached_ = QString::fromWCharArray(reinterpret_cast<wchar_t*>(text), vsymbolinfo_.size >> 1);
-        }
-        else
-        {
-            emit manager_->error(QString("%1: incompatible string").arg(name_));
-        }
-
-        delete [] text;
-        return cached_;
-    }
-    else if(!manager_->syncReadReq(h_, v.data(), vsymbolinfo_.size))
-    {
-        return QVariant();
-    }
+    // a pending value is not cached, the plc still has the old value until the next flush
+    QVariant v;
+    bool pending = false;
+    if(!manager_->readValue(index_, v, &pending) && !pending)
+        cached_ = v;
 
-    cached_ = v;
     return v;
 }
 
-void Tc3Value::set(const QVariant& value)
+long Tc3Value::tryGet(QVariant& v) const
 {
-     if(!isConnected())
-        return;
+    if(!manager_)
+        return Tc3Manager::NotConnected;
 
-    QVariant v(value);
+    bool pending = false;
+    const long errorId = manager_->readValue(index_, v, &pending, false);
+    if(!errorId && !pending)
+        cached_ = v;
 
-    if(variantType_ == QVariant::Type::UserType)
-    {
-        emit manager_->error("use Tc3Value::set<T> template for usertypes");
-        return;
-    }
+    return errorId;
+}
 
-    // \todo implement array handling
-    if(asize_ > 1)
-        return;
+long Tc3Value::trySet(const QVariant& value)
+{
+    if(!manager_)
+        return Tc3Manager::NotConnected;
 
-    if(!v.convert(static_cast<int>(variantType_)))
-        return;
+    QVariant written;
+    const long errorId = manager_->writeValue(index_, value, &written, false);
+    if(!errorId && written.isValid())
+        cached_ = written;
 
-    if(variantType_ == QVariant::String)
-    {
-        QString text = v.toString();
-        text.resize(vsymbolinfo_.size);
-
-        if(asize_ == 1)
-        {
-            manager_->syncWriteReq(h_, text.toLatin1().data(), static_cast<int>(static_cast<unsigned long>(text.size()) * sizeof(char)));
-        }
-        else if(asize_ == 2)
-        {
-            manager_->syncWriteReq(h_, text.data_ptr(), vsymbolinfo_.size * 2);
-        }
-        else
-        {
-            emit manager_->error(QString("%1: incompatible string").arg(name_));
-        }
+    return errorId;
+}
 
-        cached_ = v;
-        return;
-    }
-    else if(variantType_ == QVariant::Bool && vsymbolinfo_.size == 1 )
-    {
-        bool b = v.toBool(); /* ? 1 : 0*/
-        manager_->syncWriteReq(h_, &b , vsymbolinfo_.size);
-        cached_ = v;
-        return;
-    }
+Tc3LatencyHistogram Tc3Value::latency(Tc3Manager::LatencyStage stage) const
+{
+    return manager_ ? manager_->latency(index_, stage) : Tc3LatencyHistogram();
+}
 
-    manager_->syncWriteReq(h_, v.data(), vsymbolinfo_.size);
-    cached_ = v;
+void Tc3Value::acknowledge()
+{
+    if(manager_)
+        manager_->acknowledge(index_);
 }
 
-void Tc3Value::invalidate()
+QByteArray Tc3Value::image() const
 {
-    variantType_ = QVariant::Type::Invalid;
-    emit changed(QVariant());
+    return diff_ ? diff_->image() : QByteArray();
 }
 
-/*static*/
-#ifdef __linux__
-void Tc3Value::onNotification(const AmsAddr *addr, const AdsNotificationHeader *header, Tc3Manager::utype userdata)
-#elif _WIN32
-void Tc3Value::onNotification(AmsAddr *addr, AdsNotificationHeader *header, Tc3Manager::utype userdata)
-#endif
-{  
-    Q_UNUSED(addr);
+bool Tc3Value::readChunked(char* data, qint64 size, const Tc3Manager::Progress& progress/*=Tc3Manager::Progress()*/, int chunkSize/*=0x10000*/, int parallel/*=4*/)
+{
+    return manager_ && manager_->transferChunked(index_, data, size, false, progress, chunkSize, parallel);
+}
 
-    // find the manager for this value. it would be great if we could simply use the pointer to it
-    // as userdata, however, this doesn't work with AdsAPI on 64 bit systems.
-    Tc3Manager* manager = nullptr;
-    if(Tc3Manager::uniqueInst_.contains(userdata))
-        manager = Tc3Manager::uniqueInst_[userdata];
+// the data is only read by the write requests
+bool Tc3Value::writeChunked(const char* data, qint64 size, const Tc3Manager::Progress& progress/*=Tc3Manager::Progress()*/, int chunkSize/*=0x10000*/, int parallel/*=4*/)
+{
+    return manager_ && manager_->transferChunked(index_, const_cast<char*>(data), size, true, progress, chunkSize, parallel);
+}
 
-    if(!manager)
+void Tc3Value::set(const QVariant& value)
+{
+    if(!manager_)
         return;
 
-    Tc3Value* self = manager->value(header->hNotification);
-    if(!self)
-        return;
+    // cache what actually has been written, such that notifications compare correctly
+    QVariant written;
+    if(!manager_->writeValue(index_, value, &written) && written.isValid())
+        cached_ = written;
+}
 
-    if(!self->isConnected())
+// latest notification sample, called by the manager
+void Tc3Value::update(const char* data, int size)
+{
+    // a newer value is about to be written, don't let the ui jump back to the old one
+    if(manager_->isValueDirty(index_))
         return;
 
-    char* data = new char[header->cbSampleSize];
-    // copy data, which start right after the header, don't use header->data as this is not implemented on Linux
-#ifdef __linux__
-    memcpy(data, static_cast<void*>(&header + sizeof(AdsNotificationHeader)), sizeof(char) * header->cbSampleSize);
-#elif _WIN32
-    memcpy(data, static_cast<void*>(&header->data), sizeof(char) * header->cbSampleSize);
-#endif
-
+    // without a conversion, the image is compared member by member
     QVariant v;
-    if(self->asize_ > 1)
-    {
-        // \todo implement array handling
-    }
-    else if(self->variantType_ == QVariant::String)
-    {
-        if(self->asize_ == 1)
-        {
-            v = QString(data);
-        }
-        else if(self->asize_ == 2)
-        {
-            v = QString::fromWCharArray(reinterpret_cast<wchar_t*>(data), header->cbSampleSize >> 1); // wchar uses 2 chars per character
-        }
-        else
-        {
-            emit self->manager_->error(QString("%1: incompatible string").arg(self->name_));
-        }
-    }
-    else
+    if(!manager_->decodeValue(index_, data, size, v))
     {
-        v = QVariant(static_cast<int>(self->variantType_), static_cast<void*>(data));
+        updateFields(data, size);
+        return;
     }
-    delete[] data;
 
     // only emit a signal if the value actually changed
-    if(self->cached_ != v)
+    if(cached_ != v)
     {
-        self->cached_ = v;
-        emit self->changed(v);
+        cached_ = v;
+        emit changed(v);
 #ifdef QT_DEBUG
-        qDebug() << self->name_ << " changed to " << v;
+        qDebug() << name() << " changed to " << v;
 #endif
     }
 }
+
+void Tc3Value::updateFields(const char* data, int size)
+{
+    if(!diff_)
+        diff_ = new Tc3StructDiff();
+
+    // the layout is fetched with the first sample and again if the size changed with an online change
+    if(diff_->size() != manager_->valueSize(index_) && !manager_->structLayout(index_, *diff_))
+        return;
+
+    const QVector<int> changed = diff_->update(data, size);
+    if(changed.isEmpty())
+        return;
+
+    QStringList fields;
+    foreach(int i, changed)
+        fields.append(diff_->fields().at(i).name);
+
+    emit fieldsChanged(fields);
+}
@@ -0,0 +1,73 @@
+#include <include/tc3valuegroup.h>
+#include <include/tc3value.h>
+#include <QMutexLocker>
+
+Tc3ValueGroup::Tc3ValueGroup(const QString& pattern, Tc3Manager* manager, Tc3Manager::NotificationType notificationType, int cycleTimeMillisecond, int maxDelayMillisecond) :
+    QObject(manager)
+{
+    pattern_ = pattern;
+    manager_ = manager;
+    notificationType_ = notificationType;
+    cycleTimeMillisecond_ = cycleTimeMillisecond;
+    maxDelayMillisecond_ = maxDelayMillisecond;
+}
+
+Tc3ValueGroup::~Tc3ValueGroup()
+{
+    manager_->removeGroup(this);
+}
+
+QString Tc3ValueGroup::pattern() const
+{
+    return pattern_;
+}
+
+QList<Tc3Value*> Tc3ValueGroup::values() const
+{
+    QMutexLocker locker(&manager_->mutex_);
+
+    // values that have been deleted are skipped, deleting values doesn't have to search groups
+    QList<Tc3Value*> r;
+    foreach(Tc3Value* v, values_)
+    {
+        if(v)
+            r.append(v);
+    }
+
+    return r;
+}
+
+int Tc3ValueGroup::count() const
+{
+    return values().size();
+}
+
+void Tc3ValueGroup::refresh()
+{
+    QMutexLocker locker(&manager_->mutex_);
+
+    // not connected, the manager expands the group again after connecting
+    Tc3SymbolBrowser* browser = manager_->symbolBrowser();
+    if(!browser)
+        return;
+
+    QList<Tc3Value*> values = manager_->values(browser->match(pattern_), notificationType_, cycleTimeMillisecond_, maxDelayMillisecond_);
+    const QList<Tc3Value*> previous = this->values();
+    if(values == previous)
+        return;
+
+    // members that don't match anymore would keep their handles and notifications on the plc
+    QList<Tc3Value*> removed;
+    foreach(Tc3Value* v, previous)
+    {
+        if(!values.contains(v))
+            removed.append(v);
+    }
+
+    values_.clear();
+    foreach(Tc3Value* v, values)
+        values_.append(v);
+
+    manager_->release(removed);
+    emit membersChanged();
+}
@@ -0,0 +1,123 @@
+#include <include/tc3valuestore.h>
+#include <include/tc3manager.h>
+
+Tc3ValueStore::Tc3ValueStore()
+{
+}
+
+Tc3ValueStore::Index Tc3ValueStore::allocate(Tc3SymbolTable::Id symbol, int requestedSizeInByte)
+{
+    Index i;
+    if(!free_.isEmpty())
+    {
+        i = free_.takeLast();
+    }
+    else
+    {
+        i = static_cast<Index>(symbols.size());
+        const int n = symbols.size() + 1;
+        symbols.resize(n);
+        references.resize(n);
+        requestedSize.resize(n);
+        handles.resize(n);
+        notifications.resize(n);
+        sizes.resize(n);
+        groups.resize(n);
+        offsets.resize(n);
+        types.resize(n);
+        notificationTypes.resize(n);
+        cycleTimes.resize(n);
+        maxDelays.resize(n);
+        priorities.resize(n);
+        subscriptions.resize(n);
+        facades.resize(n);
+        listened.resize(n);
+        sampled.resize(n);
+        accessed.resize(n);
+        inFlight.resize(n);
+        dirty.resize(n);
+        pendingRaw.resize(n);
+        pending.resize(n);
+    }
+
+    const int s = static_cast<int>(i);
+    symbols[s] = symbol;
+    references[s] = 1;
+    requestedSize[s] = requestedSizeInByte;
+    handles[s] = 0;
+    notifications[s] = 0;
+    sizes[s] = 0;
+    groups[s] = 0;
+    offsets[s] = 0;
+    types[s] = nullptr;
+    notificationTypes[s] = Tc3Manager::NotificationType::None;
+    cycleTimes[s] = 300;
+    maxDelays[s] = 1000;
+    priorities[s] = Tc3Manager::Normal;
+    facades[s] = nullptr;
+    listened[s] = false;
+    sampled[s] = false;
+    accessed[s] = 0;
+    inFlight[s] = 0;
+    dirty[s] = false;
+    pendingRaw[s] = false;
+    return i;
+}
+
+void Tc3ValueStore::release(Index i)
+{
+    if(!isValid(i))
+        return;
+
+    const int s = static_cast<int>(i);
+    references[s] = 0;
+    symbols[s] = Tc3SymbolTable::InvalidId;
+    types[s] = nullptr;
+    subscriptions[s].clear();
+    facades[s] = nullptr;
+    pending[s] = QVariant();
+    free_.append(i);
+}
+
+bool Tc3ValueStore::isValid(Index i) const
+{
+    return i < static_cast<Index>(references.size()) && references[static_cast<int>(i)] > 0;
+}
+
+int Tc3ValueStore::count() const
+{
+    return symbols.size() - free_.size();
+}
+
+int Tc3ValueStore::size() const
+{
+    return symbols.size();
+}
+
+qint64 Tc3ValueStore::memoryUsage() const
+{
+    // one element of every array per slot
+    const qint64 perSlot = sizeof(Tc3SymbolTable::Id) + sizeof(int) + sizeof(int)
+                         + sizeof(Tc3Transport::utype) + sizeof(Tc3Transport::utype) + sizeof(int) + sizeof(quint32) + sizeof(quint32)
+                         + sizeof(const Tc3TypeDescriptor*) + sizeof(quint8) + sizeof(int) + sizeof(int) + sizeof(quint8)
+                         + sizeof(QVector<Subscription>) + sizeof(Tc3Value*) + sizeof(bool) + sizeof(bool) + sizeof(qint64) + sizeof(int)
+                         + sizeof(bool) + sizeof(bool) + sizeof(QVariant);
+
+    return static_cast<qint64>(symbols.capacity()) * perSlot + static_cast<qint64>(free_.capacity()) * static_cast<qint64>(sizeof(Index));
+}
+
+Tc3SymbolTable::Id Tc3ValueStore::symbol(Index i) const
+{
+    return isValid(i) ? symbols[static_cast<int>(i)] : Tc3SymbolTable::InvalidId;
+}
+
+bool Tc3ValueStore::hasCallbacks(Index i) const
+{
+    foreach(const Subscription& subscription, subscriptions[static_cast<int>(i)])
+    {
+        if(subscription.callback)
+            return true;
+    }
+
+    return false;
+}